@@ -0,0 +1,114 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Measures the cycles per execution of the code generated for every command, using the harness functions created by
+ * bench/commandCostGenerator.c. Build and run it with "make bench-commands" (x86-64 Linux only).
+ * Usage: bench/commandCost [filter]
+ * If a filter is given, only harnesses whose description contains it are measured
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <cpuid.h>
+
+#define HARNESS_REQUIRES_RDRAND 1
+#define HARNESS_DOES_NOT_ASSEMBLE 2
+
+struct harness {
+    uint64_t (*function)(uint64_t iterations, void* buffer);
+    const char* description;
+    uint64_t flags;
+};
+
+extern struct harness memeasmBenchTable[];
+
+#define REPETITIONS 7
+#define MIN_CYCLES 2000000 //The number of iterations is doubled until a measurement takes at least this many cycles
+#define MAX_ITERATIONS (1u << 24)
+
+//Pointer operands point into this buffer. It is large enough for every operand size
+static uint64_t buffer[64];
+
+/**
+ * @return the minimum number of cycles of the harness over all repetitions
+ */
+static uint64_t measure(struct harness* harness, uint64_t iterations) {
+    uint64_t best = UINT64_MAX;
+    for(unsigned i = 0; i < REPETITIONS; i++) {
+        memset(buffer, 0, sizeof(buffer));
+        uint64_t cycles = harness->function(iterations, buffer);
+        if(cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+/**
+ * Chooses the number of iterations, so that the measurement is long enough to be accurate
+ */
+static uint64_t calibrate(struct harness* harness) {
+    uint64_t iterations = 1000;
+    while(iterations < MAX_ITERATIONS && harness->function(iterations, buffer) < MIN_CYCLES) {
+        iterations *= 2;
+    }
+    return iterations;
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = (argc > 1) ? argv[1] : NULL;
+
+    unsigned eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 27))) {
+        fprintf(stderr, "This CPU does not support rdtscp\n");
+        return 1;
+    }
+    bool rdrandSupported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 30));
+
+    //The first harness only contains the loop and the register reset. Its cost is subtracted from all others
+    struct harness* overhead = &memeasmBenchTable[0];
+    printf("Cycles per execution (reference cycles of the time stamp counter, loop overhead subtracted)\n\n");
+    printf("%10s  %s\n", "cycles", "opcode  command");
+
+    for(struct harness* harness = &memeasmBenchTable[1]; harness->description != NULL; harness++) {
+        if(filter != NULL && strstr(harness->description, filter) == NULL) {
+            continue;
+        }
+        if(harness->flags & HARNESS_DOES_NOT_ASSEMBLE) {
+            printf("%10s  %s\n", "-", harness->description);
+            continue;
+        }
+        if((harness->flags & HARNESS_REQUIRES_RDRAND) && !rdrandSupported) {
+            printf("%10s  %s (rdrand is not supported by this CPU)\n", "-", harness->description);
+            continue;
+        }
+
+        uint64_t iterations = calibrate(harness);
+        uint64_t cycles = measure(harness, iterations);
+        uint64_t overheadCycles = measure(overhead, iterations);
+        double perExecution = ((double) cycles - (double) overheadCycles) / (double) iterations;
+        printf("%10.2f  %s\n", (perExecution > 0) ? perExecution : 0.0, harness->description);
+    }
+    printf("\n\"-\": the translation of the command is rejected by the assembler\n");
+    return 0;
+}
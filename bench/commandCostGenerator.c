@@ -0,0 +1,322 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Generates the assembly code of bench/commandCost.c: for every command that can be executed in a loop and every legal
+ * combination of operand kinds, a harness function is created that executes the translation of the command in a loop
+ * and measures the elapsed cycles using rdtscp. The translation is created by translateToAssembly(), so the code
+ * measured is exactly the code the compiler generates.
+ *
+ * Every harness function has the signature uint64_t harness(uint64_t iterations, void* buffer). Before every execution,
+ * rsp is restored and the operand registers are reset: registers used as pointers point into the buffer, all other
+ * registers contain 10050. This is over 9000 and its lowest byte (66) is over the 8 bit truncation of 9000 (40), so that
+ * "it's over 9000" never halts, whatever the register size. The calibration harness does the same without
+ * executing a command, so that the loop overhead can be subtracted.
+ * A table of all harness functions (memeasmBenchTable) is written at the end. Commands whose translation is rejected by
+ * the assembler are listed in the table without a function.
+ *
+ * Usage: bench/commandCostGenerator > commandCost.s (x86-64 Linux only)
+ */
+
+#include "../compiler/commands.h"
+#include "../compiler/analyser/parameters.h"
+#include "../compiler/translator/translator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern const struct command commandList[];
+
+/*
+ * Commands that are measured. All others cannot be executed in a loop: they define functions or labels, return, jump
+ * away (upgrade, banana, monke, confused stonks), crash (guess I'll die, refuses to elaborate, Houston, it's a trap),
+ * loop forever (you shall not pass), print or read characters, or do not assemble (wait, that's illegal)
+ */
+static const uint8_t measuredOpcodes[] = {4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 26, 28, 34, 36, 37, 41, 42, 44};
+
+#define WHO_WOULD_WIN_OPCODE 26
+#define WINS_OPCODE 27
+#define CORPORATE_OPCODE 28
+#define SAME_PICTURE_OPCODE 29
+#define RDRAND_OPCODE 41
+
+#define CALLEE_NAME "memeasmBenchCallee"
+
+//Operand kinds that are combined, in the order of the type bits. Operand 0 uses the rbx family, operand 1 the rsi family
+static const char* const operandNames[2][6] = {
+    {"rbx", "ebx", "bx", "bl", "42", "a"},
+    {"rsi", "esi", "si", "sil", "42", "a"}
+};
+
+struct harness {
+    char description[256];
+    unsigned flags;
+};
+#define HARNESS_REQUIRES_RDRAND 1
+#define HARNESS_DOES_NOT_ASSEMBLE 2 //The compiler accepts the command, but its translation is rejected by the assembler. No function is written
+
+static char* assemblyHeader; //Everything before the first harness, needed to check if a harness assembles
+
+static struct harness* harnesses = NULL;
+static unsigned harnessCount = 0;
+
+/**
+ * Writes the start of a harness function up to the beginning of the loop body, including the register reset
+ * @param pointers a bit mask of the operands that are used as pointers
+ */
+static void writeHarnessStart(FILE* out, unsigned index, unsigned pointers) {
+    fprintf(out, "\n.LbenchHarness_%u:\n", index);
+    fprintf(out, "\tpush rbx\n\tpush rbp\n\tpush r12\n\tpush r13\n\tpush r14\n\tpush r15\n");
+    fprintf(out, "\tmov r15, rdi\n\tmov r12, rsi\n\tmov r13, 10050\n\tmov rbp, rsp\n");
+    fprintf(out, "\tlfence\n\trdtscp\n\tshl rdx, 32\n\tor rax, rdx\n\tmov r14, rax\n");
+    fprintf(out, ".LbenchLoop_%u:\n", index);
+    fprintf(out, "\tmov rsp, rbp\n\tmov rax, r13\n\tmov rdx, r13\n");
+    fprintf(out, "\tmov rbx, %s\n\tmov rsi, %s\n", (pointers & 1) ? "r12" : "r13", (pointers & 2) ? "r12" : "r13");
+}
+
+static void writeHarnessEnd(FILE* out, unsigned index) {
+    fprintf(out, "\tdec r15\n\tjnz .LbenchLoop_%u\n", index);
+    fprintf(out, "\trdtscp\n\tlfence\n\tshl rdx, 32\n\tor rax, rdx\n\tsub rax, r14\n\tmov rsp, rbp\n");
+    fprintf(out, "\tpop r15\n\tpop r14\n\tpop r13\n\tpop r12\n\tpop rbp\n\tpop rbx\n\tret\n");
+}
+
+static struct harness* addHarness(void) {
+    harnesses = realloc(harnesses, (harnessCount + 1) * sizeof(struct harness));
+    if(harnesses == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    memset(&harnesses[harnessCount], 0, sizeof(struct harness));
+    return &harnesses[harnessCount++];
+}
+
+/**
+ * Writes the source line of a command (with "do you know de wey" after a pointer operand) into the description
+ */
+static void describeCommand(struct parsedCommand* command, char* description, size_t size) {
+    const char* pattern = commandList[command->opcode].pattern;
+    size_t length = 0;
+    unsigned parameter = 0;
+    for(size_t i = 0; pattern[i] != '\0' && length + 32 < size; i++) {
+        if(strncmp(pattern + i, "{p}", 3) == 0) {
+            length += snprintf(description + length, size - length, "%s%s", command->parameters[parameter],
+                               (command->isPointer == parameter + 1) ? " do you know de wey" : "");
+            parameter++;
+            i += 2;
+        } else {
+            description[length++] = pattern[i];
+        }
+    }
+    description[length] = '\0';
+}
+
+/**
+ * Assembles the code after the header using gcc
+ * @return true if the code is valid assembly
+ */
+static bool assembles(const char* code, size_t size) {
+    FILE* assembler = popen("gcc -c -x assembler -o /dev/null - 2> /dev/null", "w");
+    if(assembler == NULL) {
+        return false;
+    }
+    fputs(assemblyHeader, assembler);
+    fwrite(code, 1, size, assembler);
+    return pclose(assembler) == 0;
+}
+
+/**
+ * Writes a harness for the command if its operands are legal
+ */
+static void writeCommandHarness(FILE* out, struct compileState* compileState, uint8_t opcode, const unsigned kinds[2], uint8_t isPointer) {
+    struct parsedCommand command = {.opcode = opcode, .isPointer = isPointer, .lineNum = 1, .translate = true};
+    unsigned usedParameters = commandList[opcode].usedParameters;
+    for(unsigned i = 0; i < usedParameters; i++) {
+        command.parameters[i] = strdup((commandList[opcode].allowedParamTypes[i] & PARAM_FUNC_NAME) ? CALLEE_NAME : operandNames[i][kinds[i]]);
+    }
+
+    compileState->compilerErrors = 0;
+    checkParameters(&command, "commandCost.memeasm", compileState);
+    if(compileState->compilerErrors == 0) {
+        unsigned index = harnessCount;
+        struct harness* harness = addHarness();
+        char line[200];
+        describeCommand(&command, line, sizeof(line));
+        snprintf(harness->description, sizeof(harness->description), "%2u  %s", opcode, line);
+        if(opcode == RDRAND_OPCODE) {
+            harness->flags |= HARNESS_REQUIRES_RDRAND;
+        }
+
+        //The harness is written into a buffer first, since it is only used if it assembles
+        char* code = NULL;
+        size_t codeSize = 0;
+        FILE* harnessOut = open_memstream(&code, &codeSize);
+
+        //The label of a jump marker depends on the file index, so every harness uses its own
+        writeHarnessStart(harnessOut, index, (isPointer == 1 ? 1 : 0) | (isPointer == 2 ? 2 : 0));
+        translateToAssembly(compileState, "", &command, index, false, harnessOut);
+        //Comparisons jump to their companion labels, which are placed directly after them
+        if(opcode == WHO_WOULD_WIN_OPCODE) {
+            for(unsigned i = 0; i < 2; i++) {
+                if(i == 1 && strcmp(command.parameters[0], command.parameters[1]) == 0) {
+                    break;
+                }
+                //The operands of both commands are translated the same way (e.g. decimal numbers in hex)
+                struct parsedCommand wins = {.opcode = WINS_OPCODE, .parameters = {strdup(command.parameters[i])}, .translate = true};
+                checkParameters(&wins, "commandCost.memeasm", compileState);
+                translateToAssembly(compileState, "", &wins, index, false, harnessOut);
+                free(wins.parameters[0]);
+            }
+        } else if(opcode == CORPORATE_OPCODE) {
+            struct parsedCommand samePicture = {.opcode = SAME_PICTURE_OPCODE, .translate = true};
+            translateToAssembly(compileState, "", &samePicture, index, false, harnessOut);
+        }
+        writeHarnessEnd(harnessOut, index);
+        fclose(harnessOut);
+
+        if(assembles(code, codeSize)) {
+            fwrite(code, 1, codeSize, out);
+        } else {
+            harness->flags |= HARNESS_DOES_NOT_ASSEMBLE;
+        }
+        free(code);
+    }
+
+    for(unsigned i = 0; i < usedParameters; i++) {
+        free(command.parameters[i]);
+    }
+}
+
+/**
+ * Writes a harness for every legal combination of operand kinds of the command. 64 bit registers are also used as pointers
+ */
+static void writeCommandHarnesses(FILE* out, struct compileState* compileState, uint8_t opcode) {
+    unsigned usedParameters = commandList[opcode].usedParameters;
+    unsigned kindCount[2] = {1, 1};
+    for(unsigned i = 0; i < usedParameters; i++) {
+        //Function names are not combined, the callee is always used
+        kindCount[i] = (commandList[opcode].allowedParamTypes[i] & PARAM_FUNC_NAME) ? 1 : 6;
+    }
+
+    unsigned kinds[2];
+    for(kinds[0] = 0; kinds[0] < kindCount[0]; kinds[0]++) {
+        for(kinds[1] = 0; kinds[1] < kindCount[1]; kinds[1]++) {
+            bool allowed = true;
+            for(unsigned i = 0; i < usedParameters; i++) {
+                if(!(commandList[opcode].allowedParamTypes[i] & PARAM_FUNC_NAME) && !(commandList[opcode].allowedParamTypes[i] & (1 << kinds[i]))) {
+                    allowed = false;
+                }
+            }
+            if(!allowed) {
+                continue;
+            }
+
+            writeCommandHarness(out, compileState, opcode, kinds, 0);
+            //Labels of comparisons contain the operands, which cannot be pointers
+            for(unsigned i = 0; i < usedParameters && opcode != WHO_WOULD_WIN_OPCODE; i++) {
+                if(kinds[i] == 0 && !(commandList[opcode].allowedParamTypes[i] & PARAM_FUNC_NAME)) {
+                    writeCommandHarness(out, compileState, opcode, kinds, (uint8_t) (i + 1));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Writes a harness executing the given instructions instead of a command, to compare a template with the raw instruction
+ */
+static void writeRawHarness(FILE* out, const char* description, const char* body) {
+    unsigned index = harnessCount;
+    struct harness* harness = addHarness();
+    snprintf(harness->description, sizeof(harness->description), "raw %s", description);
+    writeHarnessStart(out, index, 0);
+    fprintf(out, "\t%s\n", body);
+    writeHarnessEnd(out, index);
+}
+
+/**
+ * Writes a string with quotes and backslashes escaped
+ */
+static void writeString(FILE* out, const char* string) {
+    fputc('"', out);
+    for(; *string != '\0'; string++) {
+        if(*string == '"' || *string == '\\') {
+            fputc('\\', out);
+        }
+        fputc(*string, out);
+    }
+    fputc('"', out);
+}
+
+int main(void) {
+    //Errors are collected instead of printed, illegal operand combinations are skipped
+    struct compileState compileState = {
+        .compileMode = noob,
+        .optimisationLevel = none,
+        .translateMode = intSISD,
+        .outputMode = assemblyFile,
+        .logLevel = normal,
+        .collectDiagnostics = true,
+        .computedIndex = COMPUTED_INDEX_START
+    };
+
+    FILE* out = stdout;
+    size_t headerSize;
+    FILE* headerOut = open_memstream(&assemblyHeader, &headerSize);
+    writeAssemblyHeader(headerOut);
+    fprintf(headerOut, "\n" CALLEE_NAME ":\n\tret\n");
+    fclose(headerOut);
+    fputs(assemblyHeader, out);
+
+    //The calibration harness must be the first one
+    unsigned index = harnessCount;
+    snprintf(addHarness()->description, sizeof(harnesses[0].description), "loop overhead");
+    writeHarnessStart(out, index, 0);
+    writeHarnessEnd(out, index);
+
+    writeRawHarness(out, "idiv rsi", "cqo\n\tidiv rsi");
+    writeRawHarness(out, "imul rbx, rsi", "imul rbx, rsi");
+    for(unsigned i = 0; i < sizeof(measuredOpcodes); i++) {
+        writeCommandHarnesses(out, &compileState, measuredOpcodes[i]);
+    }
+
+    //Table of all harnesses, terminated by a NULL description
+    fprintf(out, "\n.data\n.balign 8\n.global memeasmBenchTable\nmemeasmBenchTable:\n");
+    for(unsigned i = 0; i < harnessCount; i++) {
+        if(harnesses[i].flags & HARNESS_DOES_NOT_ASSEMBLE) {
+            fprintf(out, "\t.quad 0, .LbenchDescription_%u, %u\n", i, harnesses[i].flags);
+        } else {
+            fprintf(out, "\t.quad .LbenchHarness_%u, .LbenchDescription_%u, %u\n", i, i, harnesses[i].flags);
+        }
+    }
+    fprintf(out, "\t.quad 0, 0, 0\n");
+    for(unsigned i = 0; i < harnessCount; i++) {
+        fprintf(out, ".LbenchDescription_%u: .asciz ", i);
+        writeString(out, harnesses[i].description);
+        fputc('\n', out);
+    }
+
+    for(size_t i = 0; i < compileState.diagnosticCount; i++) {
+        free(compileState.diagnostics[i].message);
+    }
+    free(compileState.diagnostics);
+    free(harnesses);
+    free(assemblyHeader);
+    return 0;
+}
@@ -0,0 +1,295 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Generates a valid MemeAssembly program of the given number of lines, used by bench/run.sh to measure the compiler.
+ * The shape of the program can be changed using the options, see printUsage(). The same options and seed always
+ * result in the same program
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+struct shape {
+    unsigned long lines;
+    unsigned long commandsPerFunction;
+    unsigned labelPercentage;
+    unsigned commentPercentage;
+    unsigned pointerPercentage;
+    unsigned callPercentage;
+    unsigned garbagePercentage;
+    unsigned nameLength; //Minimum length of function names, jump labels and comments. Large values result in long lines
+};
+
+static const char* const registers[] = {"rax", "rbx", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+#define NUMBER_OF_REGISTERS (sizeof(registers) / sizeof(char*))
+
+static uint64_t randomState = 0x9E3779B97F4A7C15;
+
+/**
+ * @return a random number in [0, limit) (xorshift64*)
+ */
+static unsigned long randomBelow(unsigned long limit) {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return (unsigned long) ((randomState * 0x2545F4914F6CDD1D) % limit);
+}
+
+static const char* randomRegister(void) {
+    return registers[randomBelow(NUMBER_OF_REGISTERS)];
+}
+
+/**
+ * Prints a function name. Names are padded with 'x' to the minimum length
+ */
+static void printFunctionName(unsigned long function, struct shape* shape) {
+    if(function == 0) {
+        printf("main");
+        return;
+    }
+    int length = printf("f%lu", function);
+    for(unsigned i = length; i < shape->nameLength; i++) {
+        putchar('x');
+    }
+}
+
+/**
+ * Prints a monke jump label. Labels may only consist of 'u' and 'a' and must contain both, so the number is encoded
+ * in binary after the prefix "ua". Labels are padded with 'u' to the minimum length
+ */
+static void printLabel(unsigned long label, struct shape* shape) {
+    unsigned length = 2;
+    printf("ua");
+    do {
+        putchar((label & 1) ? 'a' : 'u');
+        label >>= 1;
+        length++;
+    } while(label != 0);
+    //The number is terminated with an 'a', so that the padding cannot make two labels equal
+    putchar('a');
+    for(length++; length < shape->nameLength; length++) {
+        putchar('u');
+    }
+}
+
+/**
+ * Prints a line of random characters. In bully mode, it is turned into a random command
+ */
+static void printGarbage(struct shape* shape) {
+    unsigned length = 8 + randomBelow(shape->nameLength + 24);
+    for(unsigned i = 0; i < length; i++) {
+        putchar((randomBelow(6) == 0) ? ' ' : (int) ('a' + randomBelow(26)));
+    }
+    putchar('\n');
+}
+
+static void printComment(struct shape* shape) {
+    printf("What the hell happened here? ");
+    unsigned length = 8 + randomBelow(shape->nameLength + 24);
+    for(unsigned i = 0; i < length; i++) {
+        putchar((randomBelow(6) == 0) ? ' ' : (int) ('a' + randomBelow(26)));
+    }
+    putchar('\n');
+}
+
+/**
+ * Prints a command that is not a label, comment or pointer operation
+ */
+static void printCommand(unsigned long functionCount, struct shape* shape) {
+    switch(randomBelow(10)) {
+        case 0:
+            printf("    stonks %s\n", randomRegister());
+            break;
+        case 1:
+            printf("    not stonks %s\n", randomRegister());
+            break;
+        case 2:
+            printf("    upvote %s\n", randomRegister());
+            break;
+        case 3:
+            printf("    downvote %s\n", randomRegister());
+            break;
+        case 4:
+            printf("    %s units are ready, with %lu more well on the way\n", randomRegister(), randomBelow(1000));
+            break;
+        case 5:
+            printf("    %s is getting out of hand, now there are %s of them\n", randomRegister(), randomRegister());
+            break;
+        case 6:
+            printf("    sneak 100 %s\n", randomRegister());
+            break;
+        case 7:
+            printf("    what can I say except %c\n", (int) ('a' + randomBelow(26)));
+            break;
+        case 8:
+            printf("    ");
+            printFunctionName(randomBelow(functionCount), shape);
+            printf(": whomst has summoned the almighty one\n");
+            break;
+        default:
+            printf("    %s is brilliant, but I like %s\n", randomRegister(), randomRegister());
+            break;
+    }
+}
+
+/**
+ * Prints the body of a function
+ * @param nextLabel the number of the next label, labels are numbered across the whole program
+ */
+static void printFunctionBody(unsigned long commands, unsigned long functionCount, unsigned long* nextLabel, struct shape* shape) {
+    unsigned long firstLabel = *nextLabel;
+    for(unsigned long i = 0; i < commands; i++) {
+        unsigned long roll = randomBelow(100);
+        if(roll < shape->garbagePercentage) {
+            printGarbage(shape);
+            continue;
+        }
+        roll -= shape->garbagePercentage;
+        if(roll < shape->commentPercentage) {
+            printComment(shape);
+            continue;
+        }
+        roll -= shape->commentPercentage;
+        if(roll < shape->labelPercentage) {
+            //Jumps only go to labels of the same function
+            if(*nextLabel == firstLabel || randomBelow(2) == 0) {
+                printf("    monke ");
+                printLabel((*nextLabel)++, shape);
+            } else {
+                printf("    return to monke ");
+                printLabel(firstLabel + randomBelow(*nextLabel - firstLabel), shape);
+            }
+            putchar('\n');
+            continue;
+        }
+        roll -= shape->labelPercentage;
+        if(roll < shape->pointerPercentage) {
+            if(randomBelow(2) == 0) {
+                printf("    %s is brilliant, but I like %s do you know de wey\n", randomRegister(), randomRegister());
+            } else {
+                printf("    %s do you know de wey is brilliant, but I like %s\n", randomRegister(), randomRegister());
+            }
+            continue;
+        }
+        roll -= shape->pointerPercentage;
+        if(roll < shape->callPercentage) {
+            printf("    ");
+            printFunctionName(randomBelow(functionCount), shape);
+            printf(": whomst has summoned the almighty one\n");
+            continue;
+        }
+        printCommand(functionCount, shape);
+    }
+}
+
+static void printUsage(char* programName) {
+    fprintf(stderr, "Usage: %s [options] lines\n", programName);
+    fprintf(stderr, "Prints a valid MemeAssembly program with the given number of lines\n");
+    fprintf(stderr, " -f n \t- commands per function (default: 40)\n");
+    fprintf(stderr, " -l n \t- percentage of monke jump labels and jumps (default: 10)\n");
+    fprintf(stderr, " -c n \t- percentage of comments (default: 10)\n");
+    fprintf(stderr, " -p n \t- percentage of commands with a pointer operand (default: 10)\n");
+    fprintf(stderr, " -k n \t- percentage of function calls, in addition to those among the other commands (default: 0)\n");
+    fprintf(stderr, " -b n \t- percentage of garbage lines, which only compile in bully mode (default: 0)\n");
+    fprintf(stderr, " -w n \t- minimum length of function names, labels and comments, for long lines (default: 8)\n");
+    fprintf(stderr, " -s n \t- seed of the random generator (default: 1)\n");
+}
+
+/**
+ * Parses an unsigned number
+ * @return false if the string is not a number
+ */
+static bool parseNumber(const char* string, unsigned long* number) {
+    char* end;
+    if(string[0] < '0' || string[0] > '9') {
+        return false;
+    }
+    *number = strtoul(string, &end, 10);
+    return *end == '\0';
+}
+
+int main(int argc, char* argv[]) {
+    struct shape shape = {
+        .commandsPerFunction = 40,
+        .labelPercentage = 10,
+        .commentPercentage = 10,
+        .pointerPercentage = 10,
+        .garbagePercentage = 0,
+        .nameLength = 8
+    };
+    unsigned long seed = 1;
+
+    int opt;
+    while((opt = getopt(argc, argv, "f:l:c:p:k:b:w:s:")) != -1) {
+        unsigned long value;
+        if(opt == '?' || !parseNumber(optarg, &value)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        switch(opt) {
+            case 'f': shape.commandsPerFunction = value; break;
+            case 'l': shape.labelPercentage = value; break;
+            case 'c': shape.commentPercentage = value; break;
+            case 'p': shape.pointerPercentage = value; break;
+            case 'k': shape.callPercentage = value; break;
+            case 'b': shape.garbagePercentage = value; break;
+            case 'w': shape.nameLength = value; break;
+            case 's': seed = value; break;
+        }
+    }
+    if(optind != argc - 1 || !parseNumber(argv[optind], &shape.lines) || shape.commandsPerFunction == 0
+       || shape.labelPercentage + shape.commentPercentage + shape.pointerPercentage + shape.callPercentage + shape.garbagePercentage > 100) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    for(unsigned long i = 0; i <= seed % 64; i++) {
+        randomState += seed;
+        randomBelow(1);
+    }
+
+    //Every function consists of its definition, its commands and a return. The remaining lines form a shorter last function
+    unsigned long functionLines = shape.commandsPerFunction + 2;
+    unsigned long functionCount = shape.lines / functionLines;
+    unsigned long remainingLines = shape.lines % functionLines;
+    if(remainingLines >= 2) {
+        functionCount++;
+    }
+
+    unsigned long nextLabel = 0;
+    unsigned long printedLines = 0;
+    for(unsigned long function = 0; function < functionCount; function++) {
+        unsigned long commands = (shape.lines - printedLines >= functionLines) ? shape.commandsPerFunction : shape.lines - printedLines - 2;
+        printf("I like to have fun, fun, fun, fun, fun, fun, fun, fun, fun, fun ");
+        printFunctionName(function, &shape);
+        putchar('\n');
+        printFunctionBody(commands, functionCount, &nextLabel, &shape);
+        printf("    right back at ya, buckaroo\n");
+        printedLines += commands + 2;
+    }
+    //Less than two lines are left, which cannot form a function
+    for(; printedLines < shape.lines; printedLines++) {
+        putchar('\n');
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Micro-benchmarks of parseLine(), checkParameters() and translateToAssembly(). Build and run them with
+ * "make bench-micro" (Linux only, since allocations are counted by wrapping malloc & co. using ld's --wrap).
+ * Usage: bench/micro [iterations]
+ * For every command pattern, operand kind and translation template, the average time and the number of allocations
+ * per call are printed. parseLine() compares a line with the patterns in the order of commandList, so the opcode of a
+ * command is its position: opcode 0 is the best case, an invalid line the worst case
+ */
+
+#include "../compiler/commands.h"
+#include "../compiler/parser/fileParser.h"
+#include "../compiler/analyser/parameters.h"
+#include "../compiler/translator/translator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern const struct command commandList[];
+
+/// Allocation counting
+
+static size_t allocations = 0;
+static bool countAllocations = false;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+char* __real_strdup(const char* string);
+char* __real_strndup(const char* string, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocations += countAllocations;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocations += countAllocations;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    allocations += countAllocations;
+    return __real_realloc(pointer, size);
+}
+
+char* __wrap_strdup(const char* string) {
+    allocations += countAllocations;
+    return __real_strdup(string);
+}
+
+char* __wrap_strndup(const char* string, size_t size) {
+    allocations += countAllocations;
+    return __real_strndup(string, size);
+}
+
+/// Measurement
+
+struct measurement {
+    double startTime;
+    size_t startAllocations;
+};
+
+static double currentTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static void startMeasurement(struct measurement* measurement) {
+    measurement->startAllocations = allocations;
+    countAllocations = true;
+    measurement->startTime = currentTime();
+}
+
+/**
+ * Prints the time and allocations per call since startMeasurement()
+ */
+static void endMeasurement(struct measurement* measurement, unsigned iterations, const char* label, const char* description) {
+    double seconds = currentTime() - measurement->startTime;
+    countAllocations = false;
+    printf("  %-14s %10.1f %8.2f  %s\n", label, seconds * 1e9 / iterations,
+           (double) (allocations - measurement->startAllocations) / iterations, description);
+}
+
+/// Sample commands
+
+/**
+ * @return a parameter of the given type (one bit of allowedParamTypes)
+ */
+static const char* sampleParameter(uint8_t paramType) {
+    switch(paramType) {
+        case PARAM_REG64: return "rax";
+        case PARAM_REG32: return "eax";
+        case PARAM_REG16: return "ax";
+        case PARAM_REG8: return "al";
+        case PARAM_DECIMAL: return "42";
+        case PARAM_CHAR: return "a";
+        case PARAM_MONKE_LABEL: return "uaua";
+        default: return "main";
+    }
+}
+
+/**
+ * @return the lowest bit that is set, i.e. the first type checkParameters() tries
+ */
+static uint8_t lowestType(uint8_t types) {
+    return types & -types;
+}
+
+/**
+ * Creates a line for the given opcode by replacing every {p} of its pattern
+ * @param firstType the type of the first parameter, the other parameters use the same type if allowed, otherwise their first allowed type
+ */
+static void createLine(unsigned opcode, uint8_t firstType, char* line, size_t size) {
+    const char* pattern = commandList[opcode].pattern;
+    size_t length = 0;
+    unsigned parameter = 0;
+    for(size_t i = 0; pattern[i] != '\0' && length + 8 < size; i++) {
+        if(strncmp(pattern + i, "{p}", 3) == 0) {
+            uint8_t allowedTypes = commandList[opcode].allowedParamTypes[parameter];
+            uint8_t type = (parameter == 0 || (allowedTypes & firstType) != 0) ? firstType : lowestType(allowedTypes);
+            length += snprintf(line + length, size - length, "%s", sampleParameter(type));
+            parameter++;
+            i += 2;
+        } else {
+            line[length++] = pattern[i];
+        }
+    }
+    line[length] = '\0';
+}
+
+static void freeCommand(struct parsedCommand* command) {
+    for(unsigned i = 0; i < commandList[command->opcode].usedParameters; i++) {
+        free(command->parameters[i]);
+    }
+}
+
+/**
+ * Parses and checks a line. The parameters of the result need to be freed using freeCommand()
+ * @return false if the line contains errors
+ */
+static bool parseSample(char* line, struct compileState* compileState, struct parsedCommand* command) {
+    compileState->compilerErrors = 0;
+    *command = parseLine("micro.memeasm", 1, line, compileState);
+    if(command->opcode >= NUMBER_OF_COMMANDS - 2) {
+        freeCommand(command);
+        return false;
+    }
+    checkParameters(command, "micro.memeasm", compileState);
+    if(compileState->compilerErrors > 0) {
+        freeCommand(command);
+        return false;
+    }
+    return true;
+}
+
+/// Benchmarks
+
+static void benchmarkParseLine(struct compileState* compileState, unsigned iterations) {
+    printf("parseLine\n  %-14s %10s %8s  %s\n", "opcode", "ns/call", "allocs", "line");
+    struct parsedCommand* results = malloc(iterations * sizeof(struct parsedCommand));
+
+    for(unsigned opcode = 0; opcode <= NUMBER_OF_COMMANDS - 2; opcode++) {
+        char line[256];
+        char label[16];
+        if(opcode < NUMBER_OF_COMMANDS - 2) {
+            createLine(opcode, lowestType(commandList[opcode].allowedParamTypes[0]), line, sizeof(line));
+            snprintf(label, sizeof(label), "%u", opcode);
+        } else {
+            //Matches no pattern, so all of them are compared
+            strcpy(line, "this line is not a command");
+            snprintf(label, sizeof(label), "invalid");
+        }
+
+        struct measurement measurement;
+        startMeasurement(&measurement);
+        for(unsigned i = 0; i < iterations; i++) {
+            results[i] = parseLine("micro.memeasm", 1, line, compileState);
+        }
+        endMeasurement(&measurement, iterations, label, line);
+
+        for(unsigned i = 0; i < iterations; i++) {
+            freeCommand(&results[i]);
+        }
+    }
+    free(results);
+}
+
+static void benchmarkCheckParameters(struct compileState* compileState, unsigned iterations) {
+    static const char* const typeNames[] = {"reg64", "reg32", "reg16", "reg8", "decimal", "char", "monke label", "function"};
+    printf("\ncheckParameters\n  %-14s %10s %8s  %s\n", "operand", "ns/call", "allocs", "line");
+    struct parsedCommand* commands = malloc(iterations * sizeof(struct parsedCommand));
+
+    for(unsigned typeIndex = 0; typeIndex < 8; typeIndex++) {
+        uint8_t type = 1 << typeIndex;
+        //Use the first command accepting this type as its first operand
+        char line[256];
+        struct parsedCommand command;
+        bool found = false;
+        for(unsigned opcode = 0; opcode < NUMBER_OF_COMMANDS - 2 && !found; opcode++) {
+            if(commandList[opcode].usedParameters > 0 && (commandList[opcode].allowedParamTypes[0] & type) != 0) {
+                createLine(opcode, type, line, sizeof(line));
+                found = parseSample(line, compileState, &command);
+            }
+        }
+        if(!found) {
+            printf("  %-14s no command accepts this operand\n", typeNames[typeIndex]);
+            continue;
+        }
+
+        //checkParameters() may replace parameters, so every call gets its own copy
+        for(unsigned i = 0; i < iterations; i++) {
+            commands[i] = command;
+            for(unsigned j = 0; j < commandList[command.opcode].usedParameters; j++) {
+                commands[i].parameters[j] = strdup(command.parameters[j]);
+            }
+        }
+
+        struct measurement measurement;
+        startMeasurement(&measurement);
+        for(unsigned i = 0; i < iterations; i++) {
+            checkParameters(&commands[i], "micro.memeasm", compileState);
+        }
+        endMeasurement(&measurement, iterations, typeNames[typeIndex], line);
+
+        for(unsigned i = 0; i < iterations; i++) {
+            freeCommand(&commands[i]);
+        }
+        freeCommand(&command);
+    }
+    free(commands);
+}
+
+static void benchmarkTranslateToAssembly(struct compileState* compileState, unsigned iterations) {
+    printf("\ntranslateToAssembly\n  %-14s %10s %8s  %s\n", "opcode", "ns/call", "allocs", "template");
+    FILE* nullSink = fopen("/dev/null", "w");
+    if(nullSink == NULL) {
+        perror("Failed to open /dev/null");
+        return;
+    }
+
+    for(unsigned opcode = 0; opcode < NUMBER_OF_COMMANDS - 2; opcode++) {
+        char line[256];
+        struct parsedCommand command;
+        createLine(opcode, lowestType(commandList[opcode].allowedParamTypes[0]), line, sizeof(line));
+        if(!parseSample(line, compileState, &command)) {
+            printf("  %-14u could not create a valid command from \"%s\"\n", opcode, line);
+            continue;
+        }
+
+        char label[16];
+        snprintf(label, sizeof(label), "%u", opcode);
+        char description[128];
+        //Templates may contain line breaks, which are only printed up to the first one
+        snprintf(description, sizeof(description), "%.*s", (int) strcspn(commandList[opcode].translationPattern, "\n"), commandList[opcode].translationPattern);
+
+        struct measurement measurement;
+        startMeasurement(&measurement);
+        for(unsigned i = 0; i < iterations; i++) {
+            translateToAssembly(compileState, "main", &command, 0, false, nullSink);
+        }
+        fflush(nullSink);
+        endMeasurement(&measurement, iterations, label, description);
+        freeCommand(&command);
+    }
+    fclose(nullSink);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned iterations = 20000;
+    if(argc > 1) {
+        iterations = (unsigned) strtoul(argv[1], NULL, 10);
+    }
+    if(argc > 2 || iterations == 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    //Errors are collected instead of printed, so that invalid samples can be skipped silently
+    struct compileState compileState = {
+        .compileMode = noob,
+        .optimisationLevel = none,
+        .translateMode = intSISD,
+        .outputMode = assemblyFile,
+        .logLevel = normal,
+        .collectDiagnostics = true,
+        .computedIndex = COMPUTED_INDEX_START
+    };
+
+    printf("%u iterations per benchmark\n\n", iterations);
+    benchmarkParseLine(&compileState, iterations);
+    benchmarkCheckParameters(&compileState, iterations);
+    benchmarkTranslateToAssembly(&compileState, iterations);
+
+    for(size_t i = 0; i < compileState.diagnosticCount; i++) {
+        free(compileState.diagnostics[i].message);
+    }
+    free(compileState.diagnostics);
+    return 0;
+}
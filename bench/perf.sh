@@ -0,0 +1,34 @@
+#!/bin/sh
+# This file is part of the MemeAssembly compiler.
+#
+# Runs the compiler throughput benchmark (bench/run.sh) and the runtime benchmark of the generated code
+# (bench/runtime.sh) with repeated runs and prints both results as one JSON object. "make perf-baseline" stores the
+# output in bench/baseline.json, "make perf-check" compares a new run against it using bench/perfCheck.
+#
+# Usage: bench/perf.sh [-m memeasm] [-s "sizes"] [-S "shapes"] [-n runs] [-r repetitions] > perf.json
+
+MEMEASM=./memeasm
+SIZES="5000 50000"
+SHAPES="default functions labels longlines comments pointers bully"
+RUNS=7
+REPETITIONS=9
+
+while getopts "m:s:S:n:r:" opt; do
+    case $opt in
+        m) MEMEASM=$OPTARG ;;
+        s) SIZES=$OPTARG ;;
+        S) SHAPES=$OPTARG ;;
+        n) RUNS=$OPTARG ;;
+        r) REPETITIONS=$OPTARG ;;
+        *) echo "Usage: $0 [-m memeasm] [-s \"sizes\"] [-S \"shapes\"] [-n runs] [-r repetitions]" >&2; exit 1 ;;
+    esac
+done
+
+BENCH_DIR=$(dirname "$0")
+
+printf '{"throughput":'
+"$BENCH_DIR/run.sh" -m "$MEMEASM" -g "$BENCH_DIR/generate" -s "$SIZES" -S "$SHAPES" -n "$RUNS" || exit 1
+printf ',"runtime":'
+# A program that computes wrong results is reported by bench/perfCheck, so the exit code is not checked here
+"$BENCH_DIR/runtime.sh" -m "$MEMEASM" -s 2 -r "$REPETITIONS"
+printf '}\n'
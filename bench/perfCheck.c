@@ -0,0 +1,490 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Performance regression gate. Compares two outputs of bench/perf.sh (a checked-in baseline and a new run) and fails
+ * if a compiler phase or a generated program got significantly slower.
+ * Every metric is a set of repeated measurements. The median and a distribution-free 95% confidence interval of the
+ * median (from the order statistics) are computed for both runs. A metric regressed if its median grew by more than the
+ * threshold, by more than the absolute minimum, and the confidence intervals do not overlap.
+ * Usage: bench/perfCheck [-t threshold percent] [-a minimum milliseconds] [-v] baseline.json current.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+/// A minimal JSON parser, sufficient for the output of the benchmark scripts
+
+typedef enum {jsonNull, jsonBool, jsonNumber, jsonString, jsonArray, jsonObject} jsonType;
+
+struct jsonValue {
+    jsonType type;
+    bool boolean;
+    double number;
+    char* string;
+    size_t count; //Number of elements or members
+    char** keys; //Only used by objects
+    struct jsonValue* items;
+};
+
+struct jsonParser {
+    const char* current;
+    const char* fileName;
+};
+
+static void jsonError(struct jsonParser* parser, const char* message) {
+    fprintf(stderr, "%s: %s near \"%.20s\"\n", parser->fileName, message, parser->current);
+    exit(2);
+}
+
+static void skipWhitespace(struct jsonParser* parser) {
+    while(*parser->current == ' ' || *parser->current == '\t' || *parser->current == '\n' || *parser->current == '\r') {
+        parser->current++;
+    }
+}
+
+static void* checkedRealloc(void* pointer, size_t size) {
+    pointer = realloc(pointer, size);
+    if(pointer == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    return pointer;
+}
+
+/**
+ * Parses a string. Escape sequences other than \" and \\ are kept as they are, since the benchmarks do not produce them
+ */
+static char* parseString(struct jsonParser* parser) {
+    if(*parser->current != '"') {
+        jsonError(parser, "Expected a string");
+    }
+    parser->current++;
+    size_t length = 0;
+    char* string = checkedRealloc(NULL, strlen(parser->current) + 1);
+    while(*parser->current != '"') {
+        if(*parser->current == '\0') {
+            jsonError(parser, "Unterminated string");
+        }
+        if(*parser->current == '\\' && (parser->current[1] == '"' || parser->current[1] == '\\')) {
+            parser->current++;
+        }
+        string[length++] = *parser->current++;
+    }
+    parser->current++;
+    string[length] = '\0';
+    return string;
+}
+
+static void parseValue(struct jsonParser* parser, struct jsonValue* value);
+
+/**
+ * Parses the elements of an array or the members of an object, starting after the opening bracket
+ */
+static void parseElements(struct jsonParser* parser, struct jsonValue* value, char closingBracket) {
+    size_t capacity = 0;
+    skipWhitespace(parser);
+    if(*parser->current == closingBracket) {
+        parser->current++;
+        return;
+    }
+    while(true) {
+        if(value->count == capacity) {
+            capacity = (capacity == 0) ? 8 : capacity * 2;
+            value->items = checkedRealloc(value->items, capacity * sizeof(struct jsonValue));
+            if(value->type == jsonObject) {
+                value->keys = checkedRealloc(value->keys, capacity * sizeof(char*));
+            }
+        }
+
+        skipWhitespace(parser);
+        if(value->type == jsonObject) {
+            value->keys[value->count] = parseString(parser);
+            skipWhitespace(parser);
+            if(*parser->current++ != ':') {
+                jsonError(parser, "Expected ':'");
+            }
+        }
+        parseValue(parser, &value->items[value->count++]);
+
+        skipWhitespace(parser);
+        if(*parser->current == closingBracket) {
+            parser->current++;
+            return;
+        }
+        if(*parser->current++ != ',') {
+            jsonError(parser, "Expected ','");
+        }
+    }
+}
+
+static void parseValue(struct jsonParser* parser, struct jsonValue* value) {
+    memset(value, 0, sizeof(struct jsonValue));
+    skipWhitespace(parser);
+    switch(*parser->current) {
+        case '{':
+            parser->current++;
+            value->type = jsonObject;
+            parseElements(parser, value, '}');
+            break;
+        case '[':
+            parser->current++;
+            value->type = jsonArray;
+            parseElements(parser, value, ']');
+            break;
+        case '"':
+            value->type = jsonString;
+            value->string = parseString(parser);
+            break;
+        default:
+            if(strncmp(parser->current, "true", 4) == 0 || strncmp(parser->current, "false", 5) == 0) {
+                value->type = jsonBool;
+                value->boolean = (*parser->current == 't');
+                parser->current += value->boolean ? 4 : 5;
+            } else if(strncmp(parser->current, "null", 4) == 0) {
+                value->type = jsonNull;
+                parser->current += 4;
+            } else {
+                char* end;
+                value->type = jsonNumber;
+                value->number = strtod(parser->current, &end);
+                if(end == parser->current) {
+                    jsonError(parser, "Unexpected character");
+                }
+                parser->current = end;
+            }
+    }
+}
+
+static void freeJson(struct jsonValue* value) {
+    for(size_t i = 0; i < value->count; i++) {
+        freeJson(&value->items[i]);
+        if(value->type == jsonObject) {
+            free(value->keys[i]);
+        }
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+}
+
+/**
+ * @return the member of an object with the given key and type, or NULL if there is none
+ */
+static struct jsonValue* getMember(struct jsonValue* object, const char* key, jsonType type) {
+    if(object == NULL || object->type != jsonObject) {
+        return NULL;
+    }
+    for(size_t i = 0; i < object->count; i++) {
+        if(strcmp(object->keys[i], key) == 0) {
+            return (object->items[i].type == type) ? &object->items[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+static bool readJsonFile(const char* fileName, struct jsonValue* root) {
+    FILE* file = fopen(fileName, "r");
+    if(file == NULL) {
+        perror(fileName);
+        return false;
+    }
+    char* content = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    size_t bytesRead;
+    do {
+        if(capacity - length < 65536) {
+            capacity = (capacity == 0) ? 65536 : capacity * 2;
+            content = checkedRealloc(content, capacity + 1);
+        }
+        bytesRead = fread(content + length, 1, capacity - length, file);
+        length += bytesRead;
+    } while(bytesRead > 0);
+    fclose(file);
+    content[length] = '\0';
+
+    struct jsonParser parser = {.current = content, .fileName = fileName};
+    parseValue(&parser, root);
+    free(content);
+    if(root->type != jsonObject) {
+        fprintf(stderr, "%s: not an output of bench/perf.sh\n", fileName);
+        return false;
+    }
+    return true;
+}
+
+/// Metrics
+
+struct metric {
+    char name[96];
+    const char* failure; //Why no samples are available (e.g. the compiler timed out), NULL if the run succeeded
+    size_t count;
+    double* samples; //Sorted, in seconds
+};
+
+struct metricList {
+    struct metric* metrics;
+    size_t count;
+    size_t capacity;
+};
+
+static int compareDoubles(const void* a, const void* b) {
+    double difference = *(const double*) a - *(const double*) b;
+    return (difference > 0) - (difference < 0);
+}
+
+static struct metric* addMetric(struct metricList* list, const char* failure) {
+    if(list->count == list->capacity) {
+        list->capacity = (list->capacity == 0) ? 64 : list->capacity * 2;
+        list->metrics = checkedRealloc(list->metrics, list->capacity * sizeof(struct metric));
+    }
+    struct metric* metric = &list->metrics[list->count++];
+    memset(metric, 0, sizeof(struct metric));
+    metric->failure = failure;
+    return metric;
+}
+
+static void setSamples(struct metric* metric, struct jsonValue* array) {
+    metric->samples = checkedRealloc(NULL, (array->count + 1) * sizeof(double));
+    for(size_t i = 0; i < array->count; i++) {
+        if(array->items[i].type == jsonNumber) {
+            metric->samples[metric->count++] = array->items[i].number;
+        }
+    }
+    qsort(metric->samples, metric->count, sizeof(double), compareDoubles);
+    if(metric->count == 0) {
+        metric->failure = "no samples";
+    }
+}
+
+static const char* const phaseNames[] = {"parse", "analyse", "translate", "assemble", "total"};
+
+/**
+ * Collects the duration of every phase of bench/run.sh. If a compilation failed or timed out, all of its phases carry
+ * the status
+ */
+static void collectThroughput(struct jsonValue* root, struct metricList* list) {
+    struct jsonValue* results = getMember(getMember(root, "throughput", jsonObject), "results", jsonArray);
+    if(results == NULL) {
+        return;
+    }
+    for(size_t i = 0; i < results->count; i++) {
+        struct jsonValue* result = &results->items[i];
+        struct jsonValue* shape = getMember(result, "shape", jsonString);
+        struct jsonValue* lines = getMember(result, "lines", jsonNumber);
+        struct jsonValue* status = getMember(result, "status", jsonString);
+        struct jsonValue* seconds = getMember(result, "seconds", jsonObject);
+        if(shape == NULL || lines == NULL || status == NULL) {
+            continue;
+        }
+
+        if(strcmp(status->string, "ok") != 0 || seconds == NULL) {
+            for(size_t j = 0; j < sizeof(phaseNames) / sizeof(phaseNames[0]); j++) {
+                struct metric* metric = addMetric(list, status->string);
+                snprintf(metric->name, sizeof(metric->name), "compile %s %.0f lines: %s", shape->string, lines->number, phaseNames[j]);
+            }
+            continue;
+        }
+        for(size_t j = 0; j < seconds->count; j++) {
+            if(seconds->items[j].type != jsonArray) {
+                continue;
+            }
+            struct metric* metric = addMetric(list, NULL);
+            snprintf(metric->name, sizeof(metric->name), "compile %s %.0f lines: %s", shape->string, lines->number, seconds->keys[j]);
+            setSamples(metric, &seconds->items[j]);
+        }
+    }
+}
+
+/**
+ * Collects the duration of every run of the generated programs of bench/runtime.sh. Wrong results are failures
+ */
+static void collectRuntime(struct jsonValue* root, struct metricList* list) {
+    struct jsonValue* levels = getMember(getMember(root, "runtime", jsonObject), "levels", jsonArray);
+    if(levels == NULL) {
+        return;
+    }
+    for(size_t i = 0; i < levels->count; i++) {
+        struct jsonValue* label = getMember(&levels->items[i], "label", jsonString);
+        struct jsonValue* results = getMember(&levels->items[i], "results", jsonArray);
+        if(label == NULL || results == NULL) {
+            continue;
+        }
+        for(size_t j = 0; j < results->count; j++) {
+            struct jsonValue* program = getMember(&results->items[j], "program", jsonString);
+            struct jsonValue* correct = getMember(&results->items[j], "correct", jsonBool);
+            struct jsonValue* seconds = getMember(&results->items[j], "secondsPerRun", jsonArray);
+            if(program == NULL || seconds == NULL) {
+                continue;
+            }
+            struct metric* metric = addMetric(list, (correct != NULL && !correct->boolean) ? "wrong result" : NULL);
+            snprintf(metric->name, sizeof(metric->name), "run %s %s", program->string, label->string);
+            if(metric->failure == NULL) {
+                setSamples(metric, seconds);
+            }
+        }
+    }
+}
+
+static struct metric* findMetric(struct metricList* list, const char* name) {
+    for(size_t i = 0; i < list->count; i++) {
+        if(strcmp(list->metrics[i].name, name) == 0) {
+            return &list->metrics[i];
+        }
+    }
+    return NULL;
+}
+
+/// Statistics
+
+struct summary {
+    double median;
+    double low; //Bounds of the confidence interval of the median
+    double high;
+};
+
+/**
+ * Computes the median and a 95% confidence interval of the median. The interval is formed by the k-th smallest and the
+ * k-th largest sample, where k is the largest index for which the number of samples below the median, which is
+ * binomially distributed with p = 0.5, falls below it with a probability of at most 2.5%. With less than 6 samples,
+ * no such k exists and the whole range is used
+ */
+static struct summary summarise(struct metric* metric) {
+    size_t n = metric->count;
+    double* samples = metric->samples;
+    struct summary summary;
+    summary.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    double probability = pow(0.5, (double) n); //P(X = i) for X ~ B(n, 0.5)
+    double cumulative = probability; //P(X <= k - 1)
+    size_t k = 1;
+    for(size_t i = 1; i < n / 2 && cumulative + probability * (double) (n - i + 1) / (double) i <= 0.025; i++) {
+        probability *= (double) (n - i + 1) / (double) i;
+        cumulative += probability;
+        k = i + 1;
+    }
+    if(cumulative > 0.025) {
+        k = 1;
+    }
+    summary.low = samples[k - 1];
+    summary.high = samples[n - k];
+    return summary;
+}
+
+/// Comparison
+
+typedef enum {unchanged, improved, regressed, failed} verdict;
+
+static const char* const verdictNames[] = {"", "improved", "REGRESSION", "FAILED"};
+
+int main(int argc, char* argv[]) {
+    double threshold = 10;
+    double minimumMilliseconds = 0.5;
+    bool verbose = false;
+    int opt;
+    while((opt = getopt(argc, argv, "t:a:v")) != -1) {
+        switch(opt) {
+            case 't': threshold = strtod(optarg, NULL); break;
+            case 'a': minimumMilliseconds = strtod(optarg, NULL); break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-t threshold percent] [-a minimum milliseconds] [-v] baseline.json current.json\n", argv[0]);
+                return 2;
+        }
+    }
+    if(argc - optind != 2) {
+        fprintf(stderr, "Usage: %s [-t threshold percent] [-a minimum milliseconds] [-v] baseline.json current.json\n", argv[0]);
+        return 2;
+    }
+
+    struct jsonValue roots[2];
+    struct metricList lists[2] = {0};
+    for(int i = 0; i < 2; i++) {
+        if(!readJsonFile(argv[optind + i], &roots[i])) {
+            return 2;
+        }
+        collectThroughput(&roots[i], &lists[i]);
+        collectRuntime(&roots[i], &lists[i]);
+
+        struct jsonValue* throughput = getMember(&roots[i], "throughput", jsonObject);
+        struct jsonValue* compiler = getMember(throughput, "compiler", jsonString);
+        struct jsonValue* date = getMember(throughput, "date", jsonString);
+        printf("%s %s (memeasm %s, %s)\n", (i == 0) ? "Baseline:" : "Current: ", argv[optind + i],
+               (compiler != NULL) ? compiler->string : "?", (date != NULL) ? date->string : "?");
+    }
+    printf("Medians and 95%% confidence intervals in milliseconds. Threshold: %.1f%%, at least %.2f ms\n\n", threshold, minimumMilliseconds);
+
+    size_t counts[4] = {0};
+    for(size_t i = 0; i < lists[0].count; i++) {
+        struct metric* baseline = &lists[0].metrics[i];
+        struct metric* current = findMetric(&lists[1], baseline->name);
+        if(baseline->failure != NULL) {
+            //Nothing to compare against, e.g. a shape that already timed out when the baseline was recorded
+            if(verbose) {
+                printf("  %-44s  baseline %s\n", baseline->name, baseline->failure);
+            }
+            continue;
+        }
+        struct summary before = summarise(baseline);
+        if(current == NULL || current->failure != NULL) {
+            counts[failed]++;
+            printf("  %-44s  %9.3f [%9.3f, %9.3f] -> %-29s  %s\n", baseline->name, before.median * 1e3, before.low * 1e3,
+                   before.high * 1e3, (current == NULL) ? "missing" : current->failure, verdictNames[failed]);
+            continue;
+        }
+
+        struct summary after = summarise(current);
+        double change = (after.median - before.median) / before.median * 100;
+        bool significant = fabs(after.median - before.median) * 1e3 >= minimumMilliseconds && fabs(change) > threshold;
+        verdict result = unchanged;
+        if(significant && after.low > before.high) {
+            result = regressed;
+        } else if(significant && after.high < before.low) {
+            result = improved;
+        }
+        counts[result]++;
+        if(verbose || result != unchanged) {
+            printf("  %-44s  %9.3f [%9.3f, %9.3f] -> %9.3f [%9.3f, %9.3f]  %+7.1f%%  %s\n", baseline->name,
+                   before.median * 1e3, before.low * 1e3, before.high * 1e3,
+                   after.median * 1e3, after.low * 1e3, after.high * 1e3, change, verdictNames[result]);
+        }
+    }
+    for(size_t i = 0; i < lists[1].count; i++) {
+        if(verbose && findMetric(&lists[0], lists[1].metrics[i].name) == NULL) {
+            printf("  %-44s  not in the baseline\n", lists[1].metrics[i].name);
+        }
+    }
+
+    printf("\n%zu regression(s), %zu failure(s), %zu improvement(s), %zu unchanged\n",
+           counts[regressed], counts[failed], counts[improved], counts[unchanged]);
+
+    for(int i = 0; i < 2; i++) {
+        for(size_t j = 0; j < lists[i].count; j++) {
+            free(lists[i].metrics[j].samples);
+        }
+        free(lists[i].metrics);
+        freeJson(&roots[i]);
+    }
+    return (counts[regressed] > 0 || counts[failed] > 0) ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+#!/bin/sh
+# This file is part of the MemeAssembly compiler.
+#
+# Measures the throughput of the compiler on generated programs of different sizes and shapes and prints the results
+# as JSON. Every run uses -ftime-report, so the duration and peak memory usage of each phase are reported separately.
+# With -n, every program is compiled several times. "seconds" then contains the duration of every run for each phase,
+# while linesPerSecond and report describe the first run.
+#
+# Usage: bench/run.sh [-m memeasm] [-g generator] [-s "sizes"] [-S "shapes"] [-t timeout] [-n runs] > results.json
+
+MEMEASM=./memeasm
+GENERATOR=bench/generate
+SIZES="1000 10000 100000 1000000 10000000"
+SHAPES="default functions labels longlines comments pointers bully"
+TIMEOUT=600
+RUNS=1
+
+while getopts "m:g:s:S:t:n:" opt; do
+    case $opt in
+        m) MEMEASM=$OPTARG ;;
+        g) GENERATOR=$OPTARG ;;
+        s) SIZES=$OPTARG ;;
+        S) SHAPES=$OPTARG ;;
+        t) TIMEOUT=$OPTARG ;;
+        n) RUNS=$OPTARG ;;
+        *) echo "Usage: $0 [-m memeasm] [-g generator] [-s \"sizes\"] [-S \"shapes\"] [-t timeout] [-n runs]" >&2; exit 1 ;;
+    esac
+done
+
+# Options of the generator and the compiler for each shape
+generatorOptions() {
+    case $1 in
+        default) echo "" ;;
+        functions) echo "-f 2" ;;
+        labels) echo "-l 60" ;;
+        longlines) echo "-w 400" ;;
+        comments) echo "-c 60" ;;
+        pointers) echo "-p 60" ;;
+        bully) echo "-b 30" ;;
+        *) echo "Unknown shape: $1" >&2; exit 1 ;;
+    esac
+}
+
+compilerOptions() {
+    if [ "$1" = bully ]; then
+        echo "-fcompile-mode bully"
+    fi
+}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+printf '{"compiler":"%s","date":"%s","results":[' "$($MEMEASM -v | head -n 1)" "$(date -u +%Y-%m-%dT%H:%M:%SZ)"
+first=true
+for shape in $SHAPES; do
+    for size in $SIZES; do
+        echo "Running $shape with $size lines" >&2
+        "$GENERATOR" $(generatorOptions "$shape") "$size" > "$WORKDIR/input.memeasm" || exit 1
+
+        : > "$WORKDIR/reports"
+        status=ok
+        run=0
+        while [ $run -lt "$RUNS" ] && [ $status = ok ]; do
+            timeout "$TIMEOUT" "$MEMEASM" $(compilerOptions "$shape") -ftime-report -S -o "$WORKDIR/output.S" "$WORKDIR/input.memeasm" \
+                > /dev/null 2> "$WORKDIR/stderr"
+            exitCode=$?
+            runReport=$(grep '^{"commands"' "$WORKDIR/stderr" | tail -n 1)
+            if [ $exitCode -eq 124 ]; then
+                status=timeout
+            elif [ $exitCode -ne 0 ] || [ -z "$runReport" ]; then
+                status=failed
+            else
+                echo "$runReport" >> "$WORKDIR/reports"
+            fi
+            run=$((run + 1))
+        done
+        report=$(head -n 1 "$WORKDIR/reports")
+
+        $first || printf ','
+        first=false
+        printf '\n{"shape":"%s","lines":%s,"bytes":%s,"status":"%s"' "$shape" "$size" "$(wc -c < "$WORKDIR/input.memeasm" | tr -d ' ')" "$status"
+        if [ $status = ok ]; then
+            # Lines per second of every phase and of the whole compilation
+            linesPerSecond=$(echo "$report" | awk -v lines="$size" '{
+                result = ""
+                split("parse analyse translate assemble", phases, " ")
+                for(i = 1; i <= 4; i++) {
+                    if(match($0, "\"" phases[i] "\":\\{\"seconds\":[0-9.]+")) {
+                        entry = substr($0, RSTART, RLENGTH)
+                        sub(/.*:/, "", entry)
+                        result = result sprintf("\"%s\":%.0f,", phases[i], (entry > 0) ? lines / entry : 0)
+                    }
+                }
+                match($0, /"totalSeconds":[0-9.]+/)
+                total = substr($0, RSTART + 15, RLENGTH - 15)
+                printf "{%s\"total\":%.0f}", result, (total > 0) ? lines / total : 0
+            }')
+            # Duration of every run for each phase
+            seconds=$(awk '{
+                split("parse analyse translate assemble", phases, " ")
+                for(i = 1; i <= 4; i++) {
+                    if(match($0, "\"" phases[i] "\":\\{\"seconds\":[0-9.]+")) {
+                        entry = substr($0, RSTART, RLENGTH)
+                        sub(/.*:/, "", entry)
+                        separator = (phases[i] in samples) ? "," : ""
+                        samples[phases[i]] = samples[phases[i]] separator entry
+                    }
+                }
+                match($0, /"totalSeconds":[0-9.]+/)
+                total = substr($0, RSTART + 15, RLENGTH - 15)
+                samples["total"] = samples["total"] ((NR > 1) ? "," : "") total
+            } END {
+                split("parse analyse translate assemble total", phases, " ")
+                result = ""
+                for(i = 1; i <= 5; i++) {
+                    if(phases[i] in samples) {
+                        result = result ((result == "") ? "" : ",") sprintf("\"%s\":[%s]", phases[i], samples[phases[i]])
+                    }
+                }
+                printf "{%s}", result
+            }' "$WORKDIR/reports")
+            printf ',"linesPerSecond":%s,"seconds":%s,"report":%s' "$linesPerSecond" "$seconds" "$report"
+        fi
+        printf '}'
+    done
+done
+printf '\n]}\n'
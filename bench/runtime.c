@@ -0,0 +1,230 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Runtime benchmark of the code generated by the compiler. The examples rot13, toupper and Stalinsort are run
+ * repeatedly on large inputs and their throughput is printed as JSON. bench/runtime.sh links this driver against the
+ * examples compiled at every optimisation level.
+ * Usage: bench/runtime [-s megabytes] [-r repetitions] [-l label]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern void rot13(char* str);
+extern void toupper_str(char* str);
+extern void stalinSort(int array[], size_t* arraySize);
+
+static uint64_t randomState = 0x9E3779B97F4A7C15;
+
+static uint64_t nextRandom(void) {
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1D;
+}
+
+static double currentTime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double difference = *(const double*) a - *(const double*) b;
+    return (difference > 0) - (difference < 0);
+}
+
+/// Reference implementations, used to check that the generated code works
+
+static void referenceRot13(char* str) {
+    for(; *str != '\0'; str++) {
+        if(*str >= 'a' && *str <= 'z') {
+            *str = (char) ('a' + (*str - 'a' + 13) % 26);
+        } else if(*str >= 'A' && *str <= 'Z') {
+            *str = (char) ('A' + (*str - 'A' + 13) % 26);
+        }
+    }
+}
+
+static void referenceToupper(char* str) {
+    for(; *str != '\0'; str++) {
+        if(*str >= 'a' && *str <= 'z') {
+            *str = (char) (*str - 'a' + 'A');
+        }
+    }
+}
+
+static void referenceStalinSort(int array[], size_t* arraySize) {
+    size_t newSize = 0;
+    for(size_t i = 0; i < *arraySize; i++) {
+        if(newSize == 0 || array[i] >= array[newSize - 1]) {
+            array[newSize++] = array[i];
+        }
+    }
+    *arraySize = newSize;
+}
+
+/// Benchmarks
+
+struct benchmark {
+    const char* name;
+    size_t inputSize; //in bytes
+    void* input; //Never modified, copied into the work buffer before every run
+    void* work;
+    void* expected;
+    size_t expectedSize; //Only used by Stalinsort, the number of elements after sorting
+    void (*run)(struct benchmark* benchmark);
+};
+
+static void runRot13(struct benchmark* benchmark) {
+    rot13(benchmark->work);
+}
+
+static void runToupper(struct benchmark* benchmark) {
+    toupper_str(benchmark->work);
+}
+
+static void runStalinSort(struct benchmark* benchmark) {
+    size_t arraySize = benchmark->inputSize / sizeof(int);
+    stalinSort(benchmark->work, &arraySize);
+    benchmark->expectedSize = arraySize;
+}
+
+/**
+ * Creates a null-terminated string of random printable characters
+ */
+static char* createText(size_t size) {
+    char* text = malloc(size);
+    for(size_t i = 0; i + 1 < size; i++) {
+        text[i] = (char) (' ' + nextRandom() % 95);
+    }
+    text[size - 1] = '\0';
+    return text;
+}
+
+/**
+ * Creates an array of random numbers that mostly increase, so that Stalinsort keeps a good part of them
+ */
+static int* createArray(size_t elements) {
+    int* array = malloc(elements * sizeof(int));
+    for(size_t i = 0; i < elements; i++) {
+        array[i] = (int) (i / 4) + (int) (nextRandom() % 8);
+    }
+    return array;
+}
+
+/**
+ * Runs the benchmark and prints its result
+ * @return false if the generated code produced a wrong result
+ */
+static bool runBenchmark(struct benchmark* benchmark, unsigned repetitions, bool first) {
+    double* seconds = malloc(repetitions * sizeof(double));
+    bool correct = true;
+    for(unsigned i = 0; i < repetitions; i++) {
+        memcpy(benchmark->work, benchmark->input, benchmark->inputSize);
+        double start = currentTime();
+        benchmark->run(benchmark);
+        seconds[i] = currentTime() - start;
+
+        if(i == 0) {
+            //Stalinsort also shrinks the array, so only the kept elements are compared
+            size_t compareSize = (benchmark->run == &runStalinSort) ? benchmark->expectedSize * sizeof(int) : benchmark->inputSize;
+            size_t expectedElements = benchmark->inputSize / sizeof(int);
+            if(benchmark->run == &runStalinSort) {
+                referenceStalinSort(benchmark->expected, &expectedElements);
+                correct = (expectedElements == benchmark->expectedSize);
+            }
+            correct = correct && memcmp(benchmark->work, benchmark->expected, compareSize) == 0;
+        }
+    }
+
+    qsort(seconds, repetitions, sizeof(double), compareDoubles);
+    double megabytes = (double) benchmark->inputSize / 1e6;
+    printf("%s\n    {\"program\":\"%s\",\"megabytes\":%.3f,\"correct\":%s,\"medianMBps\":%.2f,\"bestMBps\":%.2f,\"secondsPerRun\":[",
+           first ? "" : ",", benchmark->name, megabytes, correct ? "true" : "false",
+           megabytes / seconds[repetitions / 2], megabytes / seconds[0]);
+    for(unsigned i = 0; i < repetitions; i++) {
+        printf("%s%.6f", (i == 0) ? "" : ",", seconds[i]);
+    }
+    printf("]}");
+    free(seconds);
+    return correct;
+}
+
+int main(int argc, char* argv[]) {
+    double megabytes = 4;
+    unsigned repetitions = 9;
+    const char* label = "";
+    int opt;
+    while((opt = getopt(argc, argv, "s:r:l:")) != -1) {
+        switch(opt) {
+            case 's': megabytes = strtod(optarg, NULL); break;
+            case 'r': repetitions = (unsigned) strtoul(optarg, NULL, 10); break;
+            case 'l': label = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-s megabytes] [-r repetitions] [-l label]\n", argv[0]);
+                return 1;
+        }
+    }
+    size_t size = (size_t) (megabytes * 1e6);
+    if(size < sizeof(int) || repetitions == 0) {
+        fprintf(stderr, "The input size and the number of repetitions must be positive\n");
+        return 1;
+    }
+    size -= size % sizeof(int);
+
+    char* text = createText(size);
+    char* rot13Expected = malloc(size);
+    char* toupperExpected = malloc(size);
+    memcpy(rot13Expected, text, size);
+    memcpy(toupperExpected, text, size);
+    referenceRot13(rot13Expected);
+    referenceToupper(toupperExpected);
+    int* array = createArray(size / sizeof(int));
+    int* stalinSortExpected = malloc(size);
+    memcpy(stalinSortExpected, array, size);
+    void* work = malloc(size);
+
+    struct benchmark benchmarks[] = {
+        {.name = "rot13", .inputSize = size, .input = text, .work = work, .expected = rot13Expected, .run = &runRot13},
+        {.name = "toupper", .inputSize = size, .input = text, .work = work, .expected = toupperExpected, .run = &runToupper},
+        {.name = "stalinsort", .inputSize = size, .input = array, .work = work, .expected = stalinSortExpected, .run = &runStalinSort}
+    };
+
+    bool correct = true;
+    printf("{\"label\":\"%s\",\"repetitions\":%u,\"results\":[", label, repetitions);
+    for(unsigned i = 0; i < sizeof(benchmarks) / sizeof(struct benchmark); i++) {
+        correct = runBenchmark(&benchmarks[i], repetitions, i == 0) && correct;
+    }
+    printf("\n]}\n");
+
+    free(text);
+    free(rot13Expected);
+    free(toupperExpected);
+    free(array);
+    free(stalinSortExpected);
+    free(work);
+    return correct ? 0 : 1;
+}
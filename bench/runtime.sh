@@ -0,0 +1,57 @@
+#!/bin/sh
+# This file is part of the MemeAssembly compiler.
+#
+# Measures the throughput of the code generated for the examples rot13, toupper and Stalinsort at every optimisation
+# level and prints the results as JSON. -O69420 is not included, since it removes the code that would be measured.
+#
+# Usage: bench/runtime.sh [-m memeasm] [-s megabytes] [-r repetitions] [-L "levels"] > results.json
+
+MEMEASM=./memeasm
+CC=${CC:-gcc}
+MEGABYTES=4
+REPETITIONS=9
+LEVELS="-O0 -O-1 -O-2 -O-3"
+EXAMPLES="rot13/rot13 toupper/toupper Stalinsort/stalin-sort"
+
+while getopts "m:s:r:L:" opt; do
+    case $opt in
+        m) MEMEASM=$OPTARG ;;
+        s) MEGABYTES=$OPTARG ;;
+        r) REPETITIONS=$OPTARG ;;
+        L) LEVELS=$OPTARG ;;
+        *) echo "Usage: $0 [-m memeasm] [-s megabytes] [-r repetitions] [-L \"levels\"]" >&2; exit 1 ;;
+    esac
+done
+
+LINK_FLAGS=
+if [ "$(uname -s)" = Linux ]; then
+    LINK_FLAGS="-no-pie -z execstack"
+fi
+
+BENCH_DIR=$(dirname "$0")
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+exitCode=0
+printf '{"compiler":"%s","date":"%s","levels":[\n' "$($MEMEASM -v | head -n 1)" "$(date -u +%Y-%m-%dT%H:%M:%SZ)"
+first=true
+for level in $LEVELS; do
+    echo "Running the examples compiled with $level" >&2
+    # -O0 is the default, memeasm does not accept it as an option
+    levelOption=$level
+    [ "$level" = -O0 ] && levelOption=
+
+    objects=
+    for example in $EXAMPLES; do
+        object="$WORKDIR/$(basename "$example").o"
+        "$MEMEASM" $levelOption -O -o "$object" "$BENCH_DIR/../examples/$example.memeasm" || exit 1
+        objects="$objects $object"
+    done
+    $CC -std=gnu17 -O2 -o "$WORKDIR/runtime" "$BENCH_DIR/runtime.c" $objects $LINK_FLAGS 2> /dev/null || exit 1
+
+    $first || printf ',\n'
+    first=false
+    "$WORKDIR/runtime" -s "$MEGABYTES" -r "$REPETITIONS" -l "$level" || exitCode=1
+done
+printf ']}\n'
+exit $exitCode
@@ -0,0 +1,109 @@
+#!/bin/sh
+# This file is part of the MemeAssembly compiler.
+#
+# Checks that the compiler scales linearly. For every stressor, a program of N and one of 10N lines is generated and
+# compiled. The duration (best of several runs) and the peak memory usage of the compiler must not grow by more than
+# the given factor, which defaults to twice the linear growth. Quadratic behaviour grows by a factor of 100.
+# The memory of gcc (the assemble phase) is not included.
+#
+# Usage: bench/scaling.sh [-m memeasm] [-g generator] [-n lines] [-f factor] [-r runs] [-S "stressors"]
+
+MEMEASM=./memeasm
+GENERATOR=bench/generate
+LINES=10000
+MAX_FACTOR=20
+RUNS=3
+STRESSORS="labels calls functions longlines pointers balanced"
+
+while getopts "m:g:n:f:r:S:" opt; do
+    case $opt in
+        m) MEMEASM=$OPTARG ;;
+        g) GENERATOR=$OPTARG ;;
+        n) LINES=$OPTARG ;;
+        f) MAX_FACTOR=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        S) STRESSORS=$OPTARG ;;
+        *) echo "Usage: $0 [-m memeasm] [-g generator] [-n lines] [-f factor] [-r runs] [-S \"stressors\"]" >&2; exit 1 ;;
+    esac
+done
+
+# Options of the generator and the compiler for each stressor
+generatorOptions() {
+    case $1 in
+        labels) echo "-l 60" ;;
+        calls) echo "-k 60" ;;
+        functions) echo "-f 2" ;;
+        longlines) echo "-w 400" ;;
+        pointers) echo "-p 60" ;;
+        balanced) echo "-b 30" ;;
+        *) echo "Unknown stressor: $1" >&2; exit 1 ;;
+    esac
+}
+
+# Calls are only checked when creating an executable. Bully mode turns the garbage lines into random commands,
+# including "perfectly balanced as all things should be", which deletes lines at random
+compilerOptions() {
+    case $1 in
+        calls) echo "-o $WORKDIR/output" ;;
+        balanced) echo "-fcompile-mode bully -S -o $WORKDIR/output.S" ;;
+        *) echo "-S -o $WORKDIR/output.S" ;;
+    esac
+}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+# Compiles the input RUNS times and prints the shortest duration and the largest peak memory usage of the compiler
+measure() {
+    : > "$WORKDIR/reports"
+    run=0
+    while [ $run -lt "$RUNS" ]; do
+        "$MEMEASM" $(compilerOptions "$1") -ftime-report "$WORKDIR/input.memeasm" > /dev/null 2> "$WORKDIR/stderr" || return 1
+        grep '^{"commands"' "$WORKDIR/stderr" >> "$WORKDIR/reports"
+        run=$((run + 1))
+    done
+    awk '{
+        match($0, /"totalSeconds":[0-9.]+/)
+        seconds = substr($0, RSTART + 15, RLENGTH - 15) + 0
+        if(NR == 1 || seconds < best) best = seconds
+        report = $0
+        sub(/"assemble":\{[^}]*\}/, "", report)
+        while(match(report, /"peakRssKiB":[0-9]+/)) {
+            kib = substr(report, RSTART + 13, RLENGTH - 13) + 0
+            if(kib > peak) peak = kib
+            report = substr(report, RSTART + RLENGTH)
+        }
+    } END {
+        printf "%f %d\n", best, peak
+    }' "$WORKDIR/reports"
+}
+
+failed=0
+printf '%-10s %10s %12s %10s %12s %8s %8s\n' stressor "N s" "N KiB" "10N s" "10N KiB" time memory
+for stressor in $STRESSORS; do
+    results=
+    for lines in "$LINES" $((LINES * 10)); do
+        "$GENERATOR" $(generatorOptions "$stressor") "$lines" > "$WORKDIR/input.memeasm" || exit 1
+        result=$(measure "$stressor")
+        if [ -z "$result" ]; then
+            echo "$stressor: compiling $lines lines failed" >&2
+            sed 's/^/    /' "$WORKDIR/stderr" | tail -n 5 >&2
+            failed=1
+            continue 2
+        fi
+        results="$results $result"
+    done
+
+    echo "$stressor$results" | awk -v maxFactor="$MAX_FACTOR" '{
+        timeFactor = ($2 > 0) ? $4 / $2 : 0
+        memoryFactor = ($3 > 0) ? $5 / $3 : 0
+        verdict = (timeFactor > maxFactor || memoryFactor > maxFactor) ? "  NOT LINEAR" : ""
+        printf "%-10s %10.4f %12d %10.4f %12d %7.1fx %7.1fx%s\n", $1, $2, $3, $4, $5, timeFactor, memoryFactor, verdict
+        exit (verdict != "")
+    }' || failed=1
+done
+
+if [ $failed -ne 0 ]; then
+    echo "The compiler does not scale linearly (maximum growth: ${MAX_FACTOR}x for 10 times the input)" >&2
+fi
+exit $failed
@@ -19,51 +19,103 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "analyser.h"
 #include "../logger/log.h"
+#include "../report/stats.h"
 
 extern struct command commandList[NUMBER_OF_COMMANDS];
 
-void analyseCommands(struct compileState* compileState) {
-    struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS] = {NULL};
+/**
+ * Appends a command to the linked list of its opcode
+ * @param lastItems the last item of every list, so that appending does not need to traverse the list
+ */
+static void appendToCommandList(struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS], struct commandLinkedList* lastItems[NUMBER_OF_COMMANDS],
+                                struct parsedCommand* parsedCommand, unsigned fileNum) {
+    //Create Linked List item
+    struct commandLinkedList* commandLinkedListItem = malloc(sizeof(struct commandLinkedList));
+    CHECK_ALLOC(commandLinkedListItem);
+
+    //Fill struct
+    commandLinkedListItem->next = NULL;
+    commandLinkedListItem->definedInFile = fileNum;
+    commandLinkedListItem->command = parsedCommand;
+
+    //If there is no linked list yet, make this the first item
+    //If there are items, add it to the end of the list
+    struct commandLinkedList* lastItem = lastItems[parsedCommand->opcode];
+    if(lastItem == NULL) {
+        commandLinkedList[parsedCommand->opcode] = commandLinkedListItem;
+    } else {
+        lastItem->next = commandLinkedListItem;
+    }
+    lastItems[parsedCommand->opcode] = commandLinkedListItem;
+}
+
+/**
+ * Creates a linked list of all commands for every opcode. Only commands that belong to a function and data declarations are added
+ * @param commandLinkedList the lists, which must be initialised with NULL
+ * @param parametersChecked if true, the parameters of all commands were already checked (e.g. by the language server) and are not checked again
+ */
+void buildCommandLists(struct compileState* compileState, struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS], bool parametersChecked) {
+    //The last item of every list, so that appending does not need to traverse the list
+    struct commandLinkedList* lastItems[NUMBER_OF_COMMANDS];
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        lastItems[i] = commandLinkedList[i];
+        while(lastItems[i] != NULL && lastItems[i]->next != NULL) {
+            lastItems[i] = lastItems[i]->next;
+        }
+    }
 
     //Traverse all files
     for(unsigned i = 0; i < compileState->fileCount; i++) {
-        struct file file = compileState->files[i];
+        struct file* file = &compileState->files[i];
+        //The parameters of files loaded from a binary IR file or a summary were checked when it was created
+        bool checkFileParameters = !parametersChecked && file->irMapping == NULL && !file->summaryStub;
 
         //Traverse all functions
-        for(unsigned j = 0; j < file.functionCount; j++) {
-            struct function function = file.functions[j];
-
-            //Traverse all commands
-            for(unsigned k = 0; k < function.numberOfCommands; k++) {
-                struct parsedCommand* parsedCommand = &function.commands[k];
+        for(unsigned j = 0; j < file->functionCount; j++) {
+            struct function* function = &file->functions[j];
+
+            //Traverse all commands. Data declarations are added below, since they usually do not belong to a function
+            for(unsigned k = 0; k < function->numberOfCommands; k++) {
+                struct parsedCommand* parsedCommand = &function->commands[k];
+                if(commandList[parsedCommand->opcode].commandType == COMMAND_TYPE_DATA) {
+                    continue;
+                }
                 //Analyse parameters
-                checkParameters(parsedCommand, compileState->files[i].fileName, compileState);
-
-                //Add to command's linkedList
-                //Create Linked List item
-                struct commandLinkedList* commandLinkedListItem = malloc(sizeof(struct commandLinkedList));
-                CHECK_ALLOC(commandLinkedListItem);
-
-                //Fill struct
-                commandLinkedListItem->next = NULL;
-                commandLinkedListItem->definedInFile = i;
-                commandLinkedListItem->command = parsedCommand;
-
-                //If there is no linked list yet, make this the first item
-                //If there are items, add it to the end of the list
-                struct commandLinkedList* lastItem = commandLinkedList[parsedCommand->opcode];
-                if(lastItem == NULL) {
-                    commandLinkedList[parsedCommand->opcode] = commandLinkedListItem;
-                } else {
-                    while (lastItem->next != NULL) {
-                        lastItem = lastItem->next;
-                    }
-
-                    lastItem->next = commandLinkedListItem;
+                if(checkFileParameters) {
+                    checkParameters(parsedCommand, file->fileName, compileState);
                 }
+                appendToCommandList(commandLinkedList, lastItems, parsedCommand, i);
+            }
+        }
+
+        for(size_t j = 0; j < file->loc; j++) {
+            struct parsedCommand* parsedCommand = &file->parsedCommands[j];
+            if(commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_DATA) {
+                continue;
+            }
+            if(checkFileParameters) {
+                checkParameters(parsedCommand, file->fileName, compileState);
             }
+            appendToCommandList(commandLinkedList, lastItems, parsedCommand, i);
+        }
+    }
+}
+
+void freeCommandLists(struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS]) {
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        struct commandLinkedList* itemToBeFreed = commandLinkedList[i];
+        while (itemToBeFreed != NULL) {
+            struct commandLinkedList* toBeFreed = itemToBeFreed;
+            itemToBeFreed = itemToBeFreed->next;
+            free(toBeFreed);
         }
+        commandLinkedList[i] = NULL;
     }
+}
+
+void analyseCommands(struct compileState* compileState) {
+    struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS] = {NULL};
+    buildCommandLists(compileState, commandLinkedList, false);
 
     //Now go through each command and call its analysis function - if it has one
     for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
@@ -75,13 +127,7 @@ void analyseCommands(struct compileState* compileState) {
 
 
     //Checks done, freeing memory
+    sampleHeapUsage(compileState);
     printDebugMessage(compileState->logLevel, "Analysis done, freeing memory", 0);
-    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
-        struct commandLinkedList* itemToBeFreed = commandLinkedList[i];
-        while (itemToBeFreed != NULL) {
-            struct commandLinkedList* toBeFreed = itemToBeFreed;
-            itemToBeFreed = itemToBeFreed->next;
-            free(toBeFreed);
-        }
-    }
+    freeCommandLists(commandLinkedList);
 }
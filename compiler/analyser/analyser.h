@@ -24,11 +24,14 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include "../compiler.h"
 
 #include "comparisons.h"
+#include "data.h"
 #include "functions.h"
 #include "jumpMarkers.h"
 #include "parameters.h"
 #include "randomCommands.h"
 
+void buildCommandLists(struct compileState* compileState, struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS], bool parametersChecked);
+void freeCommandLists(struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS]);
 void analyseCommands(struct compileState* compileState);
 
 #endif
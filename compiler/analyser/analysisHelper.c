@@ -19,8 +19,115 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "analysisHelper.h"
 #include "../logger/log.h"
+#include "../cache/cache.h"
+#include "../report/remarks.h"
+#include <stdint.h>
 #include <string.h>
 
+#define NO_COMMAND SIZE_MAX
+
+/*
+ * A hash index over a command list. Commands with the same key (the file they are defined in if perFile is set, and the
+ * first `parameters` parameters) are chained in list order, so that all checks run in linear time
+ */
+struct commandIndex {
+    struct commandLinkedList** items; //The list items in list order
+    size_t* nextWithSameKey;
+    size_t* lastWithSameKey; //Only valid for the first command of each key
+    size_t* slots; //Index of the first command of a key, or NO_COMMAND
+    size_t capacity; //Always a power of two
+    size_t count;
+    bool perFile;
+    uint8_t parameters;
+};
+
+static uint64_t hashKey(struct commandIndex* index, unsigned file, char** parameters) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    if(index->perFile) {
+        hash = hashContinue(hash, &file, sizeof(file));
+    }
+    for(uint8_t i = 0; i < index->parameters; i++) {
+        hash = hashContinue(hash, parameters[i], strlen(parameters[i]) + 1);
+    }
+    return hash;
+}
+
+static bool keyEquals(struct commandIndex* index, struct commandLinkedList* item, unsigned file, char** parameters) {
+    return (!index->perFile || item->definedInFile == file) &&
+           (index->parameters < 1 || strcmp(item->command->parameters[0], parameters[0]) == 0) &&
+           (index->parameters < 2 || strcmp(item->command->parameters[1], parameters[1]) == 0);
+}
+
+/**
+ * @return the index of the first command with the given key, or NO_COMMAND if there is none
+ */
+static size_t findCommand(struct commandIndex* index, unsigned file, char** parameters) {
+    size_t slot = hashKey(index, file, parameters) & (index->capacity - 1);
+    while(index->slots[slot] != NO_COMMAND) {
+        if(keyEquals(index, index->items[index->slots[slot]], file, parameters)) {
+            return index->slots[slot];
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return NO_COMMAND;
+}
+
+/**
+ * Indexes all commands of a list
+ * @param perFile whether commands of different files have different keys
+ * @param parameters how many parameters are part of the key (at most 2)
+ */
+static void buildCommandIndex(struct commandIndex* index, struct commandLinkedList* commandLinkedList, bool perFile, uint8_t parameters) {
+    index->count = 0;
+    for(struct commandLinkedList* listItem = commandLinkedList; listItem != NULL; listItem = listItem->next) {
+        index->count++;
+    }
+    //At most half of the slots are used, so that probe sequences stay short
+    index->capacity = 16;
+    while(index->capacity < index->count * 2) {
+        index->capacity *= 2;
+    }
+    index->perFile = perFile;
+    index->parameters = parameters;
+    index->items = malloc(index->count * sizeof(struct commandLinkedList*) + 1);
+    index->nextWithSameKey = malloc(index->count * sizeof(size_t) + 1);
+    index->lastWithSameKey = malloc(index->count * sizeof(size_t) + 1);
+    index->slots = malloc(index->capacity * sizeof(size_t));
+    CHECK_ALLOC(index->items);
+    CHECK_ALLOC(index->nextWithSameKey);
+    CHECK_ALLOC(index->lastWithSameKey);
+    CHECK_ALLOC(index->slots);
+    for(size_t i = 0; i < index->capacity; i++) {
+        index->slots[i] = NO_COMMAND;
+    }
+
+    size_t i = 0;
+    for(struct commandLinkedList* listItem = commandLinkedList; listItem != NULL; listItem = listItem->next, i++) {
+        index->items[i] = listItem;
+        index->nextWithSameKey[i] = NO_COMMAND;
+
+        size_t slot = hashKey(index, listItem->definedInFile, listItem->command->parameters) & (index->capacity - 1);
+        while(index->slots[slot] != NO_COMMAND && !keyEquals(index, index->items[index->slots[slot]], listItem->definedInFile, listItem->command->parameters)) {
+            slot = (slot + 1) & (index->capacity - 1);
+        }
+        if(index->slots[slot] == NO_COMMAND) {
+            index->slots[slot] = i;
+            index->lastWithSameKey[i] = i;
+        } else {
+            size_t first = index->slots[slot];
+            index->nextWithSameKey[index->lastWithSameKey[first]] = i;
+            index->lastWithSameKey[first] = i;
+        }
+    }
+}
+
+static void freeCommandIndex(struct commandIndex* index) {
+    free(index->items);
+    free(index->nextWithSameKey);
+    free(index->lastWithSameKey);
+    free(index->slots);
+}
+
 /**
  * This is a helper function that can be used by analysis functions. It checks for duplicate definitions of commands and prints an error if there is one
  * @param commandLinkedList the list of that command to be checked for duplicate definitions
@@ -34,31 +141,117 @@ void checkDuplicateDefinition(struct commandLinkedList* commandLinkedList, struc
         parametersToCheck = 2;
     }
 
-    struct commandLinkedList* listItem = commandLinkedList;
-    while (listItem != NULL) {
+    struct commandIndex index;
+    buildCommandIndex(&index, commandLinkedList, oncePerFile, parametersToCheck);
+
+    for(size_t i = 0; i < index.count; i++) {
+        struct commandLinkedList* listItem = index.items[i];
         struct parsedCommand* command = listItem->command;
 
-        printDebugMessage(compileState->logLevel, "\tLabel duplicity check for %s in line %lu in file %u", 3, itemName, command->lineNum, listItem->definedInFile);
+        printDebugMessage(compileState->logLevel, "\tLabel duplicity check for %s in line %u in file %u", 3, itemName, command->lineNum, listItem->definedInFile);
 
-        struct commandLinkedList* duplicateItem = listItem->next;
-        while(duplicateItem != NULL) {
-            printDebugMessage(compileState->logLevel, "\t\tComparing against parameter %s", 1, duplicateItem->command->parameters[0]);
-            if((!oncePerFile || duplicateItem->definedInFile == listItem->definedInFile) &&
-             (parametersToCheck < 1 || strcmp( command->parameters[0], duplicateItem->command->parameters[0]) == 0) &&
-             (parametersToCheck != 2 || strcmp( command->parameters[1], duplicateItem->command->parameters[1]) == 0)) {
-                if(compileState->compileMode != bully) {
-                    printError(compileState->files[duplicateItem->definedInFile].fileName, duplicateItem->command->lineNum, compileState,
-                               "%s defined twice (already defined in %s:%lu)", 2, itemName, compileState->files[listItem->definedInFile].fileName, command->lineNum);
-                } else {
-                    //To fix this error in bully mode, only the first definition is valid, i.e. duplicateItem is removed
-                    duplicateItem->command->translate = false;
-                }
+        if(compileState->compileMode == bully) {
+            //To fix this error in bully mode, only the first definition is valid. Every later one is removed by its predecessor
+            if(index.nextWithSameKey[i] != NO_COMMAND) {
+                struct commandLinkedList* duplicateItem = index.items[index.nextWithSameKey[i]];
+                duplicateItem->command->translate = false;
+                emitRemark(compileState, remarkPassed, "bully", "DuplicateRemoved", compileState->files[duplicateItem->definedInFile].fileName, duplicateItem->command->lineNum,
+                           "%s defined twice, this definition was removed (already defined in %s:%u)", itemName, compileState->files[listItem->definedInFile].fileName, command->lineNum);
             }
+            continue;
+        }
+
+        //Every later definition is reported once for each earlier one, in the same order as before
+        for(size_t duplicate = index.nextWithSameKey[i]; duplicate != NO_COMMAND; duplicate = index.nextWithSameKey[duplicate]) {
+            struct commandLinkedList* duplicateItem = index.items[duplicate];
+            printError(compileState->files[duplicateItem->definedInFile].fileName, duplicateItem->command->lineNum, compileState,
+                       "%s defined twice (already defined in %s:%u)", 2, itemName, compileState->files[listItem->definedInFile].fileName, command->lineNum);
+        }
+    }
+
+    freeCommandIndex(&index);
+}
+
+//Symbols of the runtime written by the translator. Functions and data must not use these names, as they share the namespace of the assembler
+static const char* const runtimeSymbols[] = {
+    "writechar", "readchar",
+    #ifdef WINDOWS
+    "GetStdHandle", "WriteFile", "ReadFile",
+    #else
+    "killParent",
+    #endif
+    NULL
+};
 
-            duplicateItem = duplicateItem->next;
+/**
+ * @return true if the name is used by a symbol of the runtime, see runtimeSymbols
+ */
+bool isRuntimeSymbol(const char* name) {
+    for(unsigned i = 0; runtimeSymbols[i] != NULL; i++) {
+        if(strcmp(name, runtimeSymbols[i]) == 0) {
+            return true;
         }
-        listItem = listItem->next;
     }
+    return false;
+}
+
+/**
+ * This is a helper function that can be used by analysis functions. It checks that no command defines a symbol with the name of a symbol of the runtime
+ * @param commandLinkedList the list of the commands to be checked. Their first parameter is the name of the symbol
+ * @param compileState the compile state
+ * @param itemName the name of the item. Will be inserted in the error message ("%s cannot be named ...")
+ */
+void checkRuntimeSymbolConflicts(struct commandLinkedList* commandLinkedList, struct compileState* compileState, char* itemName) {
+    for(struct commandLinkedList* listItem = commandLinkedList; listItem != NULL; listItem = listItem->next) {
+        struct parsedCommand* command = listItem->command;
+        if(!command->translate || !isRuntimeSymbol(command->parameters[0])) {
+            continue;
+        }
+
+        if(compileState->compileMode != bully) {
+            printError(compileState->files[listItem->definedInFile].fileName, command->lineNum, compileState,
+                       "%s cannot be named \"%s\", the name is used by the runtime", 2, itemName, command->parameters[0]);
+        } else {
+            command->translate = false;
+            emitRemark(compileState, remarkPassed, "bully", "CommandRemoved", compileState->files[listItem->definedInFile].fileName, command->lineNum,
+                       "command removed, since the name \"%s\" is used by the runtime", command->parameters[0]);
+        }
+    }
+}
+
+/**
+ * This is a helper function that can be used by analysis functions. It checks that no command of one list defines a symbol with a name that is
+ * already defined by a command of another list, e.g. data named like a function. The error is reported at the command of the first list
+ * @param commandLinkedList the list of the commands to be checked. Their first parameter is the name of the symbol
+ * @param takenNames the list of the commands whose names cannot be used. Their first parameter is the name of the symbol
+ * @param compileState the compile state
+ * @param itemName the name of the item. Will be inserted in the error message ("%s has the same name as the %s defined in ...")
+ * @param takenItemName the name of the items of takenNames
+ */
+void checkNameConflicts(struct commandLinkedList* commandLinkedList, struct commandLinkedList* takenNames, struct compileState* compileState, char* itemName, char* takenItemName) {
+    struct commandIndex index;
+    buildCommandIndex(&index, takenNames, false, 1);
+
+    for(struct commandLinkedList* listItem = commandLinkedList; listItem != NULL; listItem = listItem->next) {
+        struct parsedCommand* command = listItem->command;
+        size_t taken = findCommand(&index, 0, command->parameters);
+        if(!command->translate || taken == NO_COMMAND) {
+            continue;
+        }
+
+        struct commandLinkedList* takenItem = index.items[taken];
+        if(compileState->compileMode != bully) {
+            printError(compileState->files[listItem->definedInFile].fileName, command->lineNum, compileState, "%s has the same name as the %s defined in %s:%u", 4,
+                       itemName, takenItemName, compileState->files[takenItem->definedInFile].fileName, takenItem->command->lineNum);
+        } else {
+            command->translate = false;
+            emitRemark(compileState, remarkPassed, "bully", "CommandRemoved", compileState->files[listItem->definedInFile].fileName, command->lineNum,
+                       "command removed, since %s has the same name as the %s defined in %s:%u", itemName, takenItemName,
+                       compileState->files[takenItem->definedInFile].fileName, takenItem->command->lineNum);
+        }
+    }
+
+    freeCommandIndex(&index);
 }
 
 /**
@@ -79,29 +272,25 @@ void checkCompanionCommandExistence(struct commandLinkedList* parentCommands, st
         parametersToCheck = 2;
     }
 
+    //Children are looked up by their first parameter only, also for the second parameter of the parent
+    struct commandIndex childIndex;
+    buildCommandIndex(&childIndex, childCommands, sameFile, (parametersToCheck > 0) ? 1 : 0);
+
     struct commandLinkedList* parentCommand = parentCommands;
     while (parentCommand != NULL) {
         bool childFound[2] = {false};
         struct parsedCommand* command = parentCommand->command;
 
-        printDebugMessage(compileState->logLevel, "\tLooking for %s of parent command in line %lu in file %u", 3, itemName, command->lineNum, parentCommand->definedInFile);
-
-        struct commandLinkedList* childCommand = childCommands;
-        while(childCommand != NULL) {
+        printDebugMessage(compileState->logLevel, "\tLooking for %s of parent command in line %u in file %u", 3, itemName, command->lineNum, parentCommand->definedInFile);
 
-            if(!sameFile || parentCommand->definedInFile == childCommand->definedInFile) {
-                //The first child was found if either no parameters must match or the first parameter matches
-                if(parametersToCheck == 0 || (parametersToCheck >= 1 && strcmp( command->parameters[0], childCommand->command->parameters[0]) == 0)) {
-                    childFound[0] = true;
-                } else if(parametersToCheck == 2 && strcmp( command->parameters[1], childCommand->command->parameters[0]) == 0)  {
-                    childFound[1] = true;
-                }
-            }
-
-            childCommand = childCommand->next;
+        //The first child was found if either no parameters must match or the first parameter matches
+        childFound[0] = findCommand(&childIndex, parentCommand->definedInFile, command->parameters) != NO_COMMAND;
+        //If both parameters are equal, a single child only counts for the first one
+        if(parametersToCheck == 2 && strcmp(command->parameters[0], command->parameters[1]) != 0) {
+            childFound[1] = findCommand(&childIndex, parentCommand->definedInFile, &command->parameters[1]) != NO_COMMAND;
         }
 
-        //We traversed all child commands, now we need to check if everything was defined properly
+        //Now we need to check if everything was defined properly
         if(parametersToCheck == 0) {
             if(!childFound[0]) {
                 if(compileState->compileMode != bully) {
@@ -111,6 +300,8 @@ void checkCompanionCommandExistence(struct commandLinkedList* parentCommands, st
                 } else {
                     //In bully mode, we just disregard the parent command
                     parentCommand->command->translate = false;
+                    emitRemark(compileState, remarkPassed, "bully", "CommandRemoved", compileState->files[parentCommand->definedInFile].fileName, command->lineNum,
+                               "command removed, since %s was not defined", itemName);
                 }
             }
         } else {
@@ -121,6 +312,8 @@ void checkCompanionCommandExistence(struct commandLinkedList* parentCommands, st
                 } else {
                     //In bully mode, we just disregard the parent command
                     parentCommand->command->translate = false;
+                    emitRemark(compileState, remarkPassed, "bully", "CommandRemoved", compileState->files[parentCommand->definedInFile].fileName, command->lineNum,
+                               "command removed, since %s was not defined for parameter \"%s\"", itemName, command->parameters[0]);
                 }
             }
             if(parametersToCheck == 2 && !childFound[1]) {
@@ -130,10 +323,14 @@ void checkCompanionCommandExistence(struct commandLinkedList* parentCommands, st
                 } else {
                     //In bully mode, we just disregard the parent command
                     parentCommand->command->translate = false;
+                    emitRemark(compileState, remarkPassed, "bully", "CommandRemoved", compileState->files[parentCommand->definedInFile].fileName, command->lineNum,
+                               "command removed, since %s was not defined for parameter \"%s\"", itemName, command->parameters[1]);
                 }
             }
         }
 
         parentCommand = parentCommand->next;
     }
+
+    freeCommandIndex(&childIndex);
 }
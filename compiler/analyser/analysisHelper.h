@@ -23,6 +23,9 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include "analyser.h"
 
 void checkDuplicateDefinition(struct commandLinkedList* commandLinkedList, struct compileState* compileState, bool oncePerFile, uint8_t parametersToCheck, char* itemName);
+bool isRuntimeSymbol(const char* name);
+void checkRuntimeSymbolConflicts(struct commandLinkedList* commandLinkedList, struct compileState* compileState, char* itemName);
+void checkNameConflicts(struct commandLinkedList* commandLinkedList, struct commandLinkedList* takenNames, struct compileState* compileState, char* itemName, char* takenItemName);
 void checkCompanionCommandExistence(struct commandLinkedList* parentCommands, struct commandLinkedList* childCommands, struct compileState* compileState, uint8_t parametersToCheck, bool sameFile, char* itemName);
 
 #endif //MEMEASSEMBLY_ANALYSISHELPER_H
@@ -0,0 +1,68 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "data.h"
+#include "analysisHelper.h"
+#include "../logger/log.h"
+
+extern const struct command commandList[];
+
+/**
+ * Checks if the data declarations and the commands loading their addresses are valid. This includes
+ *  - that no name was used for two declarations, no matter which kind of data they declare
+ *  - that no declaration uses the name of a function or of a symbol of the runtime. Both are global symbols, just like data
+ *  - that the address of data is only loaded if the data was declared. Like function calls, this is only checked when
+ *    creating an executable, so that data of other object files can be used
+ * @param commandLinkedList a list of all occurrences of all commands. Index i contains a linked list of all commands that have opcode i
+ * @param opcode the opcode of the command loading the address
+ * @param compileState the current compile state
+ */
+void analyseData(struct commandLinkedList** commandLinkedList, unsigned opcode, struct compileState* compileState) {
+    printDebugMessage(compileState->logLevel, "Beginning data declaration check", 0);
+
+    //All kinds of declarations share one namespace, so their lists are joined. The items are copied, since the original lists must not be modified
+    struct commandLinkedList* declarations = NULL;
+    struct commandLinkedList** lastDeclaration = &declarations;
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        if(commandList[i].commandType != COMMAND_TYPE_DATA) {
+            continue;
+        }
+        for(struct commandLinkedList* listItem = commandLinkedList[i]; listItem != NULL; listItem = listItem->next) {
+            struct commandLinkedList* declaration = malloc(sizeof(struct commandLinkedList));
+            CHECK_ALLOC(declaration);
+            *declaration = (struct commandLinkedList) {listItem->command, listItem->definedInFile, NULL};
+            *lastDeclaration = declaration;
+            lastDeclaration = &declaration->next;
+        }
+    }
+
+    checkDuplicateDefinition(declarations, compileState, false, 1, "data");
+    checkRuntimeSymbolConflicts(declarations, compileState, "data");
+    //Functions are defined by opcode 0
+    checkNameConflicts(declarations, commandLinkedList[0], compileState, "data", "function");
+    if(compileState->outputMode == executable) {
+        checkCompanionCommandExistence(commandLinkedList[opcode], declarations, compileState, 1, false, "data");
+    }
+
+    while(declarations != NULL) {
+        struct commandLinkedList* next = declarations->next;
+        free(declarations);
+        declarations = next;
+    }
+}
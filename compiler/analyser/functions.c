@@ -26,6 +26,7 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 /**
  * Checks if the function definitions are valid. This includes making sure that
  *  - no function names are used twice
+ *  - no function uses the name of a symbol of the runtime
  *  - there is a main function if it is supposed to be executable
  * @param commandLinkedList a list of all occurrences of all commands. Index i contains a linked list of all commands that have opcode i
  * @param opcode the opcode of the function definition
@@ -33,6 +34,7 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
  */
 void analyseFunctions(struct commandLinkedList** commandLinkedList, unsigned opcode, struct compileState* compileState) {
     checkDuplicateDefinition(commandLinkedList[opcode], compileState, false, 1, "function");
+    checkRuntimeSymbolConflicts(commandLinkedList[opcode], compileState, "function");
 
     //Check 2: Does a main-function exist?
     //This check is skipped in bully mode
@@ -19,9 +19,12 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "parameters.h"
 #include "../logger/log.h"
+#include "../parser/functionParser.h"
+#include "../report/remarks.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 
 #define NUMBER_OF_8_BIT_REGISTERS 20
 #define NUMBER_OF_64_BIT_REGISTERS 16
@@ -30,9 +33,6 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #define NUMBER_OF_ESCAPE_SEQUENCES 10
 
 //Used to pseudo-random generation when using bully mode
-extern uint64_t computedIndex;
-extern char* functionNames[];
-extern unsigned numFunctionNames;
 
 //Parameters as strings
 const char* const paramNames[] = {"64 bit Register", "32 bit Register", "16 bit Register", "8 bit Register", "decimal number", "character", "monke jump marker name", "function name"};
@@ -137,19 +137,38 @@ uint8_t getRegisterSize(uint8_t paramType) {
     }
 }
 
+/**
+ * @param pointerSize the register type that has the size of the memory access
+ * @return the name of the operand size in Intel syntax (e.g. "QWORD" for PARAM_REG64), or NULL if the size is not stated
+ */
+const char* getPointerSizeName(uint8_t pointerSize) {
+    switch(pointerSize) {
+        case PARAM_REG8:
+            return "BYTE";
+        case PARAM_REG16:
+            return "WORD";
+        case PARAM_REG32:
+            return "DWORD";
+        case PARAM_REG64:
+            return "QWORD";
+        default:
+            return NULL;
+    }
+}
+
 /**
  * Returns a random register for the specified size. Returned value may be NULL
  */
-char* getRandomRegister(uint8_t paramType) {
+char* getRandomRegister(uint8_t paramType, struct compileState* compileState) {
     switch(paramType) {
         case PARAM_REG64:
-            return strdup(registers_64_bit[computedIndex % NUMBER_OF_64_BIT_REGISTERS]);
+            return strdup(registers_64_bit[compileState->computedIndex % NUMBER_OF_64_BIT_REGISTERS]);
         case PARAM_REG32:
-            return strdup(registers_32_bit[computedIndex % NUMBER_OF_32_BIT_REGISTERS]);
+            return strdup(registers_32_bit[compileState->computedIndex % NUMBER_OF_32_BIT_REGISTERS]);
         case PARAM_REG16:
-            return strdup(registers_16_bit[computedIndex % NUMBER_OF_16_BIT_REGISTERS]);
+            return strdup(registers_16_bit[compileState->computedIndex % NUMBER_OF_16_BIT_REGISTERS]);
         case PARAM_REG8:
-            return strdup(registers_8_bit[computedIndex % NUMBER_OF_8_BIT_REGISTERS]);
+            return strdup(registers_8_bit[compileState->computedIndex % NUMBER_OF_8_BIT_REGISTERS]);
         default:
             return NULL;
     }
@@ -222,7 +241,7 @@ void translateCharacter(char *parameter, int parameterNum, struct parsedCommand
     (*parsedCommand).parameters[parameterNum] = modifiedParameter;
 }
 
-void printParameterUsageNote(uint8_t allowedParams) {
+void printParameterUsageNote(uint8_t allowedParams, char* inputFileName, size_t lineNum, struct compileState* compileState) {
     //First, we construct a string that lists all allowed parameter types for this parameter
     //The worst case is: all parameters are used, separated by commas (+8*2 characters) and \0 at the end (+1 character)
     size_t maxSize = 17;
@@ -246,7 +265,240 @@ void printParameterUsageNote(uint8_t allowedParams) {
     allowedParamsString[strlen(allowedParamsString) - 2] = '\0';
 
     //Print it
-    printNote("the following parameter types are allowed: %s", true, 1, allowedParamsString);
+    if(compileState->collectDiagnostics) {
+        addNote(compileState, inputFileName, lineNum, "the following parameter types are allowed: %s", allowedParamsString);
+    } else {
+        printNote("the following parameter types are allowed: %s", true, 1, allowedParamsString);
+    }
+}
+
+/**
+ * Checks if a name can be used in the clobber list of an inline assembly block. Allowed are general purpose registers,
+ * SIMD registers (xmm0 - zmm31), "flags" and "memory"
+ */
+static bool isClobberName(char* name) {
+    if(strcmp(name, "flags") == 0 || strcmp(name, "memory") == 0 ||
+        isInArray(name, registers_64_bit, NUMBER_OF_64_BIT_REGISTERS) || isInArray(name, registers_32_bit, NUMBER_OF_32_BIT_REGISTERS) ||
+        isInArray(name, registers_16_bit, NUMBER_OF_16_BIT_REGISTERS) || isInArray(name, registers_8_bit, NUMBER_OF_8_BIT_REGISTERS)) {
+        return true;
+    }
+    if((name[0] == 'x' || name[0] == 'y' || name[0] == 'z') && name[1] == 'm' && name[2] == 'm' && name[3] >= '0' && name[3] <= '9') {
+        char* end;
+        long number = strtol(name + 3, &end, 10);
+        return *end == '\0' && number <= 31 && (name[3] != '0' || name[4] == '\0');
+    }
+    return false;
+}
+
+/**
+ * Checks the clobber list of an inline assembly block. The registers are separated by commas and/or spaces, "nothing" declares that no register is modified
+ */
+static void checkClobberList(struct parsedCommand *parsedCommand, char* inputFileName, struct compileState* compileState) {
+    char* clobbers = parsedCommand->parameters[0];
+    if(strcmp(clobbers, "nothing") == 0) {
+        return;
+    }
+
+    char name[CLOBBER_NAME_LENGTH];
+    size_t length;
+    for(const char* clobber = nextClobber(clobbers, &length, name); clobber != NULL; clobber = nextClobber(clobber + length, &length, name)) {
+        if((name[0] == '\0' || !isClobberName(name)) && compileState->compileMode != bully) {
+            printError(inputFileName, parsedCommand->lineNum, compileState, "invalid clobber list: '%.*s' is not a register, \"flags\" or \"memory\"", 2, (int) length, clobber);
+        }
+    }
+}
+
+/**
+ * Finds the next entry of an inline assembly clobber list. Entries are separated by commas and/or spaces
+ * @param position where to continue searching
+ * @param length is set to the length of the entry
+ * @param name is set to a copy of the entry, or to an empty string if the entry does not fit (and can therefore not be a register name)
+ * @return a pointer to the entry or NULL if the end of the list was reached
+ */
+const char* nextClobber(const char* position, size_t* length, char name[CLOBBER_NAME_LENGTH]) {
+    position += strspn(position, ", ");
+    if(*position == '\0') {
+        return NULL;
+    }
+    *length = strcspn(position, ", ");
+    if(*length < CLOBBER_NAME_LENGTH) {
+        memcpy(name, position, *length);
+        name[*length] = '\0';
+    } else {
+        name[0] = '\0';
+    }
+    return position;
+}
+
+/**
+ * Parses the size of a buffer, e.g. "4096 bytes" or "4096 bytes aligned to 64". If no alignment is stated, the buffer is aligned to 16 bytes
+ * @return false if the text is malformed, the size is 0 or the alignment is not a power of two of at most 4096
+ */
+bool parseBufferSize(const char* value, uint64_t* size, uint64_t* alignment) {
+    char* end;
+    *alignment = 16;
+    if(value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    *size = strtoull(value, &end, 10);
+    if(errno != 0 || *size == 0) {
+        return false;
+    }
+
+    if(strncmp(end, " bytes", strlen(" bytes")) == 0) {
+        end += strlen(" bytes");
+    } else if(*size == 1 && strncmp(end, " byte", strlen(" byte")) == 0) {
+        end += strlen(" byte");
+    } else {
+        return false;
+    }
+    if(*end == '\0') {
+        return true;
+    }
+
+    if(strncmp(end, " aligned to ", strlen(" aligned to ")) != 0 || end[strlen(" aligned to ")] < '0' || end[strlen(" aligned to ")] > '9') {
+        return false;
+    }
+    *alignment = strtoull(end + strlen(" aligned to "), &end, 10);
+    return *end == '\0' && *alignment != 0 && *alignment <= 4096 && (*alignment & (*alignment - 1)) == 0;
+}
+
+/**
+ * Replaces the values of a data declaration in bully mode
+ */
+static void replaceDataValues(struct parsedCommand* parsedCommand, char* inputFileName, char* newValues, struct compileState* compileState) {
+    emitRemark(compileState, remarkPassed, "bully", "ParameterReplaced", inputFileName, parsedCommand->lineNum,
+               "invalid data \"%s\" replaced by \"%s\"", parsedCommand->parameters[1], newValues);
+    free(parsedCommand->parameters[1]);
+    parsedCommand->parameters[1] = newValues;
+}
+
+/**
+ * Checks the values of a table of numbers, which are separated by commas and/or spaces, and joins them with ", " so that the assembler accepts them
+ */
+static void checkDataNumbers(struct parsedCommand* parsedCommand, char* inputFileName, bool bytes, struct compileState* compileState) {
+    char* values = parsedCommand->parameters[1];
+    //Space for ", " between all values, or for a random value in bully mode
+    char* numbers = malloc(2 * strlen(values) + 16);
+    CHECK_ALLOC(numbers);
+    size_t length = 0;
+    bool valid = true;
+
+    for(char* position = values + strspn(values, ", "); *position != '\0'; position += strspn(position, ", ")) {
+        size_t numberLength = strcspn(position, ", ");
+        char* end;
+        errno = 0;
+        long long number = 0;
+        if(position[0] == '-') {
+            number = strtoll(position, &end, 10);
+        } else {
+            number = (long long) strtoull(position, &end, 10);
+        }
+        bool inRange = errno == 0 && (!bytes || (number >= -128 && number <= 255));
+        if(end != position + numberLength || numberLength == 0 || !inRange) {
+            valid = false;
+            if(compileState->compileMode != bully) {
+                printError(inputFileName, parsedCommand->lineNum, compileState, "invalid value in table: '%.*s' is not a decimal number%s", 3,
+                           (int) numberLength, position, bytes ? " between -128 and 255" : " of at most 64 bits");
+            }
+        } else {
+            if(length > 0) {
+                numbers[length++] = ',';
+                numbers[length++] = ' ';
+            }
+            memcpy(numbers + length, position, numberLength);
+            length += numberLength;
+        }
+        position += numberLength;
+    }
+    numbers[length] = '\0';
+
+    if(length == 0 && valid && compileState->compileMode != bully) {
+        printError(inputFileName, parsedCommand->lineNum, compileState, "a table must contain at least one value", 0);
+    }
+    if(compileState->compileMode == bully && (!valid || length == 0)) {
+        //Invalid values are dropped. If none are left, the table consists of a single random value
+        if(length == 0) {
+            sprintf(numbers, "%u", (unsigned) compileState->computedIndex % 128);
+        }
+        replaceDataValues(parsedCommand, inputFileName, numbers, compileState);
+    } else {
+        free(parsedCommand->parameters[1]);
+        parsedCommand->parameters[1] = numbers;
+    }
+}
+
+/**
+ * Checks the escape sequences of a string and encloses it in quotes. The assembler understands the escape sequences
+ * \n, \t, \r, \0, \\ and \", every other quote is escaped
+ */
+static void checkDataString(struct parsedCommand* parsedCommand, char* inputFileName, struct compileState* compileState) {
+    char* string = parsedCommand->parameters[1];
+    char* quoted = malloc(2 * strlen(string) + 3);
+    CHECK_ALLOC(quoted);
+    size_t length = 0;
+    bool valid = true;
+
+    quoted[length++] = '"';
+    for(size_t i = 0; string[i] != '\0'; i++) {
+        if(string[i] == '\\') {
+            if(string[i + 1] != '\0' && strchr("ntr0\\\"", string[i + 1]) != NULL) {
+                quoted[length++] = string[i++];
+            } else {
+                //In bully mode, the backslash is taken literally
+                valid = false;
+                if(compileState->compileMode != bully) {
+                    printError(inputFileName, parsedCommand->lineNum, compileState, "invalid escape sequence in string: \"\\%.1s\"", 1, string + i + 1);
+                }
+                quoted[length++] = '\\';
+            }
+        } else if(string[i] == '"') {
+            quoted[length++] = '\\';
+        }
+        quoted[length++] = string[i];
+    }
+    quoted[length++] = '"';
+    quoted[length] = '\0';
+
+    if(!valid && compileState->compileMode == bully) {
+        replaceDataValues(parsedCommand, inputFileName, quoted, compileState);
+    } else {
+        free(parsedCommand->parameters[1]);
+        parsedCommand->parameters[1] = quoted;
+    }
+}
+
+/**
+ * Checks the values of a data declaration. The kind of data is given by the directive in the translation pattern of the command.
+ * Tables and strings are rewritten into the syntax of the assembler
+ */
+static void checkDataValues(struct parsedCommand* parsedCommand, char* inputFileName, struct compileState* compileState) {
+    const char* directive = commandList[parsedCommand->opcode].translationPattern;
+    if(strcmp(directive, ".asciz") == 0) {
+        checkDataString(parsedCommand, inputFileName, compileState);
+    } else if(strcmp(directive, ".zero") == 0) {
+        uint64_t size, alignment;
+        if(!parseBufferSize(parsedCommand->parameters[1], &size, &alignment)) {
+            if(compileState->compileMode != bully) {
+                printError(inputFileName, parsedCommand->lineNum, compileState, "invalid buffer size: \"%s\"", 1, parsedCommand->parameters[1]);
+                if(compileState->compileMode != obfuscated) {
+                    if(compileState->collectDiagnostics) {
+                        addNote(compileState, inputFileName, parsedCommand->lineNum, "the size is stated in bytes, optionally followed by an alignment of at most 4096, e.g. \"4096 bytes aligned to 64\"");
+                    } else {
+                        printNote("the size is stated in bytes, optionally followed by an alignment of at most 4096, e.g. \"4096 bytes aligned to 64\"", true, 0);
+                    }
+                }
+            } else {
+                char* newValues = malloc(32);
+                CHECK_ALLOC(newValues);
+                sprintf(newValues, "%u bytes", (unsigned) compileState->computedIndex % 420 + 1);
+                replaceDataValues(parsedCommand, inputFileName, newValues, compileState);
+            }
+        }
+    } else {
+        checkDataNumbers(parsedCommand, inputFileName, strcmp(directive, ".byte") == 0, compileState);
+    }
 }
 
 /**
@@ -254,7 +506,19 @@ void printParameterUsageNote(uint8_t allowedParams) {
  */
 void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, struct compileState* compileState) {
     printDebugMessage(compileState->logLevel, "Starting parameter validity check", 0);
+    //Inline assembly is passed to the assembler as it is, only the clobber list can be checked
+    uint8_t commandType = commandList[parsedCommand->opcode].commandType;
+    if(COMMAND_TYPE_IS_INLINE_ASM(commandType)) {
+        if(commandType == COMMAND_TYPE_INLINE_ASM_START) {
+            checkClobberList(parsedCommand, inputFileName, compileState);
+        }
+        return;
+    }
     uint8_t usedParameters = commandList[(*parsedCommand).opcode].usedParameters;
+    //The values of a data declaration are checked separately, only its name is a regular parameter
+    if(commandType == COMMAND_TYPE_DATA) {
+        usedParameters = 1;
+    }
     for(uint8_t parameterNum = 0; parameterNum < usedParameters; parameterNum++) {
         //Get the current parameter
         char* parameter = (*parsedCommand).parameters[parameterNum];
@@ -307,9 +571,10 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a decimal number cannot be a pointer");
                     }
                 }
-                if(number == 69 || number == 420) {
+                if((number == 69 || number == 420) && !compileState->collectDiagnostics) {
                     printNiceASCII();
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_DECIMAL;
@@ -328,12 +593,13 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a character cannot be a pointer");
                     }
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_CHAR;
                 continue;
             //If not, check if the parameter is only one character
-            } else if(strlen(parameter) == 1) {
+            } else if(parameter[0] != '\0' && parameter[1] == '\0') {
                 translateCharacter(parameter, parameterNum, parsedCommand);
                 printDebugMessage(compileState->logLevel, "\t\tParameter is a character, translated to: %s", 1, (*parsedCommand).parameters[parameterNum]);
                 if(parsedCommand->isPointer == parameterNum + 1) {
@@ -342,6 +608,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a character cannot be a pointer");
                     }
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_CHAR;
@@ -362,6 +629,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a character cannot be a pointer");
                     }
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_CHAR;
@@ -375,7 +643,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
             uint8_t a_used = 0;
             uint8_t u_used = 0;
             uint8_t unexpectedCharacter = 0;
-            for(size_t i = 0; i < strlen(parameter); i++) {
+            for(size_t i = 0; parameter[i] != '\0'; i++) {
                 if(parameter[i] == 'a') {
                     a_used = 1;
                 } else if(parameter[i] == 'u') {
@@ -394,6 +662,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a jump marker cannot be a pointer");
                     }
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_MONKE_LABEL;
@@ -403,7 +672,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
         }
         if((allowedTypes & PARAM_FUNC_NAME) != 0) { //Function name
             bool unexpectedCharacter = false;
-            for(size_t i = 0; i < strlen(parameter); i++) {
+            for(size_t i = 0; parameter[i] != '\0'; i++) {
                 char character = parameter[i];
                 if(i == 0 && character >= '0' && character <= '9') {
                     unexpectedCharacter = true;
@@ -424,6 +693,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     } else {
                         //Well then it's not a pointer :shrug:
                         parsedCommand->isPointer = 0;
+                        emitRemark(compileState, remarkPassed, "bully", "PointerRemoved", inputFileName, parsedCommand->lineNum, "\"" pointerSuffix "\" ignored, since a function name cannot be a pointer");
                     }
                 }
                 parsedCommand->paramTypes[parameterNum] = PARAM_FUNC_NAME;
@@ -434,21 +704,21 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
         if(compileState->compileMode != bully) {
             printError(inputFileName, parsedCommand->lineNum, compileState, "invalid parameter provided: \"%s\"", 1, parameter);
             if(compileState->compileMode != obfuscated) {
-                printParameterUsageNote(allowedTypes);
+                printParameterUsageNote(allowedTypes, inputFileName, parsedCommand->lineNum, compileState);
             }
             parsedCommand->paramTypes[parameterNum] = 0;
         } else {
             /* To make this work, we need to replace this parameter with something that works
              * To create something semi-random, we use the same technique used in fileParser.c:
-             * "computedIndex", which is dependent on the previous failed parameters, is used to pseudo-randomly
+             * "compileState->computedIndex", which is dependent on the previous failed parameters, is used to pseudo-randomly
              * generate a valid parameter
              */
-            for(size_t i = 0; i < strlen(parameter); i++){
-                computedIndex = computedIndex * parameter[i] / 2;
+            for(size_t i = 0; parameter[i] != '\0'; i++){
+                compileState->computedIndex = compileState->computedIndex * parameter[i] / 2;
             }
 
             //Choose a parameter. If it is not allowed, rotate the bitmask until we find a valid one
-            uint8_t chosenParameter = 1 << (computedIndex % 8);
+            uint8_t chosenParameter = 1 << (compileState->computedIndex % 8);
             while ((allowedTypes & chosenParameter) == 0) {
                 if(chosenParameter == (1 << 7)) {
                     chosenParameter = 1;
@@ -463,31 +733,31 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                 case PARAM_REG32:
                 case PARAM_REG16:
                 case PARAM_REG8:
-                    newParam = getRandomRegister(chosenParameter);
+                    newParam = getRandomRegister(chosenParameter, compileState);
                     break;
                 case PARAM_DECIMAL:
                 case PARAM_CHAR:
                     newParam = malloc(10);
                     CHECK_ALLOC(newParam);
-                    sprintf(newParam, "%u", (unsigned) computedIndex % 128);
+                    sprintf(newParam, "%u", (unsigned) compileState->computedIndex % 128);
                     break;
                 case PARAM_MONKE_LABEL:
                     newParam = malloc(10);
                     int j = 0;
                     CHECK_ALLOC(newParam);
-                    unsigned length = computedIndex % 7 + 2;
+                    unsigned length = compileState->computedIndex % 7 + 2;
                     for(unsigned i = 0; i < length; i++) {
-                        newParam[j++] = (computedIndex % 2 == 0) ? 'u' : 'a';
-                        computedIndex = computedIndex * 3 / 2;
+                        newParam[j++] = (compileState->computedIndex % 2 == 0) ? 'u' : 'a';
+                        compileState->computedIndex = compileState->computedIndex * 3 / 2;
                     }
                     newParam[length] = 0;
                     break;
                 case PARAM_FUNC_NAME:
-                    newParam = strdup(functionNames[computedIndex % numFunctionNames]);
+                    newParam = strdup(functionNames[compileState->computedIndex % numFunctionNames]);
                     break;
                 default:
                     printInternalCompilerError("Random parameter generation unsupported for paramType %u", true, 1, chosenParameter);
-                    exit(EXIT_FAILURE);
+                    abortCompilation(abortInternalError);
             }
             if(parsedCommand->isPointer == parameterNum + 1) {
                 parsedCommand->isPointer = 0;
@@ -495,6 +765,8 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
 
             CHECK_ALLOC(newParam);
             //Free the old parameter
+            emitRemark(compileState, remarkPassed, "bully", "ParameterReplaced", inputFileName, parsedCommand->lineNum,
+                       "invalid parameter \"%s\" replaced by \"%s\"", parameter, newParam);
             free(parameter);
             //Set the new parameter
             parsedCommand->parameters[parameterNum] = newParam;
@@ -505,13 +777,15 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
     //We only compare parameters if there are at least two of them
     if(usedParameters >= 2) {
         //Now do some parameter checks
-        //1: If a number and a register are used, they number must fit in the register
+        //1: If a number and a register are used, they number must fit in the register. If the register is a pointer with a stated size, it must fit into the memory operand
         //2: If a number and a 64 Bit register are used (and the command is not a mov-command), can the number be sign-extended from 32 Bits?
+        //   A 64 Bit memory operand always requires this, since there is no mov-instruction that stores a 64 Bit immediate
         if((parsedCommand->paramTypes[0] == PARAM_DECIMAL && PARAM_ISREG(parsedCommand->paramTypes[1])) ||
            (parsedCommand->paramTypes[1] == PARAM_DECIMAL && PARAM_ISREG(parsedCommand->paramTypes[0])))  {
             unsigned decimalIndex = (parsedCommand->paramTypes[0] == PARAM_DECIMAL) ? 0 : 1;
             unsigned regIndex = 1 - decimalIndex;
-            unsigned regSize = getRegisterSize(parsedCommand->paramTypes[regIndex]);
+            bool isMemoryOperand = parsedCommand->isPointer == regIndex + 1 && parsedCommand->pointerSize != 0;
+            unsigned regSize = getRegisterSize(isMemoryOperand ? parsedCommand->pointerSize : parsedCommand->paramTypes[regIndex]);
 
             long long number = strtoll(parsedCommand->parameters[decimalIndex], NULL, 10);
             /*
@@ -522,7 +796,11 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
              */
             unsigned bitsNeeded = (number == 0) ? 1 : ((__builtin_clzll(number) > 0) ? 64 - __builtin_clzll(number) : 64 - __builtin_clzll(~number) + 1);
             if(bitsNeeded > regSize) {
-                if(compileState->compileMode != bully) {
+                if(compileState->compileMode != bully && isMemoryOperand) {
+                    printError(inputFileName, parsedCommand->lineNum, compileState,
+                               "invalid parameter combination: '%s' (%u bits) does not fit into %s PTR [%s]",
+                               4, parsedCommand->parameters[decimalIndex], bitsNeeded, getPointerSizeName(parsedCommand->pointerSize), parsedCommand->parameters[regIndex]);
+                } else if(compileState->compileMode != bully) {
                     printError(inputFileName, parsedCommand->lineNum, compileState,
                                "invalid parameter combination: '%s' (%u bits) does not fit into register '%s' of size %u",
                                3, parsedCommand->parameters[decimalIndex], bitsNeeded, parsedCommand->parameters[regIndex], regSize);
@@ -530,22 +808,29 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                     //We replace the number with something that is guaranteed to fit into all registers
                     char* newParam = malloc(10);
                     CHECK_ALLOC(newParam);
-                    sprintf(newParam, "%u", (unsigned) computedIndex % 256);
+                    sprintf(newParam, "%u", (unsigned) compileState->computedIndex % 256);
+                    emitRemark(compileState, remarkPassed, "bully", "ParameterReplaced", inputFileName, parsedCommand->lineNum,
+                               "\"%s\" replaced by \"%s\" to fit into register '%s'", parsedCommand->parameters[decimalIndex], newParam, parsedCommand->parameters[regIndex]);
 
                     free(parsedCommand->parameters[decimalIndex]);
                     parsedCommand->parameters[decimalIndex] = newParam;
                 }
             //If command is not mov, are the last 33 Bits all 0 or all 1?
-            } else if(commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_MOV && regSize == 64 && !((number & 0xFFFFFFFF80000000) == 0 || (number | 0x7FFFFFFF) == -1)) {
+            } else if((commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_MOV || isMemoryOperand) && regSize == 64 && !((number & 0xFFFFFFFF80000000) == 0 || (number | 0x7FFFFFFF) == -1)) {
                 if(compileState->compileMode != bully) {
                     printError(inputFileName, parsedCommand->lineNum, compileState,
                                "invalid parameter combination: 64 Bit arithmetic operation commands require the decimal number to be sign-extendable from 32 Bits",0);
                 } else {
                     //We just make the number shorter than 32 bits :bigBrain:
-                    parsedCommand->parameters[decimalIndex][computedIndex % 32] = 0;
+                    char* decimalNumber = parsedCommand->parameters[decimalIndex];
+                    if(compileState->computedIndex % 32 < strlen(decimalNumber)) {
+                        decimalNumber[compileState->computedIndex % 32] = 0;
+                    }
+                    emitRemark(compileState, remarkPassed, "bully", "ParameterTruncated", inputFileName, parsedCommand->lineNum,
+                               "decimal number truncated to \"%s\" to be sign-extendable from 32 Bits", parsedCommand->parameters[decimalIndex]);
 
-                    //Also, change computedIndex. Just because
-                    computedIndex += (number & 0xFFF);
+                    //Also, change compileState->computedIndex. Just because
+                    compileState->computedIndex += (number & 0xFFF);
                 }
             }
         }
@@ -565,7 +850,7 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
                 } else {
                     //We just replace this register with one of the correct size
                     free(parsedCommand->parameters[i]);
-                    parsedCommand->parameters[i] = getRandomRegister(currentReg);
+                    parsedCommand->parameters[i] = getRandomRegister(currentReg, compileState);
                     CHECK_ALLOC(parsedCommand->parameters[i]);
 
                     parsedCommand->paramTypes[i] = currentReg;
@@ -573,13 +858,44 @@ void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, s
             }
         }
 
-        //4: If there's a pointer parameter, is the other parameter a register? If not, we do not know the operand size, throw an error
+        //4: If there's a pointer parameter without a stated size, is the other parameter a register? If not, we do not know the operand size, throw an error
         //This check is skipped in bully mode and done in translator.c, as fixing this issue requires to edit the translated assembly code
+        uint8_t otherParamType = parsedCommand->paramTypes[parsedCommand->isPointer % 2];
         if(compileState->compileMode != bully) {
-            if (parsedCommand->isPointer != 0 && !PARAM_ISREG(parsedCommand->paramTypes[parsedCommand->isPointer % 2])) {
+            if (parsedCommand->isPointer != 0 && parsedCommand->pointerSize == 0 && !PARAM_ISREG(otherParamType)) {
                 printError(inputFileName, parsedCommand->lineNum, compileState,
                            "invalid parameter combination: operand size unknown", 0);
+                if(compileState->compileMode != obfuscated) {
+                    if(compileState->collectDiagnostics) {
+                        addNote(compileState, inputFileName, parsedCommand->lineNum, "the size of the memory access can be stated, e.g. \"" sizedPointerSuffixStart "QWORD" sizedPointerSuffixEnd "\"");
+                    } else {
+                        printNote("the size of the memory access can be stated, e.g. \"" sizedPointerSuffixStart "QWORD" sizedPointerSuffixEnd "\"", true, 0);
+                    }
+                }
             }
         }
+
+        //5: If the pointer has a stated size and the other parameter is a register, both must be of the same size
+        if(parsedCommand->isPointer != 0 && parsedCommand->pointerSize != 0 && PARAM_ISREG(otherParamType) && otherParamType != parsedCommand->pointerSize) {
+            unsigned regIndex = parsedCommand->isPointer % 2;
+            if(compileState->compileMode != bully) {
+                printError(inputFileName, parsedCommand->lineNum, compileState,
+                           "invalid parameter combination: register '%s' does not have the stated size %s", 2,
+                           parsedCommand->parameters[regIndex], getPointerSizeName(parsedCommand->pointerSize));
+            } else {
+                //We just replace this register with one of the correct size
+                char* newParam = getRandomRegister(parsedCommand->pointerSize, compileState);
+                CHECK_ALLOC(newParam);
+                emitRemark(compileState, remarkPassed, "bully", "ParameterReplaced", inputFileName, parsedCommand->lineNum,
+                           "\"%s\" replaced by \"%s\" to match the stated size %s", parsedCommand->parameters[regIndex], newParam, getPointerSizeName(parsedCommand->pointerSize));
+                free(parsedCommand->parameters[regIndex]);
+                parsedCommand->parameters[regIndex] = newParam;
+                parsedCommand->paramTypes[regIndex] = parsedCommand->pointerSize;
+            }
+        }
+    }
+
+    if(commandType == COMMAND_TYPE_DATA) {
+        checkDataValues(parsedCommand, inputFileName, compileState);
     }
 }
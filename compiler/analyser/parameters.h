@@ -22,6 +22,12 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "../commands.h"
 
+#define CLOBBER_NAME_LENGTH 8
+
 void checkParameters(struct parsedCommand *parsedCommand, char* inputFileName, struct compileState* compileState);
+uint8_t getRegisterSize(uint8_t paramType);
+const char* getPointerSizeName(uint8_t pointerSize);
+bool parseBufferSize(const char* value, uint64_t* size, uint64_t* alignment);
+const char* nextClobber(const char* position, size_t* length, char name[CLOBBER_NAME_LENGTH]);
 
 #endif //MEMEASSEMBLY_PARAMETERS_H
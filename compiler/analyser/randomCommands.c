@@ -19,10 +19,48 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "randomCommands.h"
 #include "../logger/log.h"
+#include "../report/remarks.h"
 
 #include <stdlib.h>
 #include <time.h>
 
+/**
+ * Seeds the random number generator of this compilation. Every compilation has its own generator, so that several
+ * compilations can run in one process and the output of a compilation only depends on its seed
+ * @param seed any value. It is scrambled using SplitMix64, so that similar seeds result in unrelated sequences
+ */
+void seedRandom(struct compileState* compileState, uint64_t seed) {
+    uint64_t state = seed + 0x9E3779B97F4A7C15;
+    state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9;
+    state = (state ^ (state >> 27)) * 0x94D049BB133111EB;
+    state ^= state >> 31;
+    //xorshift gets stuck at 0
+    compileState->randomState = (state != 0) ? state : 0x9E3779B97F4A7C15;
+}
+
+/**
+ * Returns the next random number of this compilation (xorshift64*). If the generator was not seeded yet, the current
+ * time is used as the seed
+ */
+uint64_t nextRandom(struct compileState* compileState) {
+    if(compileState->randomState == 0) {
+        seedRandom(compileState, (uint64_t) time(NULL));
+    }
+    uint64_t state = compileState->randomState;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    compileState->randomState = state;
+    return state * 0x2545F4914F6CDD1D;
+}
+
+/**
+ * Returns a random number in [0, limit). limit must not be 0
+ */
+size_t randomBelow(struct compileState* compileState, size_t limit) {
+    return (size_t) (nextRandom(compileState) % limit);
+}
+
 /**
  * Chooses a random line of code for each input file in which a random jump marker will be inserted. This is going to be the jump point for all
  * instances of "confused stonks" within that file
@@ -34,13 +72,11 @@ void setConfusedStonksJumpLabel(struct commandLinkedList** commandLinkedList, un
     (void)(commandLinkedList);
     (void)(opcode);
 
-    srand((unsigned int) time(NULL));
-
     for(unsigned i = 0; i < compileState->fileCount; i++) {
         if(compileState->files[i].loc == 0) {
             continue;
         }
-        compileState->files[i].randomIndex = ((size_t) rand()) % (compileState->files[i].loc);
+        compileState->files[i].randomIndex = randomBelow(compileState, compileState->files[i].loc);
         printDebugMessage(compileState->logLevel, "Chose random line for jump marker: %lu", 1, compileState->files[i].randomIndex);
     }
 }
@@ -76,29 +112,44 @@ void chooseLinesToBeDeleted(struct commandLinkedList** commandLinkedList, unsign
 
     printDebugMessage(compileState->logLevel, "\tamount of lines to be deleted: %lu", 1, linesToBeDeleted);
     if(linesToBeDeleted > 0) {
-        printThanosASCII(linesToBeDeleted);
-
-        srand(time(NULL));
-        size_t selectedLines = 0;
-        while(selectedLines < linesToBeDeleted) {
-            //Generate a random file
-            unsigned randomFile = rand() % compileState->fileCount;
-
-            //Generate a random line within file
-            size_t randomLine = rand() % compileState->files[randomFile].loc;
-            printDebugMessage(compileState->logLevel, "\tGenerated random line %lu in file %u", 2, randomLine, randomFile);
-
-            //Check if it was already selected
-            if(compileState->files[randomFile].parsedCommands[randomLine].translate == false) {
-                printDebugMessage(compileState->logLevel, "\t\tLine was already generated", 0);
-                continue;
-            }
+        if(!compileState->collectDiagnostics) {
+            printThanosASCII(linesToBeDeleted);
+        }
 
-            //If not, set the translate-field to false
-            compileState->files[randomFile].parsedCommands[randomLine].translate = false;
-            printDebugMessage(compileState->logLevel, "\t\tLine was added to the list", 0);
+        //Only lines that are still translated can be chosen, e.g. bully mode may already have removed some
+        struct lineReference {
+            unsigned file;
+            size_t line;
+        };
+        struct lineReference* candidates = malloc(loc * sizeof(struct lineReference));
+        CHECK_ALLOC(candidates);
+        size_t candidateCount = 0;
+        for(unsigned i = 0; i < compileState->fileCount; i++) {
+            for(size_t j = 0; j < compileState->files[i].loc; j++) {
+                if(compileState->files[i].parsedCommands[j].translate) {
+                    candidates[candidateCount++] = (struct lineReference) {i, j};
+                }
+            }
+        }
+        if(linesToBeDeleted > candidateCount) {
+            struct commandLinkedList* firstUse = commandLinkedList[opcode];
+            emitRemark(compileState, remarkMissed, "perfectly-balanced", "NotEnoughLines", compileState->files[firstUse->definedInFile].fileName, firstUse->command->lineNum,
+                       "%lu lines should be deleted, but only %lu lines are left", linesToBeDeleted, candidateCount);
+            linesToBeDeleted = candidateCount;
+        }
 
-            selectedLines++;
+        //Partial Fisher-Yates shuffle: the first linesToBeDeleted candidates become a uniformly random selection
+        for(size_t selectedLines = 0; selectedLines < linesToBeDeleted; selectedLines++) {
+            size_t chosen = selectedLines + randomBelow(compileState, candidateCount - selectedLines);
+            struct lineReference line = candidates[chosen];
+            candidates[chosen] = candidates[selectedLines];
+            candidates[selectedLines] = line;
+
+            compileState->files[line.file].parsedCommands[line.line].translate = false;
+            emitRemark(compileState, remarkPassed, "perfectly-balanced", "LineDeleted", compileState->files[line.file].fileName,
+                       compileState->files[line.file].parsedCommands[line.line].lineNum, "line deleted by \"perfectly balanced as all things should be\"");
+            printDebugMessage(compileState->logLevel, "\tChose line %lu in file %u", 2, line.line, line.file);
         }
+        free(candidates);
     }
 }
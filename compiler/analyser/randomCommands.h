@@ -22,6 +22,10 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "../commands.h"
 
+void seedRandom(struct compileState* compileState, uint64_t seed);
+uint64_t nextRandom(struct compileState* compileState);
+size_t randomBelow(struct compileState* compileState, size_t limit);
+
 void setConfusedStonksJumpLabel(struct commandLinkedList** commandLinkedList, unsigned opcode, struct compileState* compileState) ;
 void chooseLinesToBeDeleted(struct commandLinkedList** commandLinkedList, unsigned opcode, struct compileState* compileState);
 
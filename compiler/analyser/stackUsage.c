@@ -0,0 +1,435 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "stackUsage.h"
+#include "analyser.h"
+#include "../logger/log.h"
+
+#include <string.h>
+#include <stdio.h>
+
+extern const struct command commandList[];
+
+//How many bytes writechar and readchar put on the stack (the return address is counted by the call itself)
+#ifdef WINDOWS
+#define RUNTIME_HELPER_STACK (5 * 8 + 32)
+#else
+#define RUNTIME_HELPER_STACK (6 * 8)
+#endif
+//The martyrdom code pushes seven registers at the start of main
+#define MARTYRDOM_STACK (7 * 8)
+
+#define STACK_REASON_LENGTH 192
+
+typedef enum { unvisited, inProgress, done } visitState;
+
+struct stackLabel {
+    uint8_t opcode; //The opcode of the label definition
+    char* name; //Only used for labels that have a parameter (monke and "p wins"), NULL otherwise
+    size_t lineNum;
+    long depth;
+};
+
+struct stackCall {
+    char* functionName;
+    long depth; //Stack depth in the caller at the moment of the call
+};
+
+struct functionStackInfo {
+    struct function* function;
+    char* name;
+
+    long frame; //Maximum depth reached by the function itself, without nested calls
+    size_t callCount;
+    struct stackCall* calls;
+
+    bool unbounded;
+    char reason[STACK_REASON_LENGTH];
+
+    visitState state;
+    long worstCase;
+    long worstCallee; //Index of the callee responsible for the worst case, -1 if the function's own frame is the worst case
+};
+
+/**
+ * Checks if the given operand is the stack pointer (or one of its lower parts). Memory operands like [rsp] do not count
+ */
+static bool isStackPointer(const char* operand) {
+    return strcmp(operand, "rsp") == 0 || strcmp(operand, "esp") == 0 || strcmp(operand, "sp") == 0 || strcmp(operand, "spl") == 0;
+}
+
+/**
+ * Checks if the clobber list of an inline assembly block contains the stack pointer
+ */
+static bool clobbersStackPointer(const char* clobbers) {
+    char name[CLOBBER_NAME_LENGTH];
+    size_t length;
+    for(const char* clobber = nextClobber(clobbers, &length, name); clobber != NULL; clobber = nextClobber(clobber + length, &length, name)) {
+        if(isStackPointer(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Fills in the parameters of the command's translation pattern, the same way the translator does it
+ * @return a heap-allocated string containing the instructions of this command
+ */
+static char* expandTranslationPattern(struct parsedCommand* parsedCommand) {
+    const struct command* command = &commandList[parsedCommand->opcode];
+    const char* pattern = command->translationPattern;
+
+    size_t length = 1;
+    for(size_t i = 0; pattern[i] != '\0'; i++) {
+        if(pattern[i] == '{' && pattern[i + 1] >= '0' && pattern[i + 1] < command->usedParameters + '0' && pattern[i + 2] == '}') {
+            length += strlen(parsedCommand->parameters[pattern[i + 1] - '0']) + 2;
+        } else {
+            length++;
+        }
+    }
+
+    char* expanded = malloc(length);
+    CHECK_ALLOC(expanded);
+    size_t pos = 0;
+    for(size_t i = 0; pattern[i] != '\0'; i++) {
+        if(pattern[i] == '{' && pattern[i + 1] >= '0' && pattern[i + 1] < command->usedParameters + '0' && pattern[i + 2] == '}') {
+            uint8_t index = pattern[i + 1] - '0';
+            if(parsedCommand->isPointer == index + 1) {
+                pos += sprintf(expanded + pos, "[%s]", parsedCommand->parameters[index]);
+            } else {
+                pos += sprintf(expanded + pos, "%s", parsedCommand->parameters[index]);
+            }
+            i += 2;
+        } else {
+            expanded[pos++] = pattern[i];
+        }
+    }
+    expanded[pos] = '\0';
+    return expanded;
+}
+
+/**
+ * Simulates the instructions of a single command and updates the stack depth accordingly
+ * @param info the function this command belongs to. Its frame is updated and it is marked unbounded if the stack pointer is modified in an unpredictable way
+ * @param depth the current stack depth. Is updated by this function
+ */
+static void simulateCommand(struct functionStackInfo* info, struct parsedCommand* parsedCommand, char* fileName, long* depth) {
+    char* instructions = expandTranslationPattern(parsedCommand);
+
+    char* savePtr = NULL;
+    for(char* instruction = strtok_r(instructions, "\n", &savePtr); instruction != NULL; instruction = strtok_r(NULL, "\n", &savePtr)) {
+        //Skip leading whitespace and numeric labels like "1: "
+        while(*instruction == '\t' || *instruction == ' ') instruction++;
+        char* labelEnd = instruction;
+        while(*labelEnd >= '0' && *labelEnd <= '9') labelEnd++;
+        if(labelEnd != instruction && *labelEnd == ':') {
+            instruction = labelEnd + 1;
+            while(*instruction == '\t' || *instruction == ' ') instruction++;
+        }
+        if(*instruction == '\0' || instruction[strlen(instruction) - 1] == ':') {
+            continue;
+        }
+
+        //Split the instruction into mnemonic, destination and source
+        char mnemonic[16] = {0};
+        char destination[64] = {0};
+        char source[64] = {0};
+        sscanf(instruction, "%15s %63[^,], %63[^\n]", mnemonic, destination, source);
+        //Remove trailing whitespace of the operands
+        for(char* operand = destination; operand != NULL; operand = (operand == destination) ? source : NULL) {
+            size_t length = strlen(operand);
+            while(length > 0 && (operand[length - 1] == ' ' || operand[length - 1] == '\t')) {
+                operand[--length] = '\0';
+            }
+        }
+
+        if(strcmp(mnemonic, "push") == 0) {
+            *depth += 8;
+        } else if(strcmp(mnemonic, "pop") == 0) {
+            *depth -= 8;
+        } else if(strcmp(mnemonic, "call") == 0) {
+            //Only the runtime helpers are called from within a translation pattern
+            if(*depth + 8 + RUNTIME_HELPER_STACK > info->frame) {
+                info->frame = *depth + 8 + RUNTIME_HELPER_STACK;
+            }
+        }
+
+        if((strcmp(mnemonic, "sub") == 0 || strcmp(mnemonic, "add") == 0) && strcmp(destination, "rsp") == 0) {
+            char* endPtr;
+            long value = strtol(source, &endPtr, 0);
+            if(*endPtr == '\0' && endPtr != source) {
+                *depth += (mnemonic[0] == 's') ? value : -value;
+            } else if(!info->unbounded) {
+                info->unbounded = true;
+                snprintf(info->reason, STACK_REASON_LENGTH, "stack pointer is modified by a register value in %s:%u", fileName, parsedCommand->lineNum);
+            }
+        } else if(isStackPointer(destination) && strcmp(mnemonic, "cmp") != 0 && strcmp(mnemonic, "test") != 0 && strcmp(mnemonic, "push") != 0 && !info->unbounded) {
+            info->unbounded = true;
+            snprintf(info->reason, STACK_REASON_LENGTH, "stack pointer is overwritten in %s:%u", fileName, parsedCommand->lineNum);
+        }
+
+        if(*depth > info->frame) {
+            info->frame = *depth;
+        }
+    }
+
+    free(instructions);
+}
+
+/**
+ * Looks for the label a jump command jumps to and makes sure that the stack depth is the same at both places.
+ * If the depth differs (e.g. "stonks" inside an upgrade-loop), the stack can grow without bounds
+ */
+static void checkJumpTarget(struct functionStackInfo* info, struct stackLabel* labels, size_t labelCount, struct stackLabel* jump, char* fileName) {
+    if(info->unbounded) {
+        return;
+    }
+
+    for(size_t i = 0; i < labelCount; i++) {
+        if(labels[i].opcode == jump->opcode && (jump->name == NULL || strcmp(labels[i].name, jump->name) == 0)) {
+            if(labels[i].depth != jump->depth) {
+                info->unbounded = true;
+                snprintf(info->reason, STACK_REASON_LENGTH, "stack depth differs between the jump in %s:%lu (%ld B) and its label in line %lu (%ld B)",
+                         fileName, jump->lineNum, jump->depth, labels[i].lineNum, labels[i].depth);
+            }
+            return;
+        }
+    }
+
+    //The label is not part of this function, so the depth at the jump target cannot be known
+    info->unbounded = true;
+    snprintf(info->reason, STACK_REASON_LENGTH, "jump in %s:%lu leaves the function", fileName, jump->lineNum);
+}
+
+/**
+ * Computes the frame of a single function and collects all of its call sites
+ */
+static void analyseFunctionStack(struct functionStackInfo* info, char* fileName, struct compileState* compileState) {
+    struct function* function = info->function;
+    info->frame = 0;
+    info->worstCallee = -1;
+
+    //With -O69420, nothing but "xor rax, rax; ret" remains
+    if(compileState->optimisationLevel == o69420) {
+        return;
+    }
+
+    info->calls = calloc(function->numberOfCommands, sizeof(struct stackCall));
+    struct stackLabel* labels = calloc(function->numberOfCommands, sizeof(struct stackLabel));
+    //A comparison can jump to two labels, hence there can be two jumps per command
+    struct stackLabel* jumps = calloc(function->numberOfCommands * 2, sizeof(struct stackLabel));
+    CHECK_ALLOC(info->calls);
+    CHECK_ALLOC(labels);
+    CHECK_ALLOC(jumps);
+    size_t labelCount = 0;
+    size_t jumpCount = 0;
+
+    long depth = 0;
+    #ifndef WINDOWS
+    const char* const mainFunctionName =
+    #ifdef MACOS
+        "_main";
+    #else
+        "main";
+    #endif
+    if(compileState->martyrdom && strcmp(info->name, mainFunctionName) == 0) {
+        info->frame = MARTYRDOM_STACK;
+    }
+    #endif
+
+    for(size_t k = 1; k < function->numberOfCommands; k++) {
+        struct parsedCommand* parsedCommand = &function->commands[k];
+        const struct command* command = &commandList[parsedCommand->opcode];
+        //Data is not written into the function, even if it was declared inside of it in bully mode
+        if(!parsedCommand->translate || command->commandType == COMMAND_TYPE_DATA) {
+            continue;
+        }
+
+        //Labels and jumps are paired with their companion command at opcode + 1, just like in the analysis functions
+        if(command->analysisFunction == &analyseJumpMarkers || command->analysisFunction == &analyseMonkeMarkers) {
+            labels[labelCount++] = (struct stackLabel) {parsedCommand->opcode, (command->usedParameters > 0) ? parsedCommand->parameters[0] : NULL, parsedCommand->lineNum, depth};
+        } else if(parsedCommand->opcode > 0 && (commandList[parsedCommand->opcode - 1].analysisFunction == &analyseWhoWouldWinCommands ||
+                                                commandList[parsedCommand->opcode - 1].analysisFunction == &analyseTheyreTheSamePictureCommands)) {
+            labels[labelCount++] = (struct stackLabel) {parsedCommand->opcode, (command->usedParameters > 0) ? parsedCommand->parameters[0] : NULL, parsedCommand->lineNum, depth};
+        } else if(parsedCommand->opcode > 0 && (commandList[parsedCommand->opcode - 1].analysisFunction == &analyseJumpMarkers ||
+                                                commandList[parsedCommand->opcode - 1].analysisFunction == &analyseMonkeMarkers)) {
+            jumps[jumpCount++] = (struct stackLabel) {parsedCommand->opcode - 1, (command->usedParameters > 0) ? parsedCommand->parameters[0] : NULL, parsedCommand->lineNum, depth};
+        } else if(command->analysisFunction == &analyseWhoWouldWinCommands) {
+            jumps[jumpCount++] = (struct stackLabel) {parsedCommand->opcode + 1, parsedCommand->parameters[0], parsedCommand->lineNum, depth};
+            jumps[jumpCount++] = (struct stackLabel) {parsedCommand->opcode + 1, parsedCommand->parameters[1], parsedCommand->lineNum, depth};
+        } else if(command->analysisFunction == &analyseTheyreTheSamePictureCommands) {
+            jumps[jumpCount++] = (struct stackLabel) {parsedCommand->opcode + 1, NULL, parsedCommand->lineNum, depth};
+        } else if(command->analysisFunction == &setConfusedStonksJumpLabel && !info->unbounded) {
+            info->unbounded = true;
+            snprintf(info->reason, STACK_REASON_LENGTH, "\"confused stonks\" in %s:%u jumps to a random line", fileName, parsedCommand->lineNum);
+        } else if(command->commandType == COMMAND_TYPE_INLINE_ASM_START && clobbersStackPointer(parsedCommand->parameters[0]) && !info->unbounded) {
+            info->unbounded = true;
+            snprintf(info->reason, STACK_REASON_LENGTH, "inline assembly in %s:%u clobbers the stack pointer", fileName, parsedCommand->lineNum);
+        }
+
+        if(command->commandType == COMMAND_TYPE_FUNC_CALL) {
+            info->calls[info->callCount++] = (struct stackCall) {parsedCommand->parameters[0], depth};
+        } else {
+            simulateCommand(info, parsedCommand, fileName, &depth);
+        }
+
+        //Reverse optimisation stage 2 pushes and pops rax after every command except inline assembly
+        if(compileState->optimisationLevel == o_2 && !COMMAND_TYPE_IS_INLINE_ASM(command->commandType) && depth + 8 > info->frame) {
+            info->frame = depth + 8;
+        }
+        //Reverse optimisation stage 3 stores xmm0 in the 16 bytes below rsp: in the red zone, or in space it allocates on Windows
+        if(compileState->optimisationLevel == o_3 && !COMMAND_TYPE_IS_INLINE_ASM(command->commandType) && depth + 16 > info->frame) {
+            info->frame = depth + 16;
+        }
+    }
+
+    for(size_t i = 0; i < jumpCount; i++) {
+        checkJumpTarget(info, labels, labelCount, &jumps[i], fileName);
+    }
+
+    free(labels);
+    free(jumps);
+}
+
+/**
+ * Propagates the worst-case stack depth over the call graph using a depth-first search.
+ * Functions that are part of a cycle or call an unbounded function are unbounded themselves
+ * @param path the current call chain, used to print recursive cycles
+ */
+static void propagateStackUsage(struct functionStackInfo* infos, size_t functionCount, size_t index, size_t* path, size_t pathLength) {
+    struct functionStackInfo* info = &infos[index];
+    info->state = inProgress;
+    info->worstCase = info->frame;
+    path[pathLength++] = index;
+
+    for(size_t i = 0; i < info->callCount; i++) {
+        size_t callee = functionCount;
+        for(size_t j = 0; j < functionCount; j++) {
+            if(strcmp(infos[j].name, info->calls[i].functionName) == 0) {
+                callee = j;
+                break;
+            }
+        }
+
+        if(callee == functionCount) {
+            if(!info->unbounded) {
+                info->unbounded = true;
+                snprintf(info->reason, STACK_REASON_LENGTH, "calls external function %s", info->calls[i].functionName);
+            }
+            continue;
+        }
+
+        if(infos[callee].state == inProgress) {
+            if(!info->unbounded) {
+                info->unbounded = true;
+                //Print the cycle, starting at the callee
+                size_t start = 0;
+                while(path[start] != callee) start++;
+                int written = snprintf(info->reason, STACK_REASON_LENGTH, "recursion: ");
+                for(size_t j = start; j < pathLength && written < STACK_REASON_LENGTH; j++) {
+                    written += snprintf(info->reason + written, STACK_REASON_LENGTH - written, "%s -> ", infos[path[j]].name);
+                }
+                if(written < STACK_REASON_LENGTH) {
+                    snprintf(info->reason + written, STACK_REASON_LENGTH - written, "%s", infos[callee].name);
+                }
+            }
+            continue;
+        }
+
+        if(infos[callee].state == unvisited) {
+            propagateStackUsage(infos, functionCount, callee, path, pathLength);
+        }
+
+        if(infos[callee].unbounded) {
+            if(!info->unbounded) {
+                info->unbounded = true;
+                snprintf(info->reason, STACK_REASON_LENGTH, "calls %s, which is unbounded", infos[callee].name);
+            }
+        } else if(info->calls[i].depth + 8 + infos[callee].worstCase > info->worstCase) {
+            info->worstCase = info->calls[i].depth + 8 + infos[callee].worstCase;
+            info->worstCallee = (long) callee;
+        }
+    }
+
+    info->state = done;
+}
+
+/**
+ * Computes the maximum stack depth of every function and its call chain and prints a report to stdout.
+ * The depth is given relative to the stack pointer at the function's entry, i.e. excluding the function's own return address
+ */
+void printStackUsage(struct compileState* compileState) {
+    size_t functionCount = 0;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        functionCount += compileState->files[i].functionCount;
+    }
+
+    struct functionStackInfo* infos = calloc(functionCount, sizeof(struct functionStackInfo));
+    size_t* path = calloc(functionCount, sizeof(size_t));
+    char** fileNames = calloc(functionCount, sizeof(char*));
+    CHECK_ALLOC(infos);
+    CHECK_ALLOC(path);
+    CHECK_ALLOC(fileNames);
+
+    size_t index = 0;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        for(size_t j = 0; j < compileState->files[i].functionCount; j++) {
+            struct function* function = &compileState->files[i].functions[j];
+            //Functions that are not translated (e.g. duplicates in bully mode) are not part of the call graph
+            if(!function->commands[0].translate) {
+                continue;
+            }
+            infos[index].function = function;
+            infos[index].name = function->commands[0].parameters[0];
+            fileNames[index] = compileState->files[i].fileName;
+            analyseFunctionStack(&infos[index], fileNames[index], compileState);
+            index++;
+        }
+    }
+    functionCount = index;
+
+    for(size_t i = 0; i < functionCount; i++) {
+        if(infos[i].state == unvisited) {
+            propagateStackUsage(infos, functionCount, i, path, 0);
+        }
+    }
+
+    printf("Stack usage (in bytes, excluding the function's own return address):\n");
+    for(size_t i = 0; i < functionCount; i++) {
+        struct functionStackInfo* info = &infos[i];
+        printf("%s:%lu: %s: frame %ld, ", fileNames[i], info->function->definedInLine, info->name, info->frame);
+        if(info->unbounded) {
+            printf("worst case " RED "unbounded" RESET " (%s)\n", info->reason);
+        } else {
+            printf("worst case %ld (%s", info->worstCase, info->name);
+            for(long callee = info->worstCallee; callee != -1; callee = infos[callee].worstCallee) {
+                printf(" -> %s", infos[callee].name);
+            }
+            printf(")\n");
+        }
+    }
+
+    for(size_t i = 0; i < functionCount; i++) {
+        free(infos[i].calls);
+    }
+    free(infos);
+    free(path);
+    free(fileNames);
+}
@@ -0,0 +1,283 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Batch mode (--batch manifest). Every non-empty line of the manifest describes one independent program using the
+ * usual command line options, e.g.
+ *      -O-1 -o rot13.o rot13.memeasm
+ *      -o hello hello.memeasm   # comments start with a '#'
+ * Arguments containing spaces can be enclosed in double quotes.
+ * Each program is compiled in a forked worker, so the compiler is only started once. The output and diagnostics of a
+ * program are captured and printed as one block once it is done, so that parallel programs do not interleave.
+ */
+
+#include "batch.h"
+#include "../compiler.h"
+#include "../logger/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+struct batchProgram {
+    int argc;
+    char** argv;
+    char* arguments; //The buffer all arguments point into
+    size_t manifestLine;
+    char* description; //The manifest line, used as a heading for the output of the program
+};
+
+struct batchWorker {
+    pid_t pid;
+    size_t program;
+    FILE* output;
+};
+
+/**
+ * Splits a manifest line into arguments. The line is modified, the arguments point into it
+ * @return the number of arguments. argv[0] is set to the program name
+ */
+static int splitArguments(char* line, char* programName, char*** argvPtr) {
+    size_t capacity = 8;
+    int argc = 0;
+    char** argv = malloc(capacity * sizeof(char*));
+    CHECK_ALLOC(argv);
+    argv[argc++] = programName;
+
+    char* current = line;
+    while(true) {
+        while(*current == ' ' || *current == '\t') current++;
+        if(*current == '\0' || *current == '#') break;
+
+        char* argument = current;
+        char* write = current;
+        bool quoted = false;
+        while(*current != '\0' && (quoted || (*current != ' ' && *current != '\t'))) {
+            if(*current == '"') {
+                quoted = !quoted;
+            } else {
+                *write++ = *current;
+            }
+            current++;
+        }
+        bool lastArgument = (*current == '\0');
+        *write = '\0';
+        current++;
+
+        //One more slot is needed for the terminating NULL
+        if((size_t) argc + 1 >= capacity) {
+            capacity *= 2;
+            argv = realloc(argv, capacity * sizeof(char*));
+            CHECK_ALLOC(argv);
+        }
+        argv[argc++] = argument;
+        if(lastArgument) break;
+    }
+    argv[argc] = NULL;
+    *argvPtr = argv;
+    return argc;
+}
+
+/**
+ * Reads the manifest. Every non-empty line becomes a program
+ * @return the programs, or NULL if the manifest could not be read
+ */
+static struct batchProgram* readManifest(const char* manifestPath, char* programName, size_t* programCount) {
+    FILE* manifest = fopen(manifestPath, "r");
+    if(manifest == NULL) {
+        perror("Failed to open batch manifest");
+        return NULL;
+    }
+
+    size_t capacity = 16;
+    struct batchProgram* programs = malloc(capacity * sizeof(struct batchProgram));
+    CHECK_ALLOC(programs);
+    *programCount = 0;
+
+    char* line = NULL;
+    size_t lineLength = 0;
+    ssize_t read;
+    size_t lineNum = 0;
+    while((read = getline(&line, &lineLength, manifest)) != -1) {
+        lineNum++;
+        if(read > 0 && line[read - 1] == '\n') {
+            line[read - 1] = '\0';
+        }
+
+        char* description = strdup(line);
+        char* arguments = strdup(line);
+        CHECK_ALLOC(description);
+        CHECK_ALLOC(arguments);
+
+        char** argv;
+        int argc = splitArguments(arguments, programName, &argv);
+        if(argc == 1) {
+            free(argv);
+            free(arguments);
+            free(description);
+            continue;
+        }
+
+        if(*programCount == capacity) {
+            capacity *= 2;
+            programs = realloc(programs, capacity * sizeof(struct batchProgram));
+            CHECK_ALLOC(programs);
+        }
+        programs[(*programCount)++] = (struct batchProgram) {
+            .argc = argc,
+            .argv = argv,
+            .arguments = arguments,
+            .manifestLine = lineNum,
+            .description = description
+        };
+    }
+    free(line);
+    fclose(manifest);
+    return programs;
+}
+
+/**
+ * Prints the captured output of a program, preceded by a heading
+ */
+static void printProgramOutput(struct batchProgram* program, FILE* output, int exitCode) {
+    printf("==> line %zu: %s (%s)\n", program->manifestLine, program->description, (exitCode == 0) ? "ok" : "failed");
+
+    char buffer[4096];
+    size_t bytesRead;
+    rewind(output);
+    while((bytesRead = fread(buffer, 1, sizeof(buffer), output)) > 0) {
+        fwrite(buffer, 1, bytesRead, stdout);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Compiles all programs of a manifest, using at most workerCount worker processes at the same time
+ * @return 0 if all programs were compiled successfully, 1 otherwise
+ */
+int runBatch(const char* manifestPath, unsigned workerCount, char* programName, argumentParser parseArguments) {
+    size_t programCount;
+    struct batchProgram* programs = readManifest(manifestPath, programName, &programCount);
+    if(programs == NULL) {
+        return 1;
+    }
+
+    struct batchWorker* workers = calloc(workerCount, sizeof(struct batchWorker));
+    CHECK_ALLOC(workers);
+    unsigned activeWorkers = 0;
+    size_t nextProgram = 0;
+    size_t failedPrograms = 0;
+
+    while(nextProgram < programCount || activeWorkers > 0) {
+        while(activeWorkers < workerCount && nextProgram < programCount) {
+            struct batchProgram* program = &programs[nextProgram];
+            //Output is buffered in a temporary file, since a pipe could fill up and block the worker
+            FILE* output = tmpfile();
+            if(output == NULL) {
+                perror("Failed to create temporary file");
+                failedPrograms += programCount - nextProgram;
+                nextProgram = programCount;
+                break;
+            }
+
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if(pid == 0) {
+                dup2(fileno(output), STDOUT_FILENO);
+                dup2(fileno(output), STDERR_FILENO);
+
+                struct compileState compileState;
+                char* outputFileName;
+                int exitCode = parseArguments(program->argc, program->argv, &compileState, &outputFileName, NULL);
+                if(exitCode == -1) {
+                    exitCode = compile(&compileState, outputFileName);
+                }
+                fflush(NULL);
+                _exit(exitCode);
+            } else if(pid < 0) {
+                perror("Failed to start worker");
+                fclose(output);
+                break;
+            }
+
+            workers[activeWorkers++] = (struct batchWorker) {
+                .pid = pid,
+                .program = nextProgram,
+                .output = output
+            };
+            nextProgram++;
+        }
+
+        if(activeWorkers == 0) {
+            //No worker could be started
+            failedPrograms += programCount - nextProgram;
+            break;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if(pid < 0) {
+            if(errno == EINTR) continue;
+            perror("Failed to wait for worker");
+            break;
+        }
+        for(unsigned i = 0; i < activeWorkers; i++) {
+            if(workers[i].pid == pid) {
+                int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                if(exitCode != 0) {
+                    failedPrograms++;
+                }
+                printProgramOutput(&programs[workers[i].program], workers[i].output, exitCode);
+                fclose(workers[i].output);
+                workers[i] = workers[--activeWorkers];
+                break;
+            }
+        }
+    }
+
+    printf("Batch done: %zu of %zu program(s) compiled successfully\n", programCount - failedPrograms, programCount);
+
+    for(size_t i = 0; i < programCount; i++) {
+        free(programs[i].arguments);
+        free(programs[i].argv);
+        free(programs[i].description);
+    }
+    free(programs);
+    free(workers);
+    return (failedPrograms == 0) ? 0 : 1;
+}
+
+#else
+
+int runBatch(const char* manifestPath, unsigned workerCount, char* programName, argumentParser parseArguments) {
+    (void) manifestPath;
+    (void) workerCount;
+    (void) programName;
+    (void) parseArguments;
+    fprintf(stderr, "Error: batch mode is not supported on Windows\n");
+    return 1;
+}
+
+#endif
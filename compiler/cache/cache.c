@@ -0,0 +1,295 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "cache.h"
+#include "../logger/log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef LINUX
+#include <linux/fs.h>
+#endif
+#endif
+
+extern const char* const versionString;
+
+#if defined(LINUX)
+#define PLATFORM_NAME "linux"
+#elif defined(MACOS)
+#define PLATFORM_NAME "macos"
+#else
+#define PLATFORM_NAME "windows"
+#endif
+
+#define FNV_PRIME 0x100000001b3
+
+/**
+ * Continues a 64 bit FNV-1a hash with the given buffer
+ */
+uint64_t hashContinue(uint64_t hash, const void* buffer, size_t size) {
+    const unsigned char* bytes = buffer;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Hashes a buffer using 64 bit FNV-1a
+ */
+uint64_t hashBuffer(const char* buffer, size_t size) {
+    return hashContinue(FNV_OFFSET_BASIS, buffer, size);
+}
+
+#ifndef WINDOWS
+/**
+ * Hashes a string including its null byte, so that "ab","c" and "a","bc" result in different hashes
+ */
+static uint64_t hashString(uint64_t hash, const char* string) {
+    return hashContinue(hash, string, strlen(string) + 1);
+}
+
+/**
+ * Computes the path of the cache entry for the current key
+ */
+static void getEntryPath(struct compileState* compileState, char path[PATH_MAX]) {
+    snprintf(path, PATH_MAX, "%s/%016llx", compileState->cacheDir, (unsigned long long) compileState->cacheKey);
+}
+
+/**
+ * Copies a file. On file systems that support it (e.g. btrfs, XFS), the copy is a reflink that shares the data blocks
+ * with the source. The destination is created with the permissions of the source
+ * @return true if the copy succeeded
+ */
+static bool copyFile(const char* source, int destinationFd) {
+    int sourceFd = open(source, O_RDONLY);
+    if(sourceFd < 0) {
+        return false;
+    }
+
+    bool success = false;
+    #ifdef LINUX
+    if(ioctl(destinationFd, FICLONE, sourceFd) == 0) {
+        close(sourceFd);
+        return true;
+    }
+    #endif
+
+    char buffer[65536];
+    ssize_t bytesRead;
+    while((bytesRead = read(sourceFd, buffer, sizeof(buffer))) > 0) {
+        ssize_t written = 0;
+        while(written < bytesRead) {
+            ssize_t result = write(destinationFd, buffer + written, bytesRead - written);
+            if(result < 0) {
+                if(errno == EINTR) continue;
+                close(sourceFd);
+                return false;
+            }
+            written += result;
+        }
+    }
+    success = (bytesRead == 0);
+    close(sourceFd);
+    return success;
+}
+
+/**
+ * Continues the hash with the compiler version, the platform and all options that influence the translation of a file.
+ * The output mode is not included, since it only changes how the translation is assembled
+ * @return false if the working directory could not be determined
+ */
+bool hashCompileOptions(uint64_t* hash, struct compileState* compileState) {
+    *hash = hashString(*hash, versionString);
+    *hash = hashString(*hash, PLATFORM_NAME);
+
+    int flags[] = {compileState->compileMode, compileState->useStabs, compileState->martyrdom,
+                   compileState->translateMode, compileState->optimisationLevel};
+    *hash = hashContinue(*hash, flags, sizeof(flags));
+
+    //With a fixed seed, the random choices are part of the output. Otherwise, any choice is as good as the cached one
+    if(compileState->fixedRandomSeed) {
+        *hash = hashContinue(*hash, &compileState->randomState, sizeof(compileState->randomState));
+    }
+
+    //Debug info contains absolute paths
+    if(compileState->useStabs) {
+        char cwd[PATH_MAX];
+        if(getcwd(cwd, PATH_MAX) == NULL) {
+            return false;
+        }
+        *hash = hashString(*hash, cwd);
+    }
+    return true;
+}
+
+/**
+ * Continues the hash with the name and the contents of a file
+ * @return false if the file could not be read or is not a regular file
+ */
+bool hashFile(uint64_t* hash, const char* fileName) {
+    *hash = hashString(*hash, fileName);
+
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    char buffer[65536];
+    ssize_t bytesRead;
+    uint64_t size = 0;
+    while((bytesRead = read(fd, buffer, sizeof(buffer))) > 0) {
+        *hash = hashContinue(*hash, buffer, bytesRead);
+        size += bytesRead;
+    }
+    close(fd);
+    *hash = hashContinue(*hash, &size, sizeof(size));
+    return bytesRead == 0;
+}
+
+/**
+ * Computes the cache key of this compilation from the compiler version, platform, all flags influencing the output
+ * and the names and contents of all input files. The key is stored in the compile state.
+ * @return false if an input file could not be read. In that case, the cache is not used
+ */
+bool computeCacheKey(struct compileState* compileState, int fileCount, char* fileNames[]) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    if(!hashCompileOptions(&hash, compileState)) {
+        return false;
+    }
+    int outputOptions[] = {compileState->outputMode, fileCount};
+    hash = hashContinue(hash, outputOptions, sizeof(outputOptions));
+
+    for(int i = 0; i < fileCount; i++) {
+        if(!hashFile(&hash, fileNames[i])) {
+            return false;
+        }
+    }
+
+    compileState->cacheKey = hash;
+    return true;
+}
+
+/**
+ * Looks up the current key in the cache and, on a hit, copies the cached output to outputFileName
+ * @return true on a cache hit
+ */
+bool restoreFromCache(struct compileState* compileState, char* outputFileName) {
+    char path[PATH_MAX];
+    getEntryPath(compileState, path);
+
+    struct stat entryStat;
+    if(stat(path, &entryStat) != 0) {
+        printDebugMessage(compileState->logLevel, "Cache miss for key %s", 1, path);
+        return false;
+    }
+
+    //The old output is removed first, so that a reflink does not modify a file that might be in use (e.g. an executable that is running)
+    unlink(outputFileName);
+    int outputFd = open(outputFileName, O_WRONLY | O_CREAT | O_TRUNC, entryStat.st_mode & 0777);
+    if(outputFd < 0) {
+        return false;
+    }
+    bool success = copyFile(path, outputFd);
+    close(outputFd);
+    if(!success) {
+        unlink(outputFileName);
+        return false;
+    }
+    printDebugMessage(compileState->logLevel, "Cache hit, copied %s", 1, path);
+    return true;
+}
+
+/**
+ * Stores a successfully compiled output in the cache. The entry is written to a temporary file first and then renamed,
+ * so that concurrent compilations never see a partially written entry
+ */
+void storeInCache(struct compileState* compileState, char* outputFileName) {
+    if(mkdir(compileState->cacheDir, 0777) != 0 && errno != EEXIST) {
+        return;
+    }
+
+    struct stat outputStat;
+    if(stat(outputFileName, &outputStat) != 0) {
+        return;
+    }
+
+    char path[PATH_MAX];
+    char temporaryPath[PATH_MAX + sizeof(".tmp.XXXXXX")];
+    getEntryPath(compileState, path);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.XXXXXX", path);
+
+    int temporaryFd = mkstemp(temporaryPath);
+    if(temporaryFd < 0) {
+        return;
+    }
+    bool success = fchmod(temporaryFd, outputStat.st_mode & 0777) == 0 && copyFile(outputFileName, temporaryFd);
+    close(temporaryFd);
+    if(!success || rename(temporaryPath, path) != 0) {
+        unlink(temporaryPath);
+        return;
+    }
+    printDebugMessage(compileState->logLevel, "Stored output in cache as %s", 1, path);
+}
+#else
+//The cache is not supported on Windows. memeasm.c already prints a note and never sets cacheDir
+bool hashCompileOptions(uint64_t* hash, struct compileState* compileState) {
+    (void) hash;
+    (void) compileState;
+    return false;
+}
+
+bool hashFile(uint64_t* hash, const char* fileName) {
+    (void) hash;
+    (void) fileName;
+    return false;
+}
+
+bool computeCacheKey(struct compileState* compileState, int fileCount, char* fileNames[]) {
+    (void) compileState;
+    (void) fileCount;
+    (void) fileNames;
+    return false;
+}
+
+bool restoreFromCache(struct compileState* compileState, char* outputFileName) {
+    (void) compileState;
+    (void) outputFileName;
+    return false;
+}
+
+void storeInCache(struct compileState* compileState, char* outputFileName) {
+    (void) compileState;
+    (void) outputFileName;
+}
+#endif
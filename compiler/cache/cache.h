@@ -0,0 +1,37 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMEASSEMBLY_CACHE_H
+#define MEMEASSEMBLY_CACHE_H
+
+#include "../commands.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325
+
+uint64_t hashBuffer(const char* buffer, size_t size);
+uint64_t hashContinue(uint64_t hash, const void* buffer, size_t size);
+
+bool hashCompileOptions(uint64_t* hash, struct compileState* compileState);
+bool hashFile(uint64_t* hash, const char* fileName);
+
+bool computeCacheKey(struct compileState* compileState, int fileCount, char* fileNames[]);
+bool restoreFromCache(struct compileState* compileState, char* outputFileName);
+void storeInCache(struct compileState* compileState, char* outputFileName);
+
+#endif //MEMEASSEMBLY_CACHE_H
@@ -25,11 +25,15 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <stdbool.h>
 
-#define NUMBER_OF_COMMANDS 46
+#define NUMBER_OF_COMMANDS 54
 #define MAX_PARAMETER_COUNT 2
+#define MAX_LINE_NUMBER UINT32_MAX
 
 #define OR_DRAW_25_OPCODE NUMBER_OF_COMMANDS - 2;
 #define INVALID_COMMAND_OPCODE NUMBER_OF_COMMANDS - 1;
+#define NUMBER_OF_BULLY_COMMANDS 45 //Bully mode picks from the first 44 commands and "or draw 25". Inline assembly and data cannot be made up from random parameters
+
+#define COMPUTED_INDEX_START 69 //Initial value of compileState->computedIndex
 
 struct commandLinkedList {
     struct parsedCommand* command;
@@ -37,13 +41,18 @@ struct commandLinkedList {
     struct commandLinkedList* next;
 };
 
+/*
+ * One struct exists per line of code, so the members are ordered to avoid padding: on 64 bit systems, a command takes
+ * 24 bytes. Commands are passed by pointer, since copying them is not free either
+ */
 struct parsedCommand {
-    uint8_t opcode;
     char *parameters[MAX_PARAMETER_COUNT];
+    uint32_t lineNum; //Files with more than MAX_LINE_NUMBER lines are rejected by the parser
+    uint8_t opcode;
     uint8_t paramTypes[MAX_PARAMETER_COUNT];
-    uint8_t isPointer; //0 = No Pointer, 1 = first parameter, 2 = second parameter, ...
-    size_t lineNum;
-    bool translate; //Default is 1 (true). Is set to false in case this command is selected for deletion by "perfectly balanced as all things should be"
+    uint8_t isPointer : 2; //0 = No Pointer, 1 = first parameter, 2 = second parameter
+    uint8_t pointerSize : 4; //0 = not stated, otherwise the register type of the same size (e.g. PARAM_REG64 for "do you know de QWORD wey")
+    uint8_t translate : 1; //Default is 1 (true). Is set to false in case this command is selected for deletion by "perfectly balanced as all things should be"
 };
 
 struct function {
@@ -60,12 +69,77 @@ struct file {
     struct function* functions;
     struct parsedCommand* parsedCommands;
     size_t randomIndex; //A variable necessary for the "confused stonks" command
+    struct irMapping* irMapping; //Set if the file was loaded from a binary IR file. Its commands and functions point into the mapping, their parameters were already checked
+    bool summaryStub; //Set if the file was created from a summary by compileIncrementally(). Its commands only have the parameters stored in the summary, which were already checked
+};
+
+struct diagnostic {
+    char* fileName;
+    size_t lineNum;
+    bool isNote;
+    char* message;
+};
+
+//Phases measured by -ftime-report
+typedef enum { phaseParse, phaseAnalyse, phaseTranslate, phaseAssemble, NUMBER_OF_PHASES } compilePhase;
+
+struct timeReport {
+    bool enabled;
+    double phaseStart; //Time in seconds at which the current phase started
+    bool measured[NUMBER_OF_PHASES];
+    double seconds[NUMBER_OF_PHASES];
+    long peakRssKiB[NUMBER_OF_PHASES]; //Peak resident set size at the end of the phase. For the assemble phase, this is the one of gcc
+};
+
+#define MAX_STATS_SECTIONS 8
+
+//Counters printed by --stats
+struct compileStats {
+    bool enabled;
+    size_t commentLines;
+    size_t blankLines;
+    size_t parsedLines; //Lines passed to parseLine()
+    size_t unmatchedLines; //Lines that did not match any command
+    size_t matchAttempts; //Number of command patterns compared against a line, summed over all parsed lines
+    size_t maxMatchAttempts;
+    size_t commandsPerOpcode[NUMBER_OF_COMMANDS];
+    size_t parametersAllocated; //Parameters are only allocated once the whole pattern matched
+    size_t parameterBytes;
+    size_t sampledHeapBytes; //Largest heap usage sampled at the end of a phase or the analysis (a lower bound of the peak), 0 if it cannot be determined
+    bool outputCounted; //The sizes below are only known if the output was written by compileProgram()
+    unsigned sectionCount;
+    char sectionNames[MAX_STATS_SECTIONS][24];
+    size_t sectionBytes[MAX_STATS_SECTIONS];
+    size_t stabsBytes;
+};
+
+typedef enum { remarkPassed, remarkMissed } remarkKind;
+typedef enum { recordNone, recordYAML, recordJSON } remarkRecordFormat;
+
+struct remark {
+    remarkKind kind;
+    const char* pass; //e.g. "perfectly-balanced". Matched against the regular expressions of -Rpass and -Rpass-missed
+    const char* name; //Identifies the kind of transformation within the pass, e.g. "LineDeleted"
+    char* fileName;
+    size_t lineNum; //0 if the remark refers to the whole file
+    char* message;
+};
+
+//Optimisation remarks, which report how the program was transformed (-Rpass, -Rpass-missed, -fsave-optimization-record)
+struct remarks {
+    bool enabled; //If not set, emitRemark() returns immediately
+    struct remarkFilter* filters[2]; //Indexed by remarkKind. If NULL, remarks of this kind are not printed
+    remarkRecordFormat recordFormat; //If set, all remarks are collected and written to recordFileName after compilation
+    char* recordFileName;
+    struct remark* records;
+    size_t recordCount;
+    size_t recordCapacity;
 };
 
 typedef enum { noob, bully, obfuscated } compileMode;
-typedef enum { executable, assemblyFile, objectFile } outputMode;
+typedef enum { executable, assemblyFile, objectFile, irBinaryFile } outputMode;
 typedef enum { intSISD = 0, intSIMD = 1, floatSISD = 2, floatSIMD = 3, doubleSISD = 4, doubleSIMD = 5 } translateMode;
-typedef enum { none, o_1 = -1, o_2 = -2, o_3 = -3, o_s, o69420 = 69420} optimisationLevel;
+typedef enum { none, o_1 = -1, o_2 = -2, o_3 = -3, o_s = -4, o69420 = 69420} optimisationLevel;
 typedef enum { normal, info, debug } logLevel;
 
 struct compileState {
@@ -76,11 +150,28 @@ struct compileState {
 
     bool useStabs;
     bool martyrdom;
+    bool stackUsage; //If set, a report of the maximum stack depth of each function is printed
+    char* cacheDir; //If not NULL, outputs are looked up in and stored in this directory (--cache-dir)
+    uint64_t cacheKey; //Hash of the inputs and flags of this compilation, only valid if cacheDir is set
+    char* buildDir; //If not NULL, files are compiled into separate objects in this directory and only rebuilt if they changed (--build-dir). Files are then parsed by compileIncrementally()
+    unsigned jobs; //If greater than 1, files are translated and assembled into separate objects by this many processes in parallel (-j)
+    bool streaming; //If set, files are parsed, analysed and translated one function at a time to bound memory usage (--stream). Files are then parsed by compileStreaming()
+    uint64_t randomState; //State of the random number generator used by "confused stonks" and "perfectly balanced...", see seedRandom(). If 0, it is seeded with the current time on first use
+    bool fixedRandomSeed; //If set, the seed was chosen by the user (-frandom-seed) and the output is reproducible
+    uint64_t computedIndex; //Pseudo-random value derived from the input in bully mode. Must be initialised with COMPUTED_INDEX_START
+    struct timeReport timeReport; //If enabled, the duration and memory usage of each phase is printed as JSON after compilation (-ftime-report)
+    struct compileStats stats; //If enabled, counters of the parser, the memory usage and the output size are printed as JSON after compilation (--stats)
+    struct remarks remarks; //Transformations done by the compiler, printed while compiling and/or written to a file afterwards
     translateMode translateMode;
     optimisationLevel optimisationLevel;
 
     unsigned compilerErrors;
     logLevel logLevel;
+
+    bool collectDiagnostics; //If set, errors and notes are collected in the diagnostics-array instead of being printed (library mode)
+    struct diagnostic* diagnostics;
+    size_t diagnosticCount;
+    size_t diagnosticCapacity;
 };
 
 // Parameter types
@@ -101,6 +192,13 @@ struct compileState {
 #define COMMAND_TYPE_FUNC_RETURN 2
 #define COMMAND_TYPE_FUNC_DEF 3
 #define COMMAND_TYPE_FUNC_CALL 4
+//Inline assembly. The parameter of a block start (the clobber list) and of an assembly line is the rest of the line, it is not split into tokens
+#define COMMAND_TYPE_INLINE_ASM_START 5
+#define COMMAND_TYPE_INLINE_ASM 6
+#define COMMAND_TYPE_INLINE_ASM_END 7
+#define COMMAND_TYPE_IS_INLINE_ASM(type) ((type) >= COMMAND_TYPE_INLINE_ASM_START && (type) <= COMMAND_TYPE_INLINE_ASM_END)
+//Data declarations. The first parameter is the name, the second one the values (rest of the line). The translation pattern is the directive that emits the values
+#define COMMAND_TYPE_DATA 8
 
 struct command {
     char *pattern;
@@ -139,5 +237,8 @@ struct command {
 #define orDraw25End "draw 25"
 
 #define pointerSuffix "do you know de wey"
+//The size of the memory access can be stated in between, e.g. "do you know de QWORD wey"
+#define sizedPointerSuffixStart "do you know de "
+#define sizedPointerSuffixEnd " wey"
 
 #endif //MEMEASSEMBLY_COMMANDS_H
@@ -23,10 +23,21 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <stdbool.h>
 #include <string.h>
 #include <stdarg.h>
+#ifndef WINDOWS
+#include <sys/wait.h>
+#endif
 
 #include "parser/parser.h"
 #include "analyser/analyser.h"
+#include "analyser/stackUsage.h"
 #include "translator/translator.h"
+#include "cache/cache.h"
+#include "incremental/incremental.h"
+#include "ir/ir.h"
+#include "streaming/streaming.h"
+#include "report/timeReport.h"
+#include "report/stats.h"
+#include "report/remarks.h"
 #include "logger/log.h"
 
 const struct command commandList[NUMBER_OF_COMMANDS] = {
@@ -384,6 +395,70 @@ const struct command commandList[NUMBER_OF_COMMANDS] = {
             .analysisFunction = NULL,
             .translationPattern = "int3"
         },
+
+        ///Inline assembly
+        {
+            .pattern = "this is where the fun begins, I'm touching {p}",
+            .commandType = COMMAND_TYPE_INLINE_ASM_START,
+            .usedParameters = 1,
+            .analysisFunction = NULL,
+            .translationPattern = "# inline assembly, clobbers: {0}"
+        },
+        {
+            .pattern = "trust me bro {p}",
+            .commandType = COMMAND_TYPE_INLINE_ASM,
+            .usedParameters = 1,
+            .analysisFunction = NULL,
+            .translationPattern = "{0}"
+        },
+        {
+            .pattern = "it just works",
+            .commandType = COMMAND_TYPE_INLINE_ASM_END,
+            .usedParameters = 0,
+            .analysisFunction = NULL,
+            .translationPattern = "# end of inline assembly"
+        },
+
+        ///Data
+        {
+            .pattern = "{p} shows de wey to {p}",
+            .usedParameters = 2,
+            .allowedParamTypes = {PARAM_FUNC_NAME, PARAM_REG64},
+            .analysisFunction = &analyseData,
+            .translationPattern = "lea {1}, [rip + {0}]"
+        },
+        {
+            .pattern = "look at all those bytes {p}: {p}",
+            .commandType = COMMAND_TYPE_DATA,
+            .usedParameters = 2,
+            .allowedParamTypes = {PARAM_FUNC_NAME},
+            .analysisFunction = NULL,
+            .translationPattern = ".byte"
+        },
+        {
+            .pattern = "look at all those qwords {p}: {p}",
+            .commandType = COMMAND_TYPE_DATA,
+            .usedParameters = 2,
+            .allowedParamTypes = {PARAM_FUNC_NAME},
+            .analysisFunction = NULL,
+            .translationPattern = ".quad"
+        },
+        {
+            .pattern = "look at all those chars {p}: {p}",
+            .commandType = COMMAND_TYPE_DATA,
+            .usedParameters = 2,
+            .allowedParamTypes = {PARAM_FUNC_NAME},
+            .analysisFunction = NULL,
+            .translationPattern = ".asciz"
+        },
+        {
+            .pattern = "{p} is free real estate: {p}",
+            .commandType = COMMAND_TYPE_DATA,
+            .usedParameters = 2,
+            .allowedParamTypes = {PARAM_FUNC_NAME},
+            .analysisFunction = NULL,
+            .translationPattern = ".zero"
+        },
         //Insert commands above this one
         {
             .pattern = "or draw 25",
@@ -402,35 +477,55 @@ const struct command commandList[NUMBER_OF_COMMANDS] = {
 
 
 /**
- *
- * @param compileState a struct containing all necessary infos. Most notably, it contains the outputMode, optimisation level and all parsed input files
- * @param outputFileName the name of the output file
+ * Runs all analysis checks on the parsed files and prints an error summary if any errors were found
+ * @return true if the program can be translated, false otherwise
  */
-void compile(struct compileState compileState, char* outputFileName) {
-    ///Analysis
-    analyseCommands(&compileState);
+bool analyseProgram(struct compileState* compileState) {
+    analyseCommands(compileState);
 
-    //Analysis done. If any errors occurred until now, print to stderr and exit
-    if(compileState.compilerErrors > 0) {
-        printErrorASCII();
-        fprintf(stderr, "Compilation failed with %u error(s), please check your code and try again.\n", compileState.compilerErrors);
-        exit(EXIT_FAILURE);
+    //Analysis done. If any errors occurred until now, print to stderr and return
+    if(compileState->compilerErrors > 0) {
+        if(!compileState->collectDiagnostics) {
+            printErrorASCII();
+            fprintf(stderr, "Compilation failed with %u error(s), please check your code and try again.\n", compileState->compilerErrors);
+        }
+        return false;
     }
 
-    ///Translation
+    if(compileState->stackUsage) {
+        printStackUsage(compileState);
+    }
+    return true;
+}
+
+/**
+ * Analyses the parsed files and writes the generated assembly code into the given stream
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compileToStream(struct compileState* compileState, FILE* outputStream) {
+    if(!analyseProgram(compileState)) {
+        return EXIT_FAILURE;
+    }
+    writeToFile(compileState, outputStream);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Opens the stream the assembly code is written to. This is either the output file or a pipe into gcc
+ * @return the stream, or NULL if it could not be opened. Close it using closeAssemblyOutput()
+ */
+FILE* openAssemblyOutput(struct compileState* compileState, char* outputFileName) {
     FILE* output;
-    int gccResult = 0;
     //When generating an assembly file, we open the output file in writing mode directly
-    if(compileState.outputMode == assemblyFile) {
+    if(compileState->outputMode == assemblyFile) {
         output = fopen(outputFileName, "w") ;
         if(output == NULL) {
             perror("Failed to open output file");
-            exit(EXIT_FAILURE);
         }
     //When letting gcc do the work for us (object file or executable), we just pipe the code into gcc via stdin
     } else {
         char* commandPrefix;
-        if(compileState.outputMode == objectFile) {
+        if(compileState->outputMode == objectFile) {
             #ifndef LINUX
             commandPrefix = "gcc -w -O -c -x assembler - -o";
             #else
@@ -450,20 +545,105 @@ void compile(struct compileState compileState, char* outputFileName) {
 
         // Pipe assembler code directly to GCC via stdin
         output = popen(command, "w");
+        if(output == NULL) {
+            perror("Failed to start gcc");
+        }
     }
+    return output;
+}
 
-    writeToFile(&compileState, output);
-
-    if(compileState.outputMode == assemblyFile) {
+/**
+ * Closes the stream opened by openAssemblyOutput(). If gcc was used, waits for it to finish
+ * @return EXIT_SUCCESS if gcc succeeded, EXIT_FAILURE otherwise
+ */
+int closeAssemblyOutput(struct compileState* compileState, FILE* output) {
+    int gccResult = 0;
+    if(compileState->outputMode == assemblyFile) {
         fclose(output);
     } else {
         gccResult = pclose(output);
+        #ifndef WINDOWS
+        //pclose() returns the wait status of gcc
+        if(gccResult != -1 && WIFEXITED(gccResult)) {
+            gccResult = WEXITSTATUS(gccResult);
+        }
+        #endif
     }
 
     if(gccResult != 0) {
         fprintf(stderr, "gcc exited unexpectedly with exit code %d. If you did not expect this to happen, please report this issue at https://github.com/kammt/MemeAssembly/issues so that it can be fixed\n", gccResult);
-        exit(EXIT_FAILURE);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Translates all files into a single assembly stream, which is either written to the output file or assembled by gcc
+ * @param compileState a struct containing all necessary infos. Most notably, it contains the outputMode, optimisation level and all parsed input files
+ * @param outputFileName the name of the output file
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compileProgram(struct compileState* compileState, char* outputFileName) {
+    ///Analysis
+    if(!analyseProgram(compileState)) {
+        return EXIT_FAILURE;
+    }
+    endPhase(compileState, phaseAnalyse);
+
+    ///Translation
+    FILE* output = openAssemblyOutput(compileState, outputFileName);
+    if(output == NULL) {
+        return EXIT_FAILURE;
+    }
+    FILE* translationOutput = startCountingOutput(compileState, output);
+    writeToFile(compileState, translationOutput);
+    stopCountingOutput(translationOutput, output);
+    //gcc assembles while the code is piped into it, so the translate phase includes the time gcc takes to read it
+    fflush(output);
+    endPhase(compileState, phaseTranslate);
+    int result = closeAssemblyOutput(compileState, output);
+    if(compileState->outputMode != assemblyFile) {
+        endPhase(compileState, phaseAssemble);
+    }
+    return result;
+}
+
+/**
+ *
+ * @param compileState a struct containing all necessary infos. Most notably, it contains the outputMode, optimisation level and all input files
+ * @param outputFileName the name of the output file
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compile(struct compileState* compileState, char* outputFileName) {
+    int result;
+    if(compileState->outputMode == irBinaryFile) {
+        //Binary IR files contain the analysed program instead of its translation
+        result = EXIT_FAILURE;
+        if(analyseProgram(compileState)) {
+            endPhase(compileState, phaseAnalyse);
+            result = writeIRFile(compileState, outputFileName);
+            endPhase(compileState, phaseTranslate);
+        }
+    } else if(compileState->streaming) {
+        result = compileStreaming(compileState, outputFileName);
+        endPhase(compileState, phaseTranslate);
+    } else if(compileState->buildDir != NULL) {
+        result = compileIncrementally(compileState, outputFileName);
+        endPhase(compileState, phaseTranslate);
+    } else if(compileState->jobs > 1 && compileState->fileCount > 1 && compileState->outputMode != assemblyFile) {
+        result = compileSeparately(compileState, outputFileName);
+        endPhase(compileState, phaseTranslate);
     } else {
-        exit(EXIT_SUCCESS);
+        result = compileProgram(compileState, outputFileName);
+    }
+
+    if(result == EXIT_SUCCESS && compileState->cacheDir != NULL) {
+        storeInCache(compileState, outputFileName);
+    }
+    printTimeReport(compileState, stderr);
+    printStats(compileState, stderr);
+    if(!finishRemarks(compileState)) {
+        result = EXIT_FAILURE;
     }
+    return result;
 }
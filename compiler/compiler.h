@@ -24,6 +24,11 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <stdbool.h>
 #include "commands.h"
 
-_Noreturn void compile(struct compileState compileState, char* outputFileName);
+int compile(struct compileState* compileState, char* outputFileName);
+int compileProgram(struct compileState* compileState, char* outputFileName);
+bool analyseProgram(struct compileState* compileState);
+int compileToStream(struct compileState* compileState, FILE* outputStream);
+FILE* openAssemblyOutput(struct compileState* compileState, char* outputFileName);
+int closeAssemblyOutput(struct compileState* compileState, FILE* output);
 
 #endif
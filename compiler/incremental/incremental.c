@@ -0,0 +1,704 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Incremental compilation (--build-dir). Every input file is translated into its own object file. Next to the object,
+ * a summary of the file is stored, containing its hash and all symbols that are relevant to other files:
+ * defined functions, called functions, monke labels, jumps to monke labels, data declarations and loads of data addresses.
+ *
+ * On a rebuild, only files whose hash changed are parsed. All other files are replaced by stub files, which are
+ * created from the summary and only contain the commands listed there. The analysis then runs on the whole program,
+ * so that errors caused by changes in other files (e.g. a called function that was removed) are still reported.
+ * Afterwards, only the changed files are translated and assembled, and all objects are linked.
+ *
+ * A full build is done instead if the program contains "perfectly balanced as all things should be" (which deletes
+ * commands of all files) or a jump to a monke label in another file (local labels cannot be resolved across objects).
+ *
+ * Separate compilation (-j without --build-dir) uses the same per-file objects, but stores them in a temporary directory.
+ * In both modes, up to compileState->jobs files are translated and assembled in parallel, each in a forked process.
+ */
+
+#include "incremental.h"
+#include "../compiler.h"
+#include "../parser/parser.h"
+#include "../logger/log.h"
+#include "../cache/cache.h"
+#include "../translator/translator.h"
+#include "../analyser/jumpMarkers.h"
+#include "../analyser/randomCommands.h"
+#include "../analyser/data.h"
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define SUMMARY_HEADER "memeasm-summary"
+
+extern const struct command commandList[];
+
+struct fileArtifacts {
+    char summaryPath[PATH_MAX];
+    char objectPath[PATH_MAX];
+    uint64_t hash;
+    bool changed; //If true, the file was parsed and needs to be assembled again
+    bool usesBalanced; //The file contains "perfectly balanced as all things should be"
+};
+
+//The opcodes of all commands that appear in a summary
+struct summaryOpcodes {
+    uint8_t functionDefinition;
+    uint8_t functionCall;
+    uint8_t monkeLabel;
+    uint8_t monkeJump;
+    uint8_t balanced;
+    uint8_t data; //All kinds of data share one namespace, so declarations are loaded with the opcode of the first kind
+    uint8_t dataAddress;
+};
+
+static struct summaryOpcodes findSummaryOpcodes(void) {
+    struct summaryOpcodes opcodes = {0};
+    for(uint8_t i = NUMBER_OF_COMMANDS; i-- > 0;) {
+        if(commandList[i].commandType == COMMAND_TYPE_DATA) {
+            opcodes.data = i;
+        } else if(commandList[i].analysisFunction == &analyseData) {
+            opcodes.dataAddress = i;
+        } else if(commandList[i].commandType == COMMAND_TYPE_FUNC_DEF) {
+            opcodes.functionDefinition = i;
+        } else if(commandList[i].commandType == COMMAND_TYPE_FUNC_CALL) {
+            opcodes.functionCall = i;
+        } else if(commandList[i].analysisFunction == &analyseMonkeMarkers) {
+            opcodes.monkeLabel = i;
+            opcodes.monkeJump = i + 1;
+        } else if(commandList[i].analysisFunction == &chooseLinesToBeDeleted) {
+            opcodes.balanced = i;
+        }
+    }
+    return opcodes;
+}
+
+/**
+ * Determines where the summary and object of a file are stored. The names are derived from the absolute path of the file
+ */
+static void getArtifactPaths(const char* buildDir, const char* fileName, struct fileArtifacts* artifacts) {
+    char absolutePath[PATH_MAX];
+    const char* path = (realpath(fileName, absolutePath) != NULL) ? absolutePath : fileName;
+    unsigned long long pathHash = hashBuffer(path, strlen(path));
+    snprintf(artifacts->summaryPath, PATH_MAX, "%s/%016llx.summary", buildDir, pathHash);
+    snprintf(artifacts->objectPath, PATH_MAX, "%s/%016llx.o", buildDir, pathHash);
+}
+
+/**
+ * Creates a stub file from the summary of a file. The stub contains a function definition for every function of the file,
+ * followed by the calls, monke labels, monke jumps and data address loads of that function. The data declarations of
+ * the file follow after the last function
+ * @return false if the summary does not exist, does not belong to the current version of the file or is invalid
+ */
+static bool loadSummary(struct file* fileStruct, struct fileArtifacts* artifacts, struct summaryOpcodes* opcodes) {
+    FILE* summaryFile = fopen(artifacts->summaryPath, "r");
+    if(summaryFile == NULL) {
+        return false;
+    }
+
+    unsigned long long hash;
+    if(fscanf(summaryFile, SUMMARY_HEADER " %llx\n", &hash) != 1 || hash != artifacts->hash || access(artifacts->objectPath, R_OK) != 0) {
+        fclose(summaryFile);
+        return false;
+    }
+
+    size_t capacity = 16;
+    size_t commandCount = 0;
+    size_t functionCount = 0;
+    struct parsedCommand* commands = calloc(capacity, sizeof(struct parsedCommand));
+    CHECK_ALLOC(commands);
+
+    char kind[16];
+    char name[256];
+    size_t lineNum;
+    bool valid = true;
+    bool dataDeclared = false;
+    while(fscanf(summaryFile, "%15s %zu", kind, &lineNum) == 2) {
+        if(strcmp(kind, "balanced") == 0) {
+            artifacts->usesBalanced = true;
+            continue;
+        }
+        if(fscanf(summaryFile, " %255s", name) != 1) {
+            valid = false;
+            break;
+        }
+
+        uint8_t opcode;
+        if(strcmp(kind, "data") == 0) {
+            opcode = opcodes->data;
+            dataDeclared = true;
+        } else if(strcmp(kind, "function") == 0) {
+            opcode = opcodes->functionDefinition;
+            functionCount++;
+        } else if(strcmp(kind, "call") == 0) {
+            opcode = opcodes->functionCall;
+        } else if(strcmp(kind, "monke") == 0) {
+            opcode = opcodes->monkeLabel;
+        } else if(strcmp(kind, "jump") == 0) {
+            opcode = opcodes->monkeJump;
+        } else if(strcmp(kind, "address") == 0) {
+            opcode = opcodes->dataAddress;
+        } else {
+            valid = false;
+            break;
+        }
+        //Every command except data declarations must belong to a function, and data is declared after the last function
+        if(opcode != opcodes->data && (functionCount == 0 || dataDeclared)) {
+            valid = false;
+            break;
+        }
+
+        if(commandCount == capacity) {
+            capacity *= 2;
+            commands = realloc(commands, capacity * sizeof(struct parsedCommand));
+            CHECK_ALLOC(commands);
+        }
+        commands[commandCount] = (struct parsedCommand) {
+            .opcode = opcode,
+            .lineNum = lineNum,
+            .translate = true
+        };
+        commands[commandCount].parameters[0] = strdup(name);
+        CHECK_ALLOC(commands[commandCount].parameters[0]);
+        commandCount++;
+    }
+    valid = valid && feof(summaryFile);
+    fclose(summaryFile);
+
+    struct function* functions = calloc(functionCount, sizeof(struct function));
+    CHECK_ALLOC(functions);
+    fileStruct->parsedCommands = commands;
+    fileStruct->functions = functions;
+    fileStruct->loc = commandCount;
+    fileStruct->functionCount = functionCount;
+    fileStruct->randomIndex = SIZE_MAX;
+    fileStruct->summaryStub = true;
+    if(!valid) {
+        freeFile(fileStruct, noob);
+        fileStruct->summaryStub = false;
+        return false;
+    }
+
+    size_t functionIndex = 0;
+    for(size_t i = 0; i < commandCount && commands[i].opcode != opcodes->data; i++) {
+        if(commands[i].opcode == opcodes->functionDefinition) {
+            functions[functionIndex++] = (struct function) {
+                .definedInFile = fileStruct->fileName,
+                .definedInLine = commands[i].lineNum,
+                .commands = &commands[i]
+            };
+        }
+        functions[functionIndex - 1].numberOfCommands++;
+    }
+    return true;
+}
+
+/**
+ * Writes the summary of a parsed file after it was assembled. It is written to a temporary file first, so that an interrupted
+ * build never leaves a summary that does not match its object
+ */
+static void writeSummary(struct compileState* compileState, unsigned fileNum, struct fileArtifacts* artifacts) {
+    struct file* fileStruct = &compileState->files[fileNum];
+    struct summaryOpcodes opcodes = findSummaryOpcodes();
+
+    char temporaryPath[PATH_MAX + sizeof(".tmp")];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", artifacts->summaryPath);
+    FILE* summaryFile = fopen(temporaryPath, "w");
+    if(summaryFile == NULL) {
+        return;
+    }
+
+    fprintf(summaryFile, SUMMARY_HEADER " %016llx\n", (unsigned long long) artifacts->hash);
+    for(size_t i = 0; i < fileStruct->functionCount; i++) {
+        struct function* function = &fileStruct->functions[i];
+        for(size_t j = 0; j < function->numberOfCommands; j++) {
+            struct parsedCommand* command = &function->commands[j];
+            const char* kind = NULL;
+            if(command->opcode == opcodes.functionDefinition) {
+                kind = "function";
+            } else if(command->opcode == opcodes.functionCall) {
+                kind = "call";
+            } else if(command->opcode == opcodes.monkeLabel) {
+                kind = "monke";
+            } else if(command->opcode == opcodes.monkeJump) {
+                kind = "jump";
+            } else if(command->opcode == opcodes.dataAddress) {
+                kind = "address";
+            } else if(command->opcode == opcodes.balanced) {
+                fprintf(summaryFile, "balanced %u\n", command->lineNum);
+            }
+            if(kind != NULL) {
+                fprintf(summaryFile, "%s %u %s\n", kind, command->lineNum, command->parameters[0]);
+            }
+        }
+    }
+    for(size_t i = 0; i < fileStruct->loc; i++) {
+        struct parsedCommand* command = &fileStruct->parsedCommands[i];
+        if(commandList[command->opcode].commandType == COMMAND_TYPE_DATA) {
+            fprintf(summaryFile, "data %u %s\n", command->lineNum, command->parameters[0]);
+        }
+    }
+
+    bool success = (fclose(summaryFile) == 0);
+    if(!success || rename(temporaryPath, artifacts->summaryPath) != 0) {
+        unlink(temporaryPath);
+    }
+}
+
+/**
+ * Checks if the file contains "perfectly balanced as all things should be"
+ */
+static bool usesBalanced(struct file* fileStruct, struct summaryOpcodes* opcodes) {
+    for(size_t i = 0; i < fileStruct->loc; i++) {
+        if(fileStruct->parsedCommands[i].opcode == opcodes->balanced) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct monkeLabel {
+    const char* name; //NULL if the slot is empty. Points to the parameter of the command
+    unsigned fileNum;
+    bool definedInSeveralFiles;
+};
+
+//Hash set of the monke labels of all files using open addressing, like the symbol tables of streaming mode
+struct monkeLabelSet {
+    struct monkeLabel* entries;
+    size_t capacity; //Always a power of two
+};
+
+/**
+ * @return the slot of the label. If the label does not exist, this is the empty slot it would be inserted into
+ */
+static struct monkeLabel* findMonkeLabel(struct monkeLabelSet* set, const char* name) {
+    size_t index = hashBuffer(name, strlen(name)) & (set->capacity - 1);
+    while(set->entries[index].name != NULL && strcmp(set->entries[index].name, name) != 0) {
+        index = (index + 1) & (set->capacity - 1);
+    }
+    return &set->entries[index];
+}
+
+/**
+ * Checks if a file jumps to a monke label that is defined in another file. The labels of all files are collected first,
+ * so that every jump is only looked up once
+ */
+static bool hasCrossFileMonkeJump(struct compileState* compileState, struct summaryOpcodes* opcodes) {
+    size_t labelCount = 0;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        for(size_t j = 0; j < compileState->files[i].loc; j++) {
+            labelCount += compileState->files[i].parsedCommands[j].opcode == opcodes->monkeLabel;
+        }
+    }
+    if(labelCount == 0) {
+        return false;
+    }
+
+    //Keep the load factor below 1/2
+    struct monkeLabelSet labels = {.capacity = 16};
+    while(labels.capacity < 2 * labelCount) {
+        labels.capacity *= 2;
+    }
+    labels.entries = calloc(labels.capacity, sizeof(struct monkeLabel));
+    CHECK_ALLOC(labels.entries);
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        struct file* labelFile = &compileState->files[i];
+        for(size_t j = 0; j < labelFile->loc; j++) {
+            if(labelFile->parsedCommands[j].opcode != opcodes->monkeLabel) {
+                continue;
+            }
+            struct monkeLabel* label = findMonkeLabel(&labels, labelFile->parsedCommands[j].parameters[0]);
+            if(label->name == NULL) {
+                *label = (struct monkeLabel) {labelFile->parsedCommands[j].parameters[0], i, false};
+            } else if(label->fileNum != i) {
+                label->definedInSeveralFiles = true;
+            }
+        }
+    }
+
+    bool crossFileJump = false;
+    for(unsigned i = 0; i < compileState->fileCount && !crossFileJump; i++) {
+        struct file* jumpFile = &compileState->files[i];
+        for(size_t j = 0; j < jumpFile->loc && !crossFileJump; j++) {
+            if(jumpFile->parsedCommands[j].opcode != opcodes->monkeJump) {
+                continue;
+            }
+            struct monkeLabel* label = findMonkeLabel(&labels, jumpFile->parsedCommands[j].parameters[0]);
+            crossFileJump = label->name != NULL && (label->definedInSeveralFiles || label->fileNum != i);
+        }
+    }
+
+    free(labels.entries);
+    return crossFileJump;
+}
+
+/**
+ * Parses a file. The file was already checked by parseArguments()
+ */
+static bool parseInputFile(struct file* fileStruct, struct compileState* compileState) {
+    FILE* inputFile = fopen(fileStruct->fileName, "r");
+    if(inputFile == NULL) {
+        perror("Failed to open input file");
+        return false;
+    }
+    parseFile(fileStruct, inputFile, compileState);
+    fclose(inputFile);
+    return true;
+}
+
+/**
+ * Starts a process whose stdin is connected to a pipe
+ * @param argv the arguments of the process. argv[0] is searched for in the PATH
+ * @param input is set to a stream writing into the stdin of the process. If NULL, stdin is inherited
+ * @return the process id or -1 on failure
+ */
+static pid_t startProcess(char* const argv[], FILE** input) {
+    int pipeFds[2] = {-1, -1};
+    //The write end must not be inherited by other children, otherwise they would keep the pipe open
+    if(input != NULL && (pipe(pipeFds) != 0 || fcntl(pipeFds[1], F_SETFD, FD_CLOEXEC) != 0)) {
+        perror("Failed to create pipe");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        if(input != NULL) {
+            dup2(pipeFds[0], STDIN_FILENO);
+            close(pipeFds[0]);
+        }
+        execvp(argv[0], argv);
+        perror("Failed to start gcc");
+        _exit(127);
+    }
+
+    if(input != NULL) {
+        close(pipeFds[0]);
+        if(pid < 0) {
+            close(pipeFds[1]);
+        } else {
+            *input = fdopen(pipeFds[1], "w");
+        }
+    }
+    if(pid < 0) {
+        perror("Failed to start gcc");
+    }
+    return pid;
+}
+
+/**
+ * Waits for a process started by startProcess()
+ * @return true if the process exited successfully
+ */
+static bool waitForProcess(pid_t pid) {
+    int status;
+    while(waitpid(pid, &status, 0) < 0) {
+        if(errno != EINTR) {
+            return false;
+        }
+    }
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "gcc exited unexpectedly with exit code %d. If you did not expect this to happen, please report this issue at https://github.com/kammt/MemeAssembly/issues so that it can be fixed\n",
+                WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Translates a file and assembles it into its object file
+ */
+static bool assembleFile(struct compileState* compileState, unsigned fileNum, struct fileArtifacts* artifacts) {
+    char temporaryPath[PATH_MAX + sizeof(".tmp")];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", artifacts->objectPath);
+
+    char* const argv[] = {"gcc",
+                          #ifdef LINUX
+                          "-z", "execstack",
+                          #endif
+                          "-w", "-O", "-c", "-x", "assembler", "-", "-o", temporaryPath, NULL};
+    FILE* assemblerInput;
+    pid_t pid = startProcess(argv, &assemblerInput);
+    if(pid < 0) {
+        return false;
+    }
+    writeFileToFile(compileState, fileNum, assemblerInput);
+    fclose(assemblerInput);
+
+    if(!waitForProcess(pid) || rename(temporaryPath, artifacts->objectPath) != 0) {
+        unlink(temporaryPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Translates and assembles all changed files. Up to compileState->jobs files are processed at the same time, each in
+ * a forked copy of the compiler that pipes its translation into its own gcc process
+ * @param onAssembled if not NULL, called in this process for every file that was assembled successfully
+ * @return true if all files were assembled successfully
+ */
+static bool assembleFiles(struct compileState* compileState, struct fileArtifacts* artifacts,
+                          void (*onAssembled)(struct compileState*, unsigned, struct fileArtifacts*)) {
+    unsigned jobs = (compileState->jobs > 1) ? compileState->jobs : 1;
+    bool success = true;
+
+    if(jobs == 1) {
+        for(unsigned i = 0; i < compileState->fileCount && success; i++) {
+            if(artifacts[i].changed) {
+                printDebugMessage(compileState->logLevel, "Assembling %s into %s", 2, compileState->files[i].fileName, artifacts[i].objectPath);
+                success = assembleFile(compileState, i, &artifacts[i]);
+                if(success && onAssembled != NULL) {
+                    onAssembled(compileState, i, &artifacts[i]);
+                }
+            }
+        }
+        return success;
+    }
+
+    pid_t* workers = calloc(jobs, sizeof(pid_t));
+    unsigned* workerFiles = calloc(jobs, sizeof(unsigned));
+    CHECK_ALLOC(workers);
+    CHECK_ALLOC(workerFiles);
+
+    unsigned nextFile = 0;
+    unsigned running = 0;
+    while(true) {
+        //Start new workers as long as there are free slots, but stop after the first error
+        while(success && running < jobs && nextFile < compileState->fileCount) {
+            unsigned fileNum = nextFile++;
+            if(!artifacts[fileNum].changed) {
+                continue;
+            }
+            printDebugMessage(compileState->logLevel, "Assembling %s into %s", 2, compileState->files[fileNum].fileName, artifacts[fileNum].objectPath);
+
+            //Buffered output would otherwise be printed by the worker as well
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if(pid == 0) {
+                _exit(assembleFile(compileState, fileNum, &artifacts[fileNum]) ? EXIT_SUCCESS : EXIT_FAILURE);
+            } else if(pid < 0) {
+                perror("Failed to start worker");
+                success = false;
+                break;
+            }
+
+            for(unsigned slot = 0; slot < jobs; slot++) {
+                if(workers[slot] == 0) {
+                    workers[slot] = pid;
+                    workerFiles[slot] = fileNum;
+                    break;
+                }
+            }
+            running++;
+        }
+
+        if(running == 0) {
+            break;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if(pid < 0) {
+            if(errno == EINTR) continue;
+            success = false;
+            break;
+        }
+        for(unsigned slot = 0; slot < jobs; slot++) {
+            if(workers[slot] == pid) {
+                workers[slot] = 0;
+                running--;
+                if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+                    if(onAssembled != NULL) {
+                        onAssembled(compileState, workerFiles[slot], &artifacts[workerFiles[slot]]);
+                    }
+                } else {
+                    success = false;
+                }
+                break;
+            }
+        }
+    }
+
+    free(workers);
+    free(workerFiles);
+    return success;
+}
+
+/**
+ * Links all objects into the output file. If an object file is to be generated, the objects are combined into one relocatable object
+ */
+static bool linkObjects(struct compileState* compileState, struct fileArtifacts* artifacts, char* outputFileName) {
+    char* prefix[] = {"gcc",
+                      #ifdef LINUX
+                      "-z", "execstack", "-no-pie",
+                      #endif
+                      "-w", "-o", outputFileName};
+    size_t prefixLength = sizeof(prefix) / sizeof(char*);
+    //Additional space for "-r", "-nostdlib" and NULL
+    char** argv = calloc(prefixLength + compileState->fileCount + 3, sizeof(char*));
+    CHECK_ALLOC(argv);
+
+    size_t argc = 0;
+    for(size_t i = 0; i < prefixLength; i++) {
+        argv[argc++] = prefix[i];
+    }
+    if(compileState->outputMode == objectFile) {
+        argv[argc++] = "-r";
+        argv[argc++] = "-nostdlib";
+    }
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        argv[argc++] = artifacts[i].objectPath;
+    }
+
+    pid_t pid = startProcess(argv, NULL);
+    free(argv);
+    return pid >= 0 && waitForProcess(pid);
+}
+
+/**
+ * Compiles the program using the summaries and objects in compileState->buildDir. Only the files that changed since the
+ * last build are parsed and assembled. The files in the compile state must not have been parsed yet
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compileIncrementally(struct compileState* compileState, char* outputFileName) {
+    if(mkdir(compileState->buildDir, 0777) != 0 && errno != EEXIST) {
+        perror("Failed to create build directory");
+        return EXIT_FAILURE;
+    }
+
+    struct summaryOpcodes opcodes = findSummaryOpcodes();
+    uint64_t optionsHash = FNV_OFFSET_BASIS;
+    bool fullBuild = !hashCompileOptions(&optionsHash, compileState);
+
+    struct fileArtifacts* artifacts = calloc(compileState->fileCount, sizeof(struct fileArtifacts));
+    CHECK_ALLOC(artifacts);
+
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        struct file* fileStruct = &compileState->files[i];
+        getArtifactPaths(compileState->buildDir, fileStruct->fileName, &artifacts[i]);
+        artifacts[i].hash = optionsHash;
+        fullBuild |= !hashFile(&artifacts[i].hash, fileStruct->fileName);
+
+        if(!fullBuild && loadSummary(fileStruct, &artifacts[i], &opcodes)) {
+            printDebugMessage(compileState->logLevel, "%s is unchanged, using summary %s", 2, fileStruct->fileName, artifacts[i].summaryPath);
+        } else {
+            printDebugMessage(compileState->logLevel, "%s changed, parsing file...", 1, fileStruct->fileName);
+            artifacts[i].changed = true;
+            if(!parseInputFile(fileStruct, compileState)) {
+                free(artifacts);
+                return EXIT_FAILURE;
+            }
+            artifacts[i].usesBalanced = usesBalanced(fileStruct, &opcodes);
+        }
+        fullBuild |= artifacts[i].usesBalanced;
+    }
+
+    if(fullBuild || hasCrossFileMonkeJump(compileState, &opcodes)) {
+        printDebugMessage(compileState->logLevel, "Program cannot be compiled incrementally, doing a full build", 0);
+        for(unsigned i = 0; i < compileState->fileCount; i++) {
+            if(!artifacts[i].changed) {
+                freeFile(&compileState->files[i], compileState->compileMode);
+                compileState->files[i].summaryStub = false;
+                if(!parseInputFile(&compileState->files[i], compileState)) {
+                    free(artifacts);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        free(artifacts);
+        return compileProgram(compileState, outputFileName);
+    }
+
+    if(!analyseProgram(compileState)) {
+        free(artifacts);
+        return EXIT_FAILURE;
+    }
+
+    //The old summaries are removed first, so that they never refer to an outdated object
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        if(artifacts[i].changed) {
+            unlink(artifacts[i].summaryPath);
+        }
+    }
+
+    bool success = assembleFiles(compileState, artifacts, &writeSummary) && linkObjects(compileState, artifacts, outputFileName);
+    free(artifacts);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Compiles every file into a separate object in a temporary directory, using up to compileState->jobs processes in
+ * parallel, and links them into the output file. All files must already be parsed
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compileSeparately(struct compileState* compileState, char* outputFileName) {
+    struct summaryOpcodes opcodes = findSummaryOpcodes();
+    if(hasCrossFileMonkeJump(compileState, &opcodes)) {
+        printDebugMessage(compileState->logLevel, "A monke label is used across files, compiling into a single object", 0);
+        return compileProgram(compileState, outputFileName);
+    }
+
+    if(!analyseProgram(compileState)) {
+        return EXIT_FAILURE;
+    }
+
+    const char* temporaryDirectory = getenv("TMPDIR");
+    char objectDir[PATH_MAX - 16]; //Leaves space for the object file names
+    snprintf(objectDir, sizeof(objectDir), "%s/memeasm-XXXXXX", (temporaryDirectory != NULL) ? temporaryDirectory : "/tmp");
+    if(mkdtemp(objectDir) == NULL) {
+        perror("Failed to create temporary directory");
+        return EXIT_FAILURE;
+    }
+
+    struct fileArtifacts* artifacts = calloc(compileState->fileCount, sizeof(struct fileArtifacts));
+    CHECK_ALLOC(artifacts);
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        snprintf(artifacts[i].objectPath, PATH_MAX, "%s/%u.o", objectDir, i);
+        artifacts[i].changed = true;
+    }
+
+    bool success = assembleFiles(compileState, artifacts, NULL) && linkObjects(compileState, artifacts, outputFileName);
+
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        unlink(artifacts[i].objectPath);
+    }
+    rmdir(objectDir);
+    free(artifacts);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#else
+//Separate compilation is not supported on Windows. memeasm.c already prints a note and never sets buildDir or jobs
+int compileIncrementally(struct compileState* compileState, char* outputFileName) {
+    return compileProgram(compileState, outputFileName);
+}
+
+int compileSeparately(struct compileState* compileState, char* outputFileName) {
+    return compileProgram(compileState, outputFileName);
+}
+#endif
@@ -0,0 +1,389 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Binary IR files (--emit=ir-bin) contain parsed and analysed files, so that they can be used as inputs without parsing
+ * them again. Commands and functions are stored in their in-memory layout (struct parsedCommand and struct function),
+ * with every pointer replaced by the offset of its target from the beginning of the IR file. Loading an IR file therefore
+ * only maps it into memory and adds the address of the mapping to every pointer.
+ *
+ * Layout (all offsets are relative to the beginning of the file and aligned to 8 bytes):
+ *  - struct irHeader
+ *  - one struct irFileEntry per contained file
+ *  - for every file: its commands, followed by its functions. The commands of a function are a range of the file's commands
+ *  - the string table containing file names and parameters, each terminated by a null byte
+ *
+ * Since the layout depends on the compiler and its command list, the header contains the sizes of the stored structs and
+ * a hash of all command patterns. IR files created by an incompatible compiler are rejected.
+ */
+
+#include "ir.h"
+#include "../cache/cache.h"
+#include "../logger/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+extern const struct command commandList[];
+
+//Also detects files that were modified by a text-mode transfer, like the PNG signature
+#define IR_MAGIC "MEMEIR\r\n"
+#define IR_MAGIC_LENGTH 8
+#define IR_VERSION 3
+
+#define ALIGN_8(size) (((size) + 7) & ~(uint64_t) 7)
+
+struct irHeader {
+    char magic[IR_MAGIC_LENGTH];
+    uint32_t version;
+    uint32_t fileCount;
+    uint64_t commandListHash;
+    uint16_t commandSize;
+    uint16_t functionSize;
+    uint16_t pointerSize;
+    uint16_t reserved;
+    uint64_t totalSize;
+};
+
+struct irFileEntry {
+    uint64_t fileNameOffset;
+    uint64_t commandCount;
+    uint64_t commandsOffset;
+    uint64_t functionCount;
+    uint64_t functionsOffset;
+};
+
+/**
+ * Hashes the patterns and parameter counts of all commands, since opcodes are only valid for the same command list
+ */
+static uint64_t hashCommandList(void) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        hash = hashContinue(hash, commandList[i].pattern, strlen(commandList[i].pattern) + 1);
+        hash = hashContinue(hash, &commandList[i].usedParameters, sizeof(commandList[i].usedParameters));
+    }
+    return hash;
+}
+
+struct stringTable {
+    char* buffer;
+    size_t size;
+    size_t capacity;
+    uint64_t offset; //Offset of the string table in the IR file
+};
+
+/**
+ * Appends a string to the string table
+ * @return the offset of the string in the IR file
+ */
+static uint64_t addString(struct stringTable* stringTable, const char* string) {
+    size_t length = strlen(string) + 1;
+    if(stringTable->size + length > stringTable->capacity) {
+        stringTable->capacity = (stringTable->size + length) * 2;
+        stringTable->buffer = realloc(stringTable->buffer, stringTable->capacity);
+        CHECK_ALLOC(stringTable->buffer);
+    }
+    memcpy(stringTable->buffer + stringTable->size, string, length);
+    stringTable->size += length;
+    return stringTable->offset + stringTable->size - length;
+}
+
+static void* offsetToPointer(uint64_t offset) {
+    return (void*) (uintptr_t) offset;
+}
+
+static uint64_t pointerToOffset(const void* pointer) {
+    return (uint64_t) (uintptr_t) pointer;
+}
+
+/**
+ * Writes all parsed and analysed files into a binary IR file
+ * @return EXIT_SUCCESS if the file was written, EXIT_FAILURE otherwise
+ */
+int writeIRFile(struct compileState* compileState, char* outputFileName) {
+    struct irHeader header = {
+        .version = IR_VERSION,
+        .fileCount = compileState->fileCount,
+        .commandListHash = hashCommandList(),
+        .commandSize = sizeof(struct parsedCommand),
+        .functionSize = sizeof(struct function),
+        .pointerSize = sizeof(void*)
+    };
+    memcpy(header.magic, IR_MAGIC, IR_MAGIC_LENGTH);
+
+    //Compute the layout. The string table is placed after all commands and functions
+    struct irFileEntry* entries = calloc(compileState->fileCount, sizeof(struct irFileEntry));
+    CHECK_ALLOC(entries);
+    uint64_t offset = ALIGN_8(sizeof(struct irHeader) + compileState->fileCount * sizeof(struct irFileEntry));
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        struct file* file = &compileState->files[i];
+        entries[i].commandCount = file->loc;
+        entries[i].commandsOffset = offset;
+        offset += ALIGN_8(file->loc * sizeof(struct parsedCommand));
+        entries[i].functionCount = file->functionCount;
+        entries[i].functionsOffset = offset;
+        offset += ALIGN_8(file->functionCount * sizeof(struct function));
+    }
+    struct stringTable stringTable = {.offset = offset};
+
+    FILE* output = fopen(outputFileName, "wb");
+    if(output == NULL) {
+        perror("Failed to open output file");
+        free(entries);
+        return EXIT_FAILURE;
+    }
+
+    //The header and the file entries are written last, since the string offsets are only known afterwards
+    fseek(output, (long) entries[0].commandsOffset, SEEK_SET);
+    const char padding[8] = {0};
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        struct file* file = &compileState->files[i];
+        entries[i].fileNameOffset = addString(&stringTable, file->fileName);
+
+        for(size_t j = 0; j < file->loc; j++) {
+            //Start from zero, so that padding bytes are deterministic
+            struct parsedCommand command;
+            memset(&command, 0, sizeof(command));
+            command.opcode = file->parsedCommands[j].opcode;
+            command.isPointer = file->parsedCommands[j].isPointer;
+            command.pointerSize = file->parsedCommands[j].pointerSize;
+            command.lineNum = file->parsedCommands[j].lineNum;
+            //Which commands are translated is decided by the analysis of the program the IR file is used in
+            command.translate = true;
+            for(unsigned k = 0; k < commandList[command.opcode].usedParameters; k++) {
+                command.paramTypes[k] = file->parsedCommands[j].paramTypes[k];
+                command.parameters[k] = offsetToPointer(addString(&stringTable, file->parsedCommands[j].parameters[k]));
+            }
+            fwrite(&command, sizeof(command), 1, output);
+        }
+        fwrite(padding, 1, ALIGN_8(file->loc * sizeof(struct parsedCommand)) - file->loc * sizeof(struct parsedCommand), output);
+
+        for(size_t j = 0; j < file->functionCount; j++) {
+            struct function function;
+            memset(&function, 0, sizeof(function));
+            function.definedInFile = offsetToPointer(entries[i].fileNameOffset);
+            function.definedInLine = file->functions[j].definedInLine;
+            function.numberOfCommands = file->functions[j].numberOfCommands;
+            function.commands = offsetToPointer(entries[i].commandsOffset + (file->functions[j].commands - file->parsedCommands) * sizeof(struct parsedCommand));
+            fwrite(&function, sizeof(function), 1, output);
+        }
+        fwrite(padding, 1, ALIGN_8(file->functionCount * sizeof(struct function)) - file->functionCount * sizeof(struct function), output);
+    }
+    fwrite(stringTable.buffer, 1, stringTable.size, output);
+
+    header.totalSize = stringTable.offset + stringTable.size;
+    rewind(output);
+    fwrite(&header, sizeof(header), 1, output);
+    fwrite(entries, sizeof(struct irFileEntry), compileState->fileCount, output);
+
+    bool success = !ferror(output);
+    success = (fclose(output) == 0) && success;
+    free(stringTable.buffer);
+    free(entries);
+    if(!success) {
+        perror("Failed to write output file");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Checks if the input file starts with the magic bytes of a binary IR file. The file is rewound afterwards
+ */
+bool isIRFile(FILE* inputFile) {
+    char magic[IR_MAGIC_LENGTH];
+    bool result = fread(magic, 1, IR_MAGIC_LENGTH, inputFile) == IR_MAGIC_LENGTH && memcmp(magic, IR_MAGIC, IR_MAGIC_LENGTH) == 0;
+    rewind(inputFile);
+    return result;
+}
+
+/**
+ * Maps the whole file into memory. The mapping is private and writable, since loading changes all offsets into pointers
+ * @return the address of the mapping, or NULL on error
+ */
+static void* mapFile(FILE* inputFile, size_t* size) {
+    #ifndef WINDOWS
+    struct stat fileStat;
+    if(fstat(fileno(inputFile), &fileStat) != 0 || fileStat.st_size < (off_t) sizeof(struct irHeader)) {
+        return NULL;
+    }
+    *size = (size_t) fileStat.st_size;
+    void* address = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(inputFile), 0);
+    return (address == MAP_FAILED) ? NULL : address;
+    #else
+    //Windows has no mmap, so the file is read instead
+    if(fseek(inputFile, 0, SEEK_END) != 0) {
+        return NULL;
+    }
+    long fileSize = ftell(inputFile);
+    rewind(inputFile);
+    if(fileSize < (long) sizeof(struct irHeader)) {
+        return NULL;
+    }
+    *size = (size_t) fileSize;
+    void* address = malloc(*size);
+    CHECK_ALLOC(address);
+    if(fread(address, 1, *size, inputFile) != *size) {
+        free(address);
+        return NULL;
+    }
+    return address;
+    #endif
+}
+
+void releaseIRMapping(struct irMapping* irMapping) {
+    if(--irMapping->references > 0) {
+        return;
+    }
+    #ifndef WINDOWS
+    munmap(irMapping->address, irMapping->size);
+    #else
+    free(irMapping->address);
+    #endif
+    free(irMapping);
+}
+
+/**
+ * Turns the offset of a string into a pointer
+ * @return the pointer, or NULL if the offset is invalid or the string is not terminated within the mapping
+ */
+static char* relocateString(struct irMapping* irMapping, uint64_t offset) {
+    if(offset >= irMapping->size || memchr((char*) irMapping->address + offset, '\0', irMapping->size - offset) == NULL) {
+        return NULL;
+    }
+    return (char*) irMapping->address + offset;
+}
+
+/**
+ * Checks that an array of count elements of the given size at the given offset lies within the mapping
+ */
+static bool isValidArray(struct irMapping* irMapping, uint64_t offset, uint64_t count, size_t elementSize) {
+    return offset % 8 == 0 && offset <= irMapping->size && count <= (irMapping->size - offset) / elementSize;
+}
+
+/**
+ * Changes all offsets of a file into pointers and checks that they are valid
+ * @return false if the file is invalid
+ */
+static bool relocateFile(struct irMapping* irMapping, struct irFileEntry* entry, struct file* file) {
+    if(!isValidArray(irMapping, entry->commandsOffset, entry->commandCount, sizeof(struct parsedCommand)) ||
+       !isValidArray(irMapping, entry->functionsOffset, entry->functionCount, sizeof(struct function))) {
+        return false;
+    }
+
+    char* base = irMapping->address;
+    file->fileName = relocateString(irMapping, entry->fileNameOffset);
+    file->loc = entry->commandCount;
+    file->parsedCommands = (struct parsedCommand*) (base + entry->commandsOffset);
+    file->functionCount = entry->functionCount;
+    file->functions = (struct function*) (base + entry->functionsOffset);
+    file->irMapping = irMapping;
+    if(file->fileName == NULL) {
+        return false;
+    }
+
+    for(size_t i = 0; i < file->loc; i++) {
+        struct parsedCommand* command = &file->parsedCommands[i];
+        if(command->opcode >= NUMBER_OF_COMMANDS || command->isPointer > MAX_PARAMETER_COUNT ||
+           (command->pointerSize != 0 && (command->pointerSize & (command->pointerSize - 1)) != 0)) {
+            return false;
+        }
+        //Translation expects every parameter to have exactly one type that is allowed for the command. Inline assembly and the values of data have no parameter types
+        uint8_t commandType = commandList[command->opcode].commandType;
+        for(unsigned j = 0; j < commandList[command->opcode].usedParameters; j++) {
+            bool typed = !COMMAND_TYPE_IS_INLINE_ASM(commandType) && !(commandType == COMMAND_TYPE_DATA && j == 1);
+            uint8_t paramType = command->paramTypes[j];
+            command->parameters[j] = relocateString(irMapping, pointerToOffset(command->parameters[j]));
+            if(command->parameters[j] == NULL || (typed && (paramType == 0 || (paramType & (paramType - 1)) != 0 ||
+               (paramType & commandList[command->opcode].allowedParamTypes[j]) == 0))) {
+                return false;
+            }
+        }
+        command->translate = true;
+    }
+
+    for(size_t i = 0; i < file->functionCount; i++) {
+        struct function* function = &file->functions[i];
+        uint64_t commandsOffset = pointerToOffset(function->commands);
+        if(commandsOffset < entry->commandsOffset || (commandsOffset - entry->commandsOffset) % sizeof(struct parsedCommand) != 0) {
+            return false;
+        }
+        uint64_t firstCommand = (commandsOffset - entry->commandsOffset) / sizeof(struct parsedCommand);
+        //Every function starts with its definition, which the translator and analysis rely on
+        if(function->numberOfCommands == 0 || firstCommand > file->loc || function->numberOfCommands > file->loc - firstCommand ||
+           commandList[file->parsedCommands[firstCommand].opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
+            return false;
+        }
+        function->commands = &file->parsedCommands[firstCommand];
+        function->definedInFile = file->fileName;
+    }
+    return true;
+}
+
+/**
+ * Loads all files of a binary IR file
+ * @param irFileName the name of the IR file, used for error messages
+ * @param files is set to a newly allocated array of the loaded files
+ * @return the number of loaded files, or 0 if the file is invalid
+ */
+size_t loadIRFile(const char* irFileName, FILE* inputFile, struct file** files) {
+    struct irMapping* irMapping = calloc(1, sizeof(struct irMapping));
+    CHECK_ALLOC(irMapping);
+    irMapping->address = mapFile(inputFile, &irMapping->size);
+    if(irMapping->address == NULL) {
+        fprintf(stderr, "Error: failed to read the binary IR file %s\n", irFileName);
+        free(irMapping);
+        return 0;
+    }
+    irMapping->references = 1;
+
+    struct irHeader* header = irMapping->address;
+    if(header->version != IR_VERSION || header->commandListHash != hashCommandList() || header->commandSize != sizeof(struct parsedCommand) ||
+       header->functionSize != sizeof(struct function) || header->pointerSize != sizeof(void*)) {
+        fprintf(stderr, "Error: %s was created by an incompatible version of the compiler. Please create it again\n", irFileName);
+        releaseIRMapping(irMapping);
+        return 0;
+    }
+
+    struct irFileEntry* entries = (struct irFileEntry*) (header + 1);
+    if(header->totalSize != irMapping->size || header->fileCount == 0 || !isValidArray(irMapping, sizeof(struct irHeader), header->fileCount, sizeof(struct irFileEntry))) {
+        fprintf(stderr, "Error: %s is not a valid binary IR file\n", irFileName);
+        releaseIRMapping(irMapping);
+        return 0;
+    }
+
+    size_t fileCount = header->fileCount;
+    *files = calloc(fileCount, sizeof(struct file));
+    CHECK_ALLOC(*files);
+    for(size_t i = 0; i < fileCount; i++) {
+        if(!relocateFile(irMapping, &entries[i], &(*files)[i])) {
+            fprintf(stderr, "Error: %s is not a valid binary IR file\n", irFileName);
+            releaseIRMapping(irMapping);
+            free(*files);
+            return 0;
+        }
+    }
+    irMapping->references = (unsigned) fileCount;
+    return fileCount;
+}
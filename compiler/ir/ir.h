@@ -0,0 +1,41 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMEASSEMBLY_IR_H
+#define MEMEASSEMBLY_IR_H
+
+#include "../commands.h"
+
+#include <stdio.h>
+
+/**
+ * A binary IR file that was loaded into memory. It is shared by all files it contains and released once the last of them is freed
+ */
+struct irMapping {
+    void* address;
+    size_t size;
+    unsigned references;
+};
+
+int writeIRFile(struct compileState* compileState, char* outputFileName);
+bool isIRFile(FILE* inputFile);
+size_t loadIRFile(const char* irFileName, FILE* inputFile, struct file** files);
+void releaseIRMapping(struct irMapping* irMapping);
+
+#endif //MEMEASSEMBLY_IR_H
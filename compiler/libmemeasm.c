@@ -0,0 +1,293 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "libmemeasm.h"
+#include "compiler.h"
+#include "parser/parser.h"
+#include "logger/log.h"
+#include "analyser/randomCommands.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+/*
+ * Everything that must survive a longjmp() from abortCompilation() lives on the heap,
+ * since local variables modified after setjmp() have indeterminate values afterwards
+ */
+struct libraryCompilation {
+    struct compileState compileState;
+    struct file file;
+    FILE* inputStream;
+    FILE* outputStream;
+    char* outputBuffer;
+    size_t outputSize;
+    jmp_buf abortTarget;
+};
+
+void memeasm_default_options(struct memeasm_options* options) {
+    options->compileMode = MEMEASM_MODE_NOOB;
+    options->optimisationLevel = MEMEASM_O0;
+    options->martyrdom = true;
+    options->useStabs = false;
+    options->fileName = NULL;
+    options->randomSeed = 0;
+}
+
+const char* memeasm_status_string(memeasm_status status) {
+    switch(status) {
+        case MEMEASM_OK:
+            return "success";
+        case MEMEASM_COMPILE_ERROR:
+            return "the code contains errors";
+        case MEMEASM_IO_ERROR:
+            return "failed to create in-memory streams";
+        case MEMEASM_OUT_OF_MEMORY:
+            return "ran out of memory during compilation";
+        case MEMEASM_INVALID_ARGUMENT:
+            return "invalid argument";
+        case MEMEASM_INTERNAL_ERROR:
+            return "internal compiler error";
+    }
+    return "unknown status";
+}
+
+/**
+ * Opens a stream that reads from the given buffer
+ */
+static FILE* openInputStream(const char* source, size_t length) {
+    #ifdef WINDOWS
+    //Windows has no fmemopen, so a temporary file is used instead
+    FILE* inputStream = tmpfile();
+    if(inputStream != NULL) {
+        if(fwrite(source, 1, length, inputStream) != length) {
+            fclose(inputStream);
+            return NULL;
+        }
+        rewind(inputStream);
+    }
+    return inputStream;
+    #else
+    //fmemopen does not accept empty buffers. An empty line has the same meaning as an empty file
+    if(length == 0) {
+        source = "\n";
+        length = 1;
+    }
+    return fmemopen((void*) source, length, "r");
+    #endif
+}
+
+/**
+ * Opens a stream that writes into compilation->outputBuffer
+ */
+static FILE* openOutputStream(struct libraryCompilation* compilation) {
+    #ifdef WINDOWS
+    (void) compilation;
+    return tmpfile();
+    #else
+    return open_memstream(&compilation->outputBuffer, &compilation->outputSize);
+    #endif
+}
+
+/**
+ * Closes the output stream. Afterwards, outputBuffer contains the null-terminated assembly code
+ * @return false if the buffer could not be created
+ */
+static bool closeOutputStream(struct libraryCompilation* compilation) {
+    FILE* outputStream = compilation->outputStream;
+    compilation->outputStream = NULL;
+    #ifdef WINDOWS
+    long size = ftell(outputStream);
+    if(size < 0) {
+        fclose(outputStream);
+        return false;
+    }
+    compilation->outputBuffer = malloc(size + 1);
+    if(compilation->outputBuffer == NULL) {
+        fclose(outputStream);
+        return false;
+    }
+    rewind(outputStream);
+    compilation->outputSize = fread(compilation->outputBuffer, 1, size, outputStream);
+    compilation->outputBuffer[compilation->outputSize] = 0;
+    fclose(outputStream);
+    return true;
+    #else
+    return fclose(outputStream) == 0 && compilation->outputBuffer != NULL;
+    #endif
+}
+
+/**
+ * Moves the collected diagnostics into the caller's struct. Messages are handed over, not copied
+ */
+static void moveDiagnostics(struct compileState* compileState, struct memeasm_diagnostics* diagnostics) {
+    if(diagnostics == NULL || compileState->diagnosticCount == 0) {
+        for(size_t i = 0; i < compileState->diagnosticCount; i++) {
+            free(compileState->diagnostics[i].message);
+        }
+        free(compileState->diagnostics);
+        return;
+    }
+
+    diagnostics->entries = malloc(compileState->diagnosticCount * sizeof(struct memeasm_diagnostic));
+    if(diagnostics->entries == NULL) {
+        for(size_t i = 0; i < compileState->diagnosticCount; i++) {
+            free(compileState->diagnostics[i].message);
+        }
+        free(compileState->diagnostics);
+        return;
+    }
+
+    for(size_t i = 0; i < compileState->diagnosticCount; i++) {
+        struct diagnostic* diagnostic = &compileState->diagnostics[i];
+        diagnostics->entries[i] = (struct memeasm_diagnostic) {
+            .fileName = diagnostic->fileName,
+            .lineNum = diagnostic->lineNum,
+            .isNote = diagnostic->isNote,
+            .message = diagnostic->message
+        };
+    }
+    diagnostics->count = compileState->diagnosticCount;
+    free(compileState->diagnostics);
+}
+
+memeasm_status memeasm_compile(const char* source, size_t length, const struct memeasm_options* options,
+                               char** assembly, size_t* assemblyLength, struct memeasm_diagnostics* diagnostics) {
+    if(assembly == NULL || (source == NULL && length > 0)) {
+        return MEMEASM_INVALID_ARGUMENT;
+    }
+    *assembly = NULL;
+    if(assemblyLength != NULL) {
+        *assemblyLength = 0;
+    }
+    if(diagnostics != NULL) {
+        diagnostics->entries = NULL;
+        diagnostics->count = 0;
+    }
+
+    struct memeasm_options defaultOptions;
+    if(options == NULL) {
+        memeasm_default_options(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    optimisationLevel optimisationLevel;
+    switch(options->optimisationLevel) {
+        case MEMEASM_O0: optimisationLevel = none; break;
+        case MEMEASM_O_1: optimisationLevel = o_1; break;
+        case MEMEASM_O_2: optimisationLevel = o_2; break;
+        case MEMEASM_O_3: optimisationLevel = o_3; break;
+        case MEMEASM_O69420: optimisationLevel = o69420; break;
+        default: return MEMEASM_INVALID_ARGUMENT;
+    }
+
+    compileMode compileMode;
+    switch(options->compileMode) {
+        case MEMEASM_MODE_NOOB: compileMode = noob; break;
+        case MEMEASM_MODE_BULLY: compileMode = bully; break;
+        case MEMEASM_MODE_OBFUSCATED: compileMode = obfuscated; break;
+        default: return MEMEASM_INVALID_ARGUMENT;
+    }
+
+    struct libraryCompilation* compilation = calloc(1, sizeof(struct libraryCompilation));
+    if(compilation == NULL) {
+        return MEMEASM_OUT_OF_MEMORY;
+    }
+
+    compilation->compileState = (struct compileState) {
+        .compileMode = compileMode,
+        .optimisationLevel = optimisationLevel,
+        .translateMode = intSISD,
+        .outputMode = assemblyFile,
+        .martyrdom = options->martyrdom,
+        #ifdef LINUX
+        .useStabs = options->useStabs && compileMode != bully,
+        #endif
+        .logLevel = normal,
+        .collectDiagnostics = true,
+        .fileCount = 1,
+        .files = &compilation->file,
+        .computedIndex = COMPUTED_INDEX_START
+    };
+    //Each compilation has its own generator, so that compilations in different threads do not influence each other
+    seedRandom(&compilation->compileState, (options->randomSeed != 0) ? options->randomSeed : (uint64_t) time(NULL));
+    compilation->file.fileName = (char*) ((options->fileName != NULL) ? options->fileName : "<memeasm input>");
+
+    memeasm_status status;
+    compilation->inputStream = openInputStream(source, length);
+    compilation->outputStream = openOutputStream(compilation);
+    if(compilation->inputStream == NULL || compilation->outputStream == NULL) {
+        status = MEMEASM_IO_ERROR;
+    } else {
+        jmp_buf* previousAbortTarget = setAbortTarget(&compilation->abortTarget);
+        //setjmp() returns the reason passed to abortCompilation(). Memory allocated by the aborted phase cannot be recovered
+        switch(setjmp(compilation->abortTarget)) {
+            case 0:
+                parseFile(&compilation->file, compilation->inputStream, &compilation->compileState);
+                status = (compileToStream(&compilation->compileState, compilation->outputStream) == EXIT_SUCCESS) ? MEMEASM_OK : MEMEASM_COMPILE_ERROR;
+                break;
+            case abortOutOfMemory:
+                status = MEMEASM_OUT_OF_MEMORY;
+                break;
+            default:
+                status = MEMEASM_INTERNAL_ERROR;
+                break;
+        }
+        setAbortTarget(previousAbortTarget);
+    }
+
+    if(compilation->inputStream != NULL) {
+        fclose(compilation->inputStream);
+    }
+    if(compilation->outputStream != NULL && !closeOutputStream(compilation) && status == MEMEASM_OK) {
+        status = MEMEASM_IO_ERROR;
+    }
+
+    if(status == MEMEASM_OK) {
+        *assembly = compilation->outputBuffer;
+        if(assemblyLength != NULL) {
+            *assemblyLength = compilation->outputSize;
+        }
+    } else {
+        free(compilation->outputBuffer);
+    }
+
+    freeFile(&compilation->file, compileMode);
+    moveDiagnostics(&compilation->compileState, diagnostics);
+    free(compilation);
+    return status;
+}
+
+void memeasm_free_output(char* assembly) {
+    free(assembly);
+}
+
+void memeasm_free_diagnostics(struct memeasm_diagnostics* diagnostics) {
+    if(diagnostics == NULL) {
+        return;
+    }
+    for(size_t i = 0; i < diagnostics->count; i++) {
+        free(diagnostics->entries[i].message);
+    }
+    free(diagnostics->entries);
+    diagnostics->entries = NULL;
+    diagnostics->count = 0;
+}
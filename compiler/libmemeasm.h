@@ -0,0 +1,119 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Public interface of libmemeasm, which allows compiling MemeAssembly code to x86-64 assembly without
+ * starting a new process. Build it with "make lib", which creates libmemeasm.a and libmemeasm.so.
+ * The library never terminates the calling program: all errors are reported through the returned status.
+ */
+
+#ifndef LIBMEMEASM_H
+#define LIBMEMEASM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && !defined(WINDOWS)
+#define MEMEASM_API __attribute__((visibility("default")))
+#else
+#define MEMEASM_API
+#endif
+
+typedef enum {
+    MEMEASM_OK = 0,
+    MEMEASM_COMPILE_ERROR, //The code contains errors, see the diagnostics
+    MEMEASM_IO_ERROR, //The in-memory streams could not be created
+    MEMEASM_OUT_OF_MEMORY,
+    MEMEASM_INVALID_ARGUMENT,
+    MEMEASM_INTERNAL_ERROR //A bug in the compiler, please report it
+} memeasm_status;
+
+typedef enum {
+    MEMEASM_MODE_NOOB,
+    MEMEASM_MODE_BULLY,
+    MEMEASM_MODE_OBFUSCATED
+} memeasm_compile_mode;
+
+typedef enum {
+    MEMEASM_O0 = 0,
+    MEMEASM_O_1 = -1,
+    MEMEASM_O_2 = -2,
+    MEMEASM_O_3 = -3,
+    MEMEASM_O69420 = 69420
+} memeasm_optimisation_level;
+
+struct memeasm_options {
+    memeasm_compile_mode compileMode;
+    memeasm_optimisation_level optimisationLevel;
+    bool martyrdom;
+    bool useStabs; //Only supported on Linux, ignored otherwise
+    const char* fileName; //Name of the source used in diagnostics and debug info. May be NULL
+    uint64_t randomSeed; //Seed of the random choices of "confused stonks" and "perfectly balanced...". If 0, the current time is used
+};
+
+struct memeasm_diagnostic {
+    const char* fileName; //Points to the fileName of the options (or a static string if none was given)
+    size_t lineNum;
+    bool isNote; //Notes belong to the error preceding them
+    char* message;
+};
+
+struct memeasm_diagnostics {
+    struct memeasm_diagnostic* entries;
+    size_t count;
+};
+
+/**
+ * Fills the options with the defaults of the memeasm executable (noob mode, no optimisation, martyrdom enabled, seeded with the current time)
+ */
+MEMEASM_API void memeasm_default_options(struct memeasm_options* options);
+
+/**
+ * Compiles MemeAssembly code into x86-64 assembly (Intel syntax, as generated by "memeasm -S")
+ * @param source the MemeAssembly code. It does not need to be null-terminated
+ * @param length the length of the source in bytes
+ * @param options the compile options. If NULL, the defaults are used
+ * @param assembly is set to a null-terminated buffer containing the assembly code, or NULL if compilation failed. Free it with memeasm_free_output()
+ * @param assemblyLength if not NULL, is set to the length of the assembly code (excluding the null byte)
+ * @param diagnostics if not NULL, receives all errors and notes. Free it with memeasm_free_diagnostics()
+ * @return MEMEASM_OK if compilation succeeded, otherwise the reason why it failed.
+ * After MEMEASM_OUT_OF_MEMORY and MEMEASM_INTERNAL_ERROR, the memory that the aborted compilation phase had allocated so far
+ * is not freed. Embedders that keep running after these errors leak this memory (at most what one compilation of the source needs)
+ */
+MEMEASM_API memeasm_status memeasm_compile(const char* source, size_t length, const struct memeasm_options* options,
+                                           char** assembly, size_t* assemblyLength, struct memeasm_diagnostics* diagnostics);
+
+MEMEASM_API void memeasm_free_output(char* assembly);
+MEMEASM_API void memeasm_free_diagnostics(struct memeasm_diagnostics* diagnostics);
+
+/**
+ * @return a human-readable description of the status
+ */
+MEMEASM_API const char* memeasm_status_string(memeasm_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //LIBMEMEASM_H
@@ -20,6 +20,7 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include "log.h"
 #include <stdarg.h>
 #include <string.h>
+#include <stdlib.h>
 
 const char* const versionString = "v1.6";
 const char* const platformSuffix =
@@ -161,6 +162,14 @@ void printDebugMessage(logLevel logLevel, char* message, unsigned varArgNum, ...
 void printError(char* inputFileName, unsigned lineNum, struct compileState* compileState, char* message, unsigned varArgNum, ...) {
     compileState->compilerErrors++;
 
+    if(compileState->collectDiagnostics) {
+        va_list vaList;
+        va_start(vaList, varArgNum);
+        addDiagnostic(compileState, inputFileName, lineNum, false, message, vaList);
+        va_end(vaList);
+        return;
+    }
+
     //First, only print the file name and line
     printf("%s:%u: " RED "error: " RESET, inputFileName, lineNum);
 
@@ -186,6 +195,48 @@ void printError(char* inputFileName, unsigned lineNum, struct compileState* comp
     }
 }
 
+/**
+ * Appends a diagnostic to the compile state instead of printing it. Used when the compiler is embedded as a library
+ * @param inputFileName name of the input file
+ * @param lineNum the line number the diagnostic refers to
+ * @param isNote whether this is a note (true) or an error (false)
+ * @param message the message (with printf-like formatting)
+ * @param vaList the arguments of the message
+ */
+void addDiagnostic(struct compileState* compileState, char* inputFileName, size_t lineNum, bool isNote, char* message, va_list vaList) {
+    va_list vaListCopy;
+    va_copy(vaListCopy, vaList);
+    int length = vsnprintf(NULL, 0, message, vaListCopy);
+    va_end(vaListCopy);
+
+    if(compileState->diagnosticCount == compileState->diagnosticCapacity) {
+        size_t newCapacity = (compileState->diagnosticCapacity == 0) ? 16 : compileState->diagnosticCapacity * 2;
+        struct diagnostic* diagnostics = realloc(compileState->diagnostics, newCapacity * sizeof(struct diagnostic));
+        CHECK_ALLOC(diagnostics);
+        compileState->diagnostics = diagnostics;
+        compileState->diagnosticCapacity = newCapacity;
+    }
+
+    struct diagnostic* diagnostic = &compileState->diagnostics[compileState->diagnosticCount];
+    diagnostic->message = malloc(length + 1);
+    CHECK_ALLOC(diagnostic->message);
+    vsnprintf(diagnostic->message, length + 1, message, vaList);
+    diagnostic->fileName = inputFileName;
+    diagnostic->lineNum = lineNum;
+    diagnostic->isNote = isNote;
+    compileState->diagnosticCount++;
+}
+
+/**
+ * Appends a note to the compile state's diagnostics. It can be called with a variable number of arguments that will be inserted in the respective places in the format string
+ */
+void addNote(struct compileState* compileState, char* inputFileName, size_t lineNum, char* message, ...) {
+    va_list vaList;
+    va_start(vaList, message);
+    addDiagnostic(compileState, inputFileName, lineNum, true, message, vaList);
+    va_end(vaList);
+}
+
 /**
  * Prints a note. It can be called with a variable number of arguments that will be inserted in the respective places in the format string
  * @param message the message (with printf-like formatting)
@@ -225,3 +276,28 @@ void printInternalCompilerError(char* message, bool report, unsigned varArgNum,
     fprintf(stderr, "\n");
     if(report) fprintf(stderr, "Please report this error at https://github.com/kammt/MemeAssembly/issues/new");
 }
+
+//Where abortCompilation() returns to. Thread-local, so that compilations in different threads do not interfere
+static _Thread_local jmp_buf* currentAbortTarget = NULL;
+
+/**
+ * Sets where abortCompilation() jumps to. If no target is set, abortCompilation() exits the program
+ * @return the previous target
+ */
+jmp_buf* setAbortTarget(jmp_buf* abortTarget) {
+    jmp_buf* previousTarget = currentAbortTarget;
+    currentAbortTarget = abortTarget;
+    return previousTarget;
+}
+
+/**
+ * Aborts the current compilation after an unrecoverable error (e.g. out of memory). When embedded as a library, control
+ * returns to the library function, otherwise the program exits
+ * @param reason returned by setjmp() at the abort target
+ */
+_Noreturn void abortCompilation(abortReason reason) {
+    if(currentAbortTarget != NULL) {
+        longjmp(*currentAbortTarget, reason);
+    }
+    exit(EXIT_FAILURE);
+}
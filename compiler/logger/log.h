@@ -21,6 +21,8 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #define LOG_H
 
 #include <stdio.h>  //Printf() function
+#include <setjmp.h>
+#include <stdarg.h>
 #include "../compiler.h"
 
 #define RED   "\x1B[31m"
@@ -45,12 +47,19 @@ void printStatusMessage(logLevel logLevel, char* message);
 
 void printError(char* inputFileName, unsigned lineNum, struct compileState* compileState, char* message, unsigned varArgNum, ...);
 void printNote(char* message, bool indent, unsigned varArgNum, ...);
+void addNote(struct compileState* compileState, char* inputFileName, size_t lineNum, char* message, ...);
+void addDiagnostic(struct compileState* compileState, char* inputFileName, size_t lineNum, bool isNote, char* message, va_list vaList);
 
 void printInternalCompilerError(char* message, bool report, unsigned varArgNum, ...);
 
+typedef enum { abortOutOfMemory = 1, abortInternalError = 2 } abortReason; //Passed to longjmp(), so neither may be 0
+
+jmp_buf* setAbortTarget(jmp_buf* abortTarget);
+_Noreturn void abortCompilation(abortReason reason);
+
 #define CHECK_ALLOC(ptr) \
   if (!ptr) { \
     printInternalCompilerError("%s:%u: Ran out of memory during compilation", false, 2, __FILE__, __LINE__);  \
-    exit(EXIT_FAILURE); \
+    abortCompilation(abortOutOfMemory); \
   }
 #endif
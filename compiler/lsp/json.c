@@ -0,0 +1,389 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json.h"
+#include "../logger/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//Nesting deeper than this is rejected, so that malicious input cannot overflow the stack
+#define MAX_JSON_DEPTH 64
+
+struct jsonParser {
+    const char* current;
+    const char* end;
+    unsigned depth;
+};
+
+static bool parseValue(struct jsonParser* parser, struct jsonValue* value);
+
+static void skipWhitespace(struct jsonParser* parser) {
+    while(parser->current < parser->end && (*parser->current == ' ' || *parser->current == '\t' || *parser->current == '\n' || *parser->current == '\r')) {
+        parser->current++;
+    }
+}
+
+static bool consume(struct jsonParser* parser, const char* literal) {
+    size_t length = strlen(literal);
+    if((size_t) (parser->end - parser->current) < length || strncmp(parser->current, literal, length) != 0) {
+        return false;
+    }
+    parser->current += length;
+    return true;
+}
+
+static int hexValue(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseHex4(struct jsonParser* parser, unsigned* codePoint) {
+    if(parser->end - parser->current < 4) {
+        return false;
+    }
+    *codePoint = 0;
+    for(int i = 0; i < 4; i++) {
+        int digit = hexValue(*parser->current++);
+        if(digit < 0) {
+            return false;
+        }
+        *codePoint = (*codePoint << 4) | (unsigned) digit;
+    }
+    return true;
+}
+
+/**
+ * Writes a code point as UTF-8
+ * @return the number of bytes written
+ */
+static size_t encodeUtf8(unsigned codePoint, char* output) {
+    if(codePoint < 0x80) {
+        output[0] = (char) codePoint;
+        return 1;
+    } else if(codePoint < 0x800) {
+        output[0] = (char) (0xC0 | (codePoint >> 6));
+        output[1] = (char) (0x80 | (codePoint & 0x3F));
+        return 2;
+    } else if(codePoint < 0x10000) {
+        output[0] = (char) (0xE0 | (codePoint >> 12));
+        output[1] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        output[2] = (char) (0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    output[0] = (char) (0xF0 | (codePoint >> 18));
+    output[1] = (char) (0x80 | ((codePoint >> 12) & 0x3F));
+    output[2] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+    output[3] = (char) (0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/**
+ * Parses a string. The opening quote was already consumed
+ * @return the string, or NULL if it is invalid
+ */
+static char* parseString(struct jsonParser* parser) {
+    //The decoded string is never longer than the encoded one
+    const char* start = parser->current;
+    while(parser->current < parser->end && *parser->current != '"') {
+        if(*parser->current == '\\') parser->current++;
+        parser->current++;
+    }
+    if(parser->current >= parser->end) {
+        return NULL;
+    }
+    char* string = malloc(parser->current - start + 1);
+    CHECK_ALLOC(string);
+    parser->current = start;
+
+    size_t length = 0;
+    while(*parser->current != '"') {
+        char c = *parser->current++;
+        if(c != '\\') {
+            string[length++] = c;
+            continue;
+        }
+
+        c = *parser->current++;
+        switch(c) {
+            case '"': string[length++] = '"'; break;
+            case '\\': string[length++] = '\\'; break;
+            case '/': string[length++] = '/'; break;
+            case 'b': string[length++] = '\b'; break;
+            case 'f': string[length++] = '\f'; break;
+            case 'n': string[length++] = '\n'; break;
+            case 'r': string[length++] = '\r'; break;
+            case 't': string[length++] = '\t'; break;
+            case 'u': {
+                unsigned codePoint;
+                if(!parseHex4(parser, &codePoint)) {
+                    free(string);
+                    return NULL;
+                }
+                //A surrogate pair is encoded as one 4 byte UTF-8 sequence, which fits into the 12 bytes of the two escapes
+                if(codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    unsigned lowSurrogate;
+                    if(!consume(parser, "\\u") || !parseHex4(parser, &lowSurrogate) || lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) {
+                        free(string);
+                        return NULL;
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                }
+                length += encodeUtf8(codePoint, string + length);
+                break;
+            }
+            default:
+                free(string);
+                return NULL;
+        }
+    }
+    parser->current++;
+    string[length] = '\0';
+    return string;
+}
+
+static bool parseNumber(struct jsonParser* parser, struct jsonValue* value) {
+    char buffer[64];
+    size_t length = 0;
+    while(parser->current < parser->end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", *parser->current) != NULL) {
+        buffer[length++] = *parser->current++;
+    }
+    buffer[length] = '\0';
+
+    char* endptr;
+    value->type = JSON_NUMBER;
+    value->number = strtod(buffer, &endptr);
+    return length > 0 && *endptr == '\0';
+}
+
+/**
+ * Parses the items of an array or an object. The opening bracket was already consumed
+ */
+static bool parseContainer(struct jsonParser* parser, struct jsonValue* value, bool isObject) {
+    char closingBracket = isObject ? '}' : ']';
+    size_t capacity = 0;
+    value->type = isObject ? JSON_OBJECT : JSON_ARRAY;
+
+    skipWhitespace(parser);
+    if(parser->current < parser->end && *parser->current == closingBracket) {
+        parser->current++;
+        return true;
+    }
+
+    while(true) {
+        if(value->count == capacity) {
+            capacity = (capacity == 0) ? 4 : capacity * 2;
+            value->items = realloc(value->items, capacity * sizeof(struct jsonValue));
+            CHECK_ALLOC(value->items);
+            if(isObject) {
+                value->keys = realloc(value->keys, capacity * sizeof(char*));
+                CHECK_ALLOC(value->keys);
+            }
+        }
+
+        skipWhitespace(parser);
+        if(isObject) {
+            char* key = NULL;
+            if(!consume(parser, "\"") || (key = parseString(parser)) == NULL) {
+                return false;
+            }
+            skipWhitespace(parser);
+            if(!consume(parser, ":")) {
+                free(key);
+                return false;
+            }
+            value->keys[value->count] = key;
+        }
+
+        struct jsonValue* item = &value->items[value->count];
+        memset(item, 0, sizeof(struct jsonValue));
+        value->count++;
+        if(!parseValue(parser, item)) {
+            return false;
+        }
+
+        skipWhitespace(parser);
+        if(consume(parser, ",")) {
+            continue;
+        }
+        if(parser->current < parser->end && *parser->current == closingBracket) {
+            parser->current++;
+            return true;
+        }
+        return false;
+    }
+}
+
+static bool parseValue(struct jsonParser* parser, struct jsonValue* value) {
+    skipWhitespace(parser);
+    if(parser->current >= parser->end || parser->depth >= MAX_JSON_DEPTH) {
+        return false;
+    }
+
+    switch(*parser->current) {
+        case '{':
+        case '[': {
+            bool isObject = (*parser->current == '{');
+            parser->current++;
+            parser->depth++;
+            bool success = parseContainer(parser, value, isObject);
+            parser->depth--;
+            return success;
+        }
+        case '"':
+            parser->current++;
+            value->type = JSON_STRING;
+            value->string = parseString(parser);
+            return value->string != NULL;
+        case 't':
+            value->type = JSON_BOOL;
+            value->boolean = true;
+            return consume(parser, "true");
+        case 'f':
+            value->type = JSON_BOOL;
+            value->boolean = false;
+            return consume(parser, "false");
+        case 'n':
+            value->type = JSON_NULL;
+            return consume(parser, "null");
+        default:
+            return parseNumber(parser, value);
+    }
+}
+
+static void freeJsonContents(struct jsonValue* value) {
+    for(size_t i = 0; i < value->count; i++) {
+        freeJsonContents(&value->items[i]);
+        if(value->type == JSON_OBJECT) {
+            free(value->keys[i]);
+        }
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+}
+
+/**
+ * Parses a JSON text
+ * @return the parsed value, or NULL if the text is not valid JSON. Free it using freeJson()
+ */
+struct jsonValue* parseJson(const char* text, size_t length) {
+    struct jsonParser parser = {.current = text, .end = text + length};
+    struct jsonValue* value = calloc(1, sizeof(struct jsonValue));
+    CHECK_ALLOC(value);
+
+    bool success = parseValue(&parser, value);
+    skipWhitespace(&parser);
+    if(!success || parser.current != parser.end) {
+        freeJson(value);
+        return NULL;
+    }
+    return value;
+}
+
+void freeJson(struct jsonValue* value) {
+    if(value == NULL) {
+        return;
+    }
+    freeJsonContents(value);
+    free(value);
+}
+
+/**
+ * @return the member of the object with the given key, or NULL if it does not exist or value is not an object
+ */
+struct jsonValue* jsonGet(struct jsonValue* object, const char* key) {
+    if(object == NULL || object->type != JSON_OBJECT) {
+        return NULL;
+    }
+    for(size_t i = 0; i < object->count; i++) {
+        if(strcmp(object->keys[i], key) == 0) {
+            return &object->items[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @return the string member of the object with the given key, or NULL if it does not exist or is not a string
+ */
+const char* jsonGetString(struct jsonValue* object, const char* key) {
+    struct jsonValue* value = jsonGet(object, key);
+    return (value != NULL && value->type == JSON_STRING) ? value->string : NULL;
+}
+
+/**
+ * @return the integer member of the object with the given key, or defaultValue if it does not exist or is not a number
+ */
+long jsonGetInteger(struct jsonValue* object, const char* key, long defaultValue) {
+    struct jsonValue* value = jsonGet(object, key);
+    return (value != NULL && value->type == JSON_NUMBER) ? (long) value->number : defaultValue;
+}
+
+void writeJsonString(FILE* output, const char* string) {
+    fputc('"', output);
+    for(const unsigned char* c = (const unsigned char*) string; *c != '\0'; c++) {
+        switch(*c) {
+            case '"': fputs("\\\"", output); break;
+            case '\\': fputs("\\\\", output); break;
+            case '\n': fputs("\\n", output); break;
+            case '\r': fputs("\\r", output); break;
+            case '\t': fputs("\\t", output); break;
+            default:
+                if(*c < 0x20) {
+                    fprintf(output, "\\u%04x", *c);
+                } else {
+                    fputc(*c, output);
+                }
+        }
+    }
+    fputc('"', output);
+}
+
+void writeJsonValue(FILE* output, struct jsonValue* value) {
+    switch(value->type) {
+        case JSON_NULL:
+            fputs("null", output);
+            break;
+        case JSON_BOOL:
+            fputs(value->boolean ? "true" : "false", output);
+            break;
+        case JSON_NUMBER:
+            fprintf(output, "%.17g", value->number);
+            break;
+        case JSON_STRING:
+            writeJsonString(output, value->string);
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT:
+            fputc((value->type == JSON_OBJECT) ? '{' : '[', output);
+            for(size_t i = 0; i < value->count; i++) {
+                if(i > 0) fputc(',', output);
+                if(value->type == JSON_OBJECT) {
+                    writeJsonString(output, value->keys[i]);
+                    fputc(':', output);
+                }
+                writeJsonValue(output, &value->items[i]);
+            }
+            fputc((value->type == JSON_OBJECT) ? '}' : ']', output);
+            break;
+    }
+}
@@ -0,0 +1,53 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * A minimal JSON reader and writer, just enough for the JSON-RPC messages of the language server
+ */
+
+#ifndef MEMEASSEMBLY_JSON_H
+#define MEMEASSEMBLY_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT } jsonType;
+
+struct jsonValue {
+    jsonType type;
+    bool boolean;
+    double number;
+    char* string; //Null-terminated. Strings containing \u0000 are cut off there
+    size_t count; //Number of items of an array or object
+    struct jsonValue* items;
+    char** keys; //Keys of an object, keys[i] belongs to items[i]
+};
+
+struct jsonValue* parseJson(const char* text, size_t length);
+void freeJson(struct jsonValue* value);
+
+struct jsonValue* jsonGet(struct jsonValue* object, const char* key);
+const char* jsonGetString(struct jsonValue* object, const char* key);
+long jsonGetInteger(struct jsonValue* object, const char* key, long defaultValue);
+
+void writeJsonString(FILE* output, const char* string);
+void writeJsonValue(FILE* output, struct jsonValue* value);
+
+#endif //MEMEASSEMBLY_JSON_H
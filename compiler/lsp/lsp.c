@@ -0,0 +1,881 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Language server (memeasm --lsp), speaking JSON-RPC over stdin and stdout.
+ * Open documents are kept as an array of lines. Since lines are independent of each other, every line keeps its parsed
+ * command together with the errors found while parsing it and checking its parameters. An edit only reparses the
+ * lines it touched. Analysis functions only look at their own opcode and their companion command (opcode + 1), so an
+ * analysis function is only run again if a command with one of these opcodes changed. Its errors are kept otherwise.
+ * If a function definition or return statement changed, all analysis functions run again, since the commands belonging
+ * to functions might have changed.
+ * Every document is analysed on its own. It is treated as an executable if it defines a main function, otherwise as an
+ * object file (so that calls to functions defined elsewhere are allowed).
+ */
+
+#include "lsp.h"
+#include "json.h"
+#include "../compiler.h"
+#include "../parser/fileParser.h"
+#include "../parser/functionParser.h"
+#include "../analyser/analyser.h"
+#include "../translator/translator.h"
+#include "../logger/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+extern const struct command commandList[];
+extern const char* const versionString;
+
+#ifndef WINDOWS
+
+//JSON-RPC error codes
+#define PARSE_ERROR -32700
+#define METHOD_NOT_FOUND -32601
+
+//LSP diagnostic severities
+#define SEVERITY_ERROR 1
+#define SEVERITY_INFORMATION 3
+
+struct lspLine {
+    char* text;
+    bool parsed;
+    bool isCode;
+    struct parsedCommand command; //Only valid if isCode is set. Its parameters were already checked
+    struct diagnostic* diagnostics; //Errors of parsing the line and checking its parameters
+    size_t diagnosticCount;
+};
+
+struct analysisResult {
+    struct diagnostic* diagnostics;
+    size_t diagnosticCount;
+};
+
+struct lspDocument {
+    char* uri;
+    char* fileName;
+    struct lspLine* lines;
+    size_t lineCount;
+    size_t lineCapacity;
+
+    bool analysed; //Set after the first analysis. Before that, all analysis functions need to run
+    bool changedOpcodes[NUMBER_OF_COMMANDS]; //Opcodes of all commands that were removed or added since the last analysis
+    struct analysisResult analysisResults[NUMBER_OF_COMMANDS]; //Errors found by the analysis function of each opcode
+};
+
+struct languageServer {
+    struct compileState compileState;
+    struct lspDocument** documents;
+    size_t documentCount;
+    size_t documentCapacity;
+    bool shutdownRequested;
+};
+
+/**
+ * Converts a position in UTF-16 code units (as used by LSP) into a byte offset into the UTF-8 text
+ */
+static size_t utf16ToByteOffset(const char* text, long utf16Offset) {
+    size_t offset = 0;
+    long units = 0;
+    while(text[offset] != '\0' && units < utf16Offset) {
+        unsigned char c = (unsigned char) text[offset];
+        unsigned length = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : (c >= 0xC0) ? 2 : 1;
+        //Characters outside the Basic Multilingual Plane are a surrogate pair
+        units += (length == 4) ? 2 : 1;
+        for(unsigned i = 0; i < length && text[offset] != '\0'; i++) {
+            offset++;
+        }
+    }
+    return offset;
+}
+
+static long utf16Length(const char* text) {
+    long units = 0;
+    for(const unsigned char* c = (const unsigned char*) text; *c != '\0'; c++) {
+        if((*c & 0xC0) != 0x80) {
+            units += (*c >= 0xF0) ? 2 : 1;
+        }
+    }
+    return units;
+}
+
+/**
+ * Turns a file:// URI into a path. Other URIs are used as they are
+ */
+static char* uriToFileName(const char* uri) {
+    const char* prefix = "file://";
+    if(strncmp(uri, prefix, strlen(prefix)) != 0) {
+        char* fileName = strdup(uri);
+        CHECK_ALLOC(fileName);
+        return fileName;
+    }
+
+    const char* path = uri + strlen(prefix);
+    char* fileName = malloc(strlen(path) + 1);
+    CHECK_ALLOC(fileName);
+    size_t length = 0;
+    for(size_t i = 0; path[i] != '\0'; i++) {
+        char hex[3] = {0};
+        if(path[i] == '%' && path[i + 1] != '\0' && path[i + 2] != '\0') {
+            hex[0] = path[i + 1];
+            hex[1] = path[i + 2];
+            fileName[length++] = (char) strtol(hex, NULL, 16);
+            i += 2;
+        } else {
+            fileName[length++] = path[i];
+        }
+    }
+    fileName[length] = '\0';
+    return fileName;
+}
+
+/**
+ * Moves all diagnostics that were added to the compile state since diagnostic number "first" into a new array
+ */
+static void takeDiagnostics(struct compileState* compileState, size_t first, struct diagnostic** diagnostics, size_t* diagnosticCount) {
+    *diagnosticCount = compileState->diagnosticCount - first;
+    *diagnostics = NULL;
+    if(*diagnosticCount > 0) {
+        *diagnostics = malloc(*diagnosticCount * sizeof(struct diagnostic));
+        CHECK_ALLOC(*diagnostics);
+        memcpy(*diagnostics, compileState->diagnostics + first, *diagnosticCount * sizeof(struct diagnostic));
+    }
+    compileState->diagnosticCount = first;
+    compileState->compilerErrors = 0;
+}
+
+static void freeDiagnostics(struct diagnostic* diagnostics, size_t diagnosticCount) {
+    for(size_t i = 0; i < diagnosticCount; i++) {
+        free(diagnostics[i].message);
+    }
+    free(diagnostics);
+}
+
+/**
+ * Parses a line and checks its parameters. The errors found are stored in the line
+ */
+static void parseDocumentLine(struct languageServer* server, struct lspDocument* document, size_t lineIndex) {
+    struct lspLine* line = &document->lines[lineIndex];
+    line->parsed = true;
+    line->isCode = isLineOfInterest(line->text, (ssize_t) strlen(line->text)) == 1;
+    if(!line->isCode) {
+        return;
+    }
+
+    char* text = strdup(line->text);
+    CHECK_ALLOC(text);
+    removeLineBreaksAndTabs(text);
+
+    struct compileState* compileState = &server->compileState;
+    size_t firstDiagnostic = compileState->diagnosticCount;
+    line->command = parseLine(document->fileName, lineIndex + 1, text, compileState);
+    checkParameters(&line->command, document->fileName, compileState);
+    takeDiagnostics(compileState, firstDiagnostic, &line->diagnostics, &line->diagnosticCount);
+    free(text);
+
+    document->changedOpcodes[line->command.opcode] = true;
+}
+
+/**
+ * Frees a line. If it contained a command, its opcode is marked as changed
+ */
+static void releaseLine(struct lspDocument* document, struct lspLine* line) {
+    if(line->parsed && line->isCode) {
+        document->changedOpcodes[line->command.opcode] = true;
+        for(unsigned i = 0; i < commandList[line->command.opcode].usedParameters; i++) {
+            free(line->command.parameters[i]);
+        }
+    }
+    freeDiagnostics(line->diagnostics, line->diagnosticCount);
+    free(line->text);
+}
+
+/**
+ * Replaces the lines firstLine to lastLine (inclusive) by the lines of the given text. The new lines are not parsed yet
+ */
+static void replaceLines(struct lspDocument* document, size_t firstLine, size_t lastLine, const char* text) {
+    size_t newLineCount = 1;
+    for(const char* c = text; *c != '\0'; c++) {
+        if(*c == '\n') newLineCount++;
+    }
+    size_t oldLineCount = lastLine - firstLine + 1;
+
+    for(size_t i = firstLine; i <= lastLine; i++) {
+        releaseLine(document, &document->lines[i]);
+    }
+
+    size_t lineCount = document->lineCount - oldLineCount + newLineCount;
+    if(lineCount > document->lineCapacity) {
+        document->lineCapacity = (lineCount > 2 * document->lineCapacity) ? lineCount : 2 * document->lineCapacity;
+        document->lines = realloc(document->lines, document->lineCapacity * sizeof(struct lspLine));
+        CHECK_ALLOC(document->lines);
+    }
+    memmove(document->lines + firstLine + newLineCount, document->lines + lastLine + 1, (document->lineCount - lastLine - 1) * sizeof(struct lspLine));
+    document->lineCount = lineCount;
+
+    const char* lineStart = text;
+    for(size_t i = 0; i < newLineCount; i++) {
+        const char* lineEnd = strchr(lineStart, '\n');
+        size_t length = (lineEnd != NULL) ? (size_t) (lineEnd - lineStart) : strlen(lineStart);
+        if(length > 0 && lineStart[length - 1] == '\r') {
+            length--;
+        }
+
+        struct lspLine* line = &document->lines[firstLine + i];
+        memset(line, 0, sizeof(struct lspLine));
+        line->text = strndup(lineStart, length);
+        CHECK_ALLOC(line->text);
+        lineStart = (lineEnd != NULL) ? lineEnd + 1 : lineStart + length;
+    }
+
+    //Errors of the analysis that are located after the replaced lines move along with them
+    if(newLineCount != oldLineCount) {
+        for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+            struct analysisResult* result = &document->analysisResults[i];
+            for(size_t j = 0; j < result->diagnosticCount; j++) {
+                if(result->diagnostics[j].lineNum > lastLine + 1) {
+                    result->diagnostics[j].lineNum = result->diagnostics[j].lineNum + newLineCount - oldLineCount;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Applies one entry of the contentChanges of a didChange notification. Changes without a range replace the whole document
+ */
+static void applyChange(struct lspDocument* document, struct jsonValue* change) {
+    const char* text = jsonGetString(change, "text");
+    if(text == NULL) {
+        return;
+    }
+
+    struct jsonValue* range = jsonGet(change, "range");
+    if(range == NULL) {
+        replaceLines(document, 0, document->lineCount - 1, text);
+        return;
+    }
+
+    struct jsonValue* start = jsonGet(range, "start");
+    struct jsonValue* end = jsonGet(range, "end");
+    long startLine = jsonGetInteger(start, "line", 0);
+    long endLine = jsonGetInteger(end, "line", 0);
+    if(startLine < 0) startLine = 0;
+    if(endLine < startLine) endLine = startLine;
+    if((size_t) startLine >= document->lineCount) startLine = (long) document->lineCount - 1;
+    if((size_t) endLine >= document->lineCount) endLine = (long) document->lineCount - 1;
+
+    const char* firstText = document->lines[startLine].text;
+    const char* lastText = document->lines[endLine].text;
+    size_t prefixLength = utf16ToByteOffset(firstText, jsonGetInteger(start, "character", 0));
+    const char* suffix = lastText + utf16ToByteOffset(lastText, jsonGetInteger(end, "character", 0));
+
+    //The replaced lines become: unchanged beginning of the first line + new text + unchanged end of the last line
+    char* newText = malloc(prefixLength + strlen(text) + strlen(suffix) + 1);
+    CHECK_ALLOC(newText);
+    memcpy(newText, firstText, prefixLength);
+    strcpy(newText + prefixLength, text);
+    strcat(newText, suffix);
+
+    replaceLines(document, (size_t) startLine, (size_t) endLine, newText);
+    free(newText);
+}
+
+static struct lspDocument* findDocument(struct languageServer* server, const char* uri) {
+    if(uri == NULL) {
+        return NULL;
+    }
+    for(size_t i = 0; i < server->documentCount; i++) {
+        if(strcmp(server->documents[i]->uri, uri) == 0) {
+            return server->documents[i];
+        }
+    }
+    return NULL;
+}
+
+static void closeDocument(struct languageServer* server, struct lspDocument* document) {
+    for(size_t i = 0; i < document->lineCount; i++) {
+        releaseLine(document, &document->lines[i]);
+    }
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        freeDiagnostics(document->analysisResults[i].diagnostics, document->analysisResults[i].diagnosticCount);
+    }
+    free(document->lines);
+    free(document->fileName);
+    free(document->uri);
+
+    for(size_t i = 0; i < server->documentCount; i++) {
+        if(server->documents[i] == document) {
+            server->documents[i] = server->documents[--server->documentCount];
+            break;
+        }
+    }
+    free(document);
+}
+
+/**
+ * Sends a message, preceded by the Content-Length header
+ */
+static void sendMessage(char* body, size_t length) {
+    printf("Content-Length: %zu\r\n\r\n", length);
+    fwrite(body, 1, length, stdout);
+    fflush(stdout);
+}
+
+/**
+ * Starts a response to a request. The result must be written to the returned stream, which is then passed to finishMessage()
+ */
+static FILE* startResponse(struct jsonValue* id, char** buffer, size_t* size) {
+    FILE* message = open_memstream(buffer, size);
+    CHECK_ALLOC(message);
+    fputs("{\"jsonrpc\":\"2.0\",\"id\":", message);
+    if(id != NULL) {
+        writeJsonValue(message, id);
+    } else {
+        fputs("null", message);
+    }
+    fputs(",\"result\":", message);
+    return message;
+}
+
+static void finishMessage(FILE* message, char** buffer, size_t* size) {
+    fputc('}', message);
+    fclose(message);
+    sendMessage(*buffer, *size);
+    free(*buffer);
+}
+
+static void sendError(struct jsonValue* id, int code, const char* errorMessage) {
+    char* buffer;
+    size_t size;
+    FILE* message = open_memstream(&buffer, &size);
+    CHECK_ALLOC(message);
+    fputs("{\"jsonrpc\":\"2.0\",\"id\":", message);
+    if(id != NULL) {
+        writeJsonValue(message, id);
+    } else {
+        fputs("null", message);
+    }
+    fprintf(message, ",\"error\":{\"code\":%d,\"message\":", code);
+    writeJsonString(message, errorMessage);
+    fputc('}', message);
+    finishMessage(message, &buffer, &size);
+}
+
+/**
+ * Writes an LSP range spanning the whole line
+ */
+static void writeLineRange(FILE* message, struct lspDocument* document, size_t lineIndex) {
+    long length = (lineIndex < document->lineCount) ? utf16Length(document->lines[lineIndex].text) : 0;
+    fprintf(message, "{\"start\":{\"line\":%zu,\"character\":0},\"end\":{\"line\":%zu,\"character\":%ld}}", lineIndex, lineIndex, length);
+}
+
+static void writeDiagnostics(FILE* message, struct lspDocument* document, struct diagnostic* diagnostics, size_t diagnosticCount, size_t lineIndex, bool* first) {
+    for(size_t i = 0; i < diagnosticCount; i++) {
+        //Line numbers of errors that refer to the whole file are 0
+        size_t diagnosticLine = lineIndex;
+        if(diagnosticLine == SIZE_MAX) {
+            diagnosticLine = (diagnostics[i].lineNum > 0) ? diagnostics[i].lineNum - 1 : 0;
+            if(diagnosticLine >= document->lineCount) diagnosticLine = document->lineCount - 1;
+        }
+
+        if(!*first) fputc(',', message);
+        *first = false;
+        fputs("{\"range\":", message);
+        writeLineRange(message, document, diagnosticLine);
+        fprintf(message, ",\"severity\":%d,\"source\":\"memeasm\",\"message\":", diagnostics[i].isNote ? SEVERITY_INFORMATION : SEVERITY_ERROR);
+        writeJsonString(message, diagnostics[i].message);
+        fputc('}', message);
+    }
+}
+
+/**
+ * Publishes the errors of all lines, the errors found while parsing functions, and the errors of all analysis functions
+ */
+static void publishDiagnostics(struct lspDocument* document, struct diagnostic* functionDiagnostics, size_t functionDiagnosticCount) {
+    char* buffer;
+    size_t size;
+    FILE* message = open_memstream(&buffer, &size);
+    CHECK_ALLOC(message);
+    fputs("{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":", message);
+    writeJsonString(message, document->uri);
+    fputs(",\"diagnostics\":[", message);
+
+    bool first = true;
+    for(size_t i = 0; i < document->lineCount; i++) {
+        //Errors of a line always refer to the line itself, their line number might be outdated after lines were inserted above
+        writeDiagnostics(message, document, document->lines[i].diagnostics, document->lines[i].diagnosticCount, i, &first);
+    }
+    writeDiagnostics(message, document, functionDiagnostics, functionDiagnosticCount, SIZE_MAX, &first);
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        writeDiagnostics(message, document, document->analysisResults[i].diagnostics, document->analysisResults[i].diagnosticCount, SIZE_MAX, &first);
+    }
+
+    fputs("]}", message);
+    finishMessage(message, &buffer, &size);
+}
+
+/**
+ * Parses all lines that changed, runs the analysis functions affected by the change and publishes all errors of the document
+ */
+static void analyseDocument(struct languageServer* server, struct lspDocument* document) {
+    struct compileState* compileState = &server->compileState;
+
+    size_t commandCount = 0;
+    for(size_t i = 0; i < document->lineCount; i++) {
+        if(!document->lines[i].parsed) {
+            parseDocumentLine(server, document, i);
+        }
+        if(document->lines[i].isCode) {
+            commandCount++;
+        }
+    }
+
+    //The analysis works on a copy of the commands, since it may modify them (e.g. "perfectly balanced as all things should be")
+    struct parsedCommand* commands = malloc((commandCount > 0 ? commandCount : 1) * sizeof(struct parsedCommand));
+    CHECK_ALLOC(commands);
+    size_t commandIndex = 0;
+    for(size_t i = 0; i < document->lineCount; i++) {
+        if(document->lines[i].isCode) {
+            commands[commandIndex] = document->lines[i].command;
+            commands[commandIndex].lineNum = i + 1;
+            commandIndex++;
+        }
+    }
+
+    struct file file = {.fileName = document->fileName, .loc = commandCount, .parsedCommands = commands};
+    compileState->files = &file;
+    compileState->fileCount = 1;
+
+    //Function structure
+    struct diagnostic* functionDiagnostics;
+    size_t functionDiagnosticCount;
+    if(commandCount == 0) {
+        printError(document->fileName, 0, compileState, "file does not contain any commands", 0);
+    }
+    parseFunctions(&file, (struct commandsArray) {.arrayPointer = commands, .size = commandCount}, compileState);
+    takeDiagnostics(compileState, 0, &functionDiagnostics, &functionDiagnosticCount);
+    compileState->outputMode = mainFunctionExists(compileState) ? executable : objectFile;
+
+    bool functionsChanged = !document->analysed;
+    bool dataChanged = false; //analyseData() checks all kinds of data, not only the opcode following its own
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        uint8_t commandType = commandList[i].commandType;
+        if(document->changedOpcodes[i] && (commandType == COMMAND_TYPE_FUNC_DEF || commandType == COMMAND_TYPE_FUNC_RETURN)) {
+            functionsChanged = true;
+        }
+        if(document->changedOpcodes[i] && commandType == COMMAND_TYPE_DATA) {
+            dataChanged = true;
+        }
+    }
+
+    struct commandLinkedList* commandLinkedList[NUMBER_OF_COMMANDS] = {NULL};
+    buildCommandLists(compileState, commandLinkedList, true);
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        if(commandList[i].analysisFunction == NULL) {
+            continue;
+        }
+        bool affected = functionsChanged || document->changedOpcodes[i] || (i + 1 < NUMBER_OF_COMMANDS && document->changedOpcodes[i + 1]) ||
+                        (dataChanged && commandList[i].analysisFunction == &analyseData);
+        if(!affected) {
+            continue;
+        }
+
+        struct analysisResult* result = &document->analysisResults[i];
+        freeDiagnostics(result->diagnostics, result->diagnosticCount);
+        commandList[i].analysisFunction(commandLinkedList, i, compileState);
+        takeDiagnostics(compileState, 0, &result->diagnostics, &result->diagnosticCount);
+    }
+    freeCommandLists(commandLinkedList);
+
+    free(file.functions);
+    free(commands);
+    compileState->files = NULL;
+    compileState->fileCount = 0;
+    memset(document->changedOpcodes, 0, sizeof(document->changedOpcodes));
+    document->analysed = true;
+
+    publishDiagnostics(document, functionDiagnostics, functionDiagnosticCount);
+    freeDiagnostics(functionDiagnostics, functionDiagnosticCount);
+}
+
+static void openDocument(struct languageServer* server, struct jsonValue* params) {
+    struct jsonValue* textDocument = jsonGet(params, "textDocument");
+    const char* uri = jsonGetString(textDocument, "uri");
+    const char* text = jsonGetString(textDocument, "text");
+    if(uri == NULL || text == NULL) {
+        return;
+    }
+
+    struct lspDocument* document = findDocument(server, uri);
+    if(document != NULL) {
+        closeDocument(server, document);
+    }
+
+    document = calloc(1, sizeof(struct lspDocument));
+    CHECK_ALLOC(document);
+    document->uri = strdup(uri);
+    CHECK_ALLOC(document->uri);
+    document->fileName = uriToFileName(uri);
+
+    //A document always consists of at least one line, which replaceLines() expects
+    document->lines = calloc(1, sizeof(struct lspLine));
+    CHECK_ALLOC(document->lines);
+    document->lines[0].text = strdup("");
+    CHECK_ALLOC(document->lines[0].text);
+    document->lineCount = 1;
+    document->lineCapacity = 1;
+    replaceLines(document, 0, 0, text);
+
+    if(server->documentCount == server->documentCapacity) {
+        server->documentCapacity = (server->documentCapacity == 0) ? 8 : server->documentCapacity * 2;
+        server->documents = realloc(server->documents, server->documentCapacity * sizeof(struct lspDocument*));
+        CHECK_ALLOC(server->documents);
+    }
+    server->documents[server->documentCount++] = document;
+    analyseDocument(server, document);
+}
+
+static void changeDocument(struct languageServer* server, struct jsonValue* params) {
+    struct lspDocument* document = findDocument(server, jsonGetString(jsonGet(params, "textDocument"), "uri"));
+    struct jsonValue* changes = jsonGet(params, "contentChanges");
+    if(document == NULL || changes == NULL || changes->type != JSON_ARRAY) {
+        return;
+    }
+    for(size_t i = 0; i < changes->count; i++) {
+        applyChange(document, &changes->items[i]);
+    }
+    analyseDocument(server, document);
+}
+
+static void removeDocument(struct languageServer* server, struct jsonValue* params) {
+    const char* uri = jsonGetString(jsonGet(params, "textDocument"), "uri");
+    struct lspDocument* document = findDocument(server, uri);
+    if(document == NULL) {
+        return;
+    }
+
+    //Clear the errors of the closed document
+    char* buffer;
+    size_t size;
+    FILE* message = open_memstream(&buffer, &size);
+    CHECK_ALLOC(message);
+    fputs("{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":", message);
+    writeJsonString(message, document->uri);
+    fputs(",\"diagnostics\":[]}", message);
+    finishMessage(message, &buffer, &size);
+
+    closeDocument(server, document);
+}
+
+/**
+ * Looks up the line a textDocument/definition or textDocument/hover request refers to
+ * @return the line, or NULL if it does not contain a valid command
+ */
+static struct lspLine* findRequestedLine(struct languageServer* server, struct jsonValue* params, struct lspDocument** document, size_t* byteColumn) {
+    *document = findDocument(server, jsonGetString(jsonGet(params, "textDocument"), "uri"));
+    struct jsonValue* position = jsonGet(params, "position");
+    long lineIndex = jsonGetInteger(position, "line", -1);
+    if(*document == NULL || lineIndex < 0 || (size_t) lineIndex >= (*document)->lineCount) {
+        return NULL;
+    }
+
+    struct lspLine* line = &(*document)->lines[lineIndex];
+    if(!line->isCode || line->diagnosticCount > 0) {
+        return NULL;
+    }
+    *byteColumn = utf16ToByteOffset(line->text, jsonGetInteger(position, "character", 0));
+    return line;
+}
+
+/**
+ * Determines which parameter of a command the cursor is on, by comparing the word under the cursor with all parameters
+ * @return the index of the parameter, or 0 if the cursor is not on a parameter
+ */
+static unsigned parameterAtColumn(struct lspLine* line, size_t byteColumn) {
+    const char* text = line->text;
+    size_t start = byteColumn;
+    size_t end = byteColumn;
+    while(start > 0 && text[start - 1] != ' ' && text[start - 1] != '\t') start--;
+    while(text[end] != '\0' && text[end] != ' ' && text[end] != '\t') end++;
+
+    for(unsigned i = 0; i < commandList[line->command.opcode].usedParameters; i++) {
+        const char* parameter = line->command.parameters[i];
+        #ifdef MACOS
+        //Function names have a "_" prefix
+        if(commandList[line->command.opcode].commandType == COMMAND_TYPE_FUNC_CALL) parameter++;
+        #endif
+        if(strlen(parameter) == end - start && strncmp(parameter, text + start, end - start) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finds the command that defines what the given command refers to (a function, jump marker or comparison label). This
+ * mirrors the checks of the analysis functions
+ * @return false if the command does not refer to anything
+ */
+static bool getDefinitionTarget(struct lspLine* line, size_t byteColumn, unsigned* definitionOpcode, int* parameter, bool* sameFile) {
+    unsigned opcode = line->command.opcode;
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        const struct command* command = &commandList[i];
+        if(commandList[opcode].commandType == COMMAND_TYPE_FUNC_CALL && command->commandType == COMMAND_TYPE_FUNC_DEF) {
+            *definitionOpcode = i;
+            *parameter = 0;
+            *sameFile = false;
+            return true;
+        } else if(command->analysisFunction == &analyseMonkeMarkers && opcode == i + 1) {
+            *definitionOpcode = i;
+            *parameter = 0;
+            *sameFile = false;
+            return true;
+        } else if(command->analysisFunction == &analyseJumpMarkers && opcode == i + 1) {
+            *definitionOpcode = i;
+            *parameter = -1;
+            *sameFile = true;
+            return true;
+        } else if(command->analysisFunction == &analyseWhoWouldWinCommands && opcode == i) {
+            *definitionOpcode = i + 1;
+            *parameter = (int) parameterAtColumn(line, byteColumn);
+            *sameFile = true;
+            return true;
+        } else if(command->analysisFunction == &analyseTheyreTheSamePictureCommands && opcode == i) {
+            *definitionOpcode = i + 1;
+            *parameter = -1;
+            *sameFile = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void handleDefinition(struct languageServer* server, struct jsonValue* id, struct jsonValue* params) {
+    char* buffer;
+    size_t size;
+    FILE* message = startResponse(id, &buffer, &size);
+
+    struct lspDocument* document;
+    size_t byteColumn;
+    struct lspLine* line = findRequestedLine(server, params, &document, &byteColumn);
+    unsigned definitionOpcode;
+    int parameter;
+    bool sameFile;
+    bool found = false;
+
+    if(line != NULL && getDefinitionTarget(line, byteColumn, &definitionOpcode, &parameter, &sameFile)) {
+        for(size_t i = 0; i < server->documentCount && !found; i++) {
+            struct lspDocument* candidateDocument = server->documents[i];
+            if(sameFile && candidateDocument != document) {
+                continue;
+            }
+            for(size_t j = 0; j < candidateDocument->lineCount; j++) {
+                struct lspLine* candidate = &candidateDocument->lines[j];
+                if(candidate->isCode && candidate->command.opcode == definitionOpcode &&
+                   (parameter < 0 || strcmp(candidate->command.parameters[0], line->command.parameters[parameter]) == 0)) {
+                    fputs("{\"uri\":", message);
+                    writeJsonString(message, candidateDocument->uri);
+                    fputs(",\"range\":", message);
+                    writeLineRange(message, candidateDocument, j);
+                    fputc('}', message);
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if(!found) {
+        fputs("null", message);
+    }
+    finishMessage(message, &buffer, &size);
+}
+
+/**
+ * Answers a hover request with the assembly code the command is translated into
+ */
+static void handleHover(struct languageServer* server, struct jsonValue* id, struct jsonValue* params) {
+    char* buffer;
+    size_t size;
+    FILE* message = startResponse(id, &buffer, &size);
+
+    struct lspDocument* document;
+    size_t byteColumn;
+    struct lspLine* line = findRequestedLine(server, params, &document, &byteColumn);
+    if(line == NULL) {
+        fputs("null", message);
+    } else {
+        char* assembly;
+        size_t assemblySize;
+        FILE* assemblyStream = open_memstream(&assembly, &assemblySize);
+        CHECK_ALLOC(assemblyStream);
+        fputs("```asm\n", assemblyStream);
+        translateToAssembly(&server->compileState, "", &line->command, 0, false, assemblyStream);
+        fputs("```", assemblyStream);
+        fclose(assemblyStream);
+
+        fputs("{\"contents\":{\"kind\":\"markdown\",\"value\":", message);
+        writeJsonString(message, assembly);
+        fputs("}}", message);
+        free(assembly);
+    }
+    finishMessage(message, &buffer, &size);
+}
+
+/**
+ * Reads the next message from stdin
+ * @return the message body, or NULL on end of input
+ */
+static char* readMessage(size_t* length) {
+    char* header = NULL;
+    size_t headerCapacity = 0;
+    ssize_t headerLength;
+    long contentLength = -1;
+
+    while((headerLength = getline(&header, &headerCapacity, stdin)) != -1) {
+        if(strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0) {
+            if(contentLength >= 0) {
+                break;
+            }
+            continue;
+        }
+        if(strncasecmp(header, "Content-Length:", strlen("Content-Length:")) == 0) {
+            contentLength = strtol(header + strlen("Content-Length:"), NULL, 10);
+        }
+    }
+    free(header);
+    if(headerLength == -1 || contentLength < 0) {
+        return NULL;
+    }
+
+    char* body = malloc((size_t) contentLength + 1);
+    CHECK_ALLOC(body);
+    *length = fread(body, 1, (size_t) contentLength, stdin);
+    if(*length != (size_t) contentLength) {
+        free(body);
+        return NULL;
+    }
+    body[*length] = '\0';
+    return body;
+}
+
+/**
+ * Handles a request or notification
+ * @return -1 to continue, otherwise the exit code of the server
+ */
+static int handleMessage(struct languageServer* server, struct jsonValue* request) {
+    const char* method = jsonGetString(request, "method");
+    struct jsonValue* id = jsonGet(request, "id");
+    struct jsonValue* params = jsonGet(request, "params");
+    if(method == NULL) {
+        return -1;
+    }
+
+    if(strcmp(method, "initialize") == 0) {
+        char* buffer;
+        size_t size;
+        FILE* message = startResponse(id, &buffer, &size);
+        fputs("{\"capabilities\":{\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+              "\"definitionProvider\":true,\"hoverProvider\":true},"
+              "\"serverInfo\":{\"name\":\"memeasm\",\"version\":", message);
+        writeJsonString(message, versionString + 1);
+        fputs("}}", message);
+        finishMessage(message, &buffer, &size);
+    } else if(strcmp(method, "shutdown") == 0) {
+        server->shutdownRequested = true;
+        char* buffer;
+        size_t size;
+        FILE* message = startResponse(id, &buffer, &size);
+        fputs("null", message);
+        finishMessage(message, &buffer, &size);
+    } else if(strcmp(method, "exit") == 0) {
+        return server->shutdownRequested ? 0 : 1;
+    } else if(strcmp(method, "textDocument/didOpen") == 0) {
+        openDocument(server, params);
+    } else if(strcmp(method, "textDocument/didChange") == 0) {
+        changeDocument(server, params);
+    } else if(strcmp(method, "textDocument/didClose") == 0) {
+        removeDocument(server, params);
+    } else if(strcmp(method, "textDocument/definition") == 0) {
+        handleDefinition(server, id, params);
+    } else if(strcmp(method, "textDocument/hover") == 0) {
+        handleHover(server, id, params);
+    } else if(id != NULL) {
+        //Notifications that are not supported (e.g. "initialized") are ignored, requests are answered with an error
+        sendError(id, METHOD_NOT_FOUND, "Method not supported by the MemeAssembly language server");
+    }
+    return -1;
+}
+
+/**
+ * Runs the language server until the client sends "exit" or closes stdin
+ * @return the exit code
+ */
+int runLanguageServer(void) {
+    struct languageServer server = {
+        .compileState = {
+            .compileMode = noob,
+            .optimisationLevel = none,
+            .translateMode = intSISD,
+            .outputMode = executable,
+            .martyrdom = true,
+            .logLevel = normal,
+            .collectDiagnostics = true,
+            .computedIndex = COMPUTED_INDEX_START
+        }
+    };
+
+    int exitCode = 1;
+    char* body;
+    size_t length;
+    while((body = readMessage(&length)) != NULL) {
+        struct jsonValue* request = parseJson(body, length);
+        free(body);
+        if(request == NULL) {
+            sendError(NULL, PARSE_ERROR, "Invalid JSON");
+            continue;
+        }
+
+        exitCode = handleMessage(&server, request);
+        freeJson(request);
+        if(exitCode != -1) {
+            break;
+        }
+    }
+
+    while(server.documentCount > 0) {
+        closeDocument(&server, server.documents[0]);
+    }
+    free(server.documents);
+    free(server.compileState.diagnostics);
+    return (exitCode == -1) ? 1 : exitCode;
+}
+
+#else
+
+int runLanguageServer(void) {
+    fprintf(stderr, "Error: the language server is not supported on Windows\n");
+    return 1;
+}
+
+#endif
@@ -23,10 +23,21 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <stdbool.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <time.h>
 
 #include "compiler.h"
 #include "parser/parser.h"
 #include "logger/log.h"
+#include "server/server.h"
+#include "batch/batch.h"
+#include "watch/watch.h"
+#include "lsp/lsp.h"
+#include "cache/cache.h"
+#include "ir/ir.h"
+#include "analyser/randomCommands.h"
+#include "report/timeReport.h"
+#include "report/remarks.h"
 extern const char* const versionString;
 
 /**
@@ -39,7 +50,12 @@ void printHelpPage(char* programName) {
     printf(" %s [options] -S -o outputFile.S [-i | -d] inputFile\tOnly compiles the specified file and saves it as x86_64 Assembly code\n", programName);
     printf(" %s [options] -O -o outputFile.o [-i | -d] inputFile\tOnly compiles the specified file and saves it an object file\n", programName);
     printf(" %s (-h | --help)\t\t\t\t\tDisplays this help page\n", programName);
-    printf(" %s -v\t\t\t\t\t\t\tPrints version information\n\n", programName);
+    printf(" %s -v\t\t\t\t\t\t\tPrints version information\n", programName);
+    printf(" %s --server socket [-j workers]\t\t\tStarts a compile server listening on the given Unix domain socket\n", programName);
+    printf(" %s --client socket [options] -o outputFile inputFile\tForwards the compilation to a running compile server. An inputFile \"-\" sends stdin to the server\n", programName);
+    printf(" %s --batch manifest [-j workers]\t\t\tCompiles every program of the manifest, one line of options per program\n", programName);
+    printf(" %s --watch [options] -o outputFile inputFile\tRebuilds the output whenever an input file changes (Linux only)\n", programName);
+    printf(" %s --lsp\t\t\t\t\t\tStarts a language server communicating over stdin and stdout\n\n", programName);
     printf("Compiler options:\n");
     printf(" -O-1 \t\t- reverse optimisation stage 1: A nop is inserted after every command\n");
     printf(" -O-2 \t\t- reverse optimisation stage 2: A register is moved to and from the Stack after every command\n");
@@ -49,14 +65,80 @@ void printHelpPage(char* programName) {
     printf(" -fcompile-mode - Change the compile mode to noob (default), bully, or obfuscated\n");
     printf(" -g \t\t- write debug info into the compiled file. Currently, only the STABS format is supported (Linux-only)\n");
     printf(" -fno-martyrdom - Disables martyrdom\n");
+    printf(" --stack-usage \t- prints the worst-case stack depth of every function and its call chain. Recursion and dynamic stack pointer manipulation are reported as unbounded\n");
+    printf(" --cache-dir dir - reuses the output of a previous compilation with identical input files and options. Compiled outputs are stored in the given directory. Can also be set using the environment variable MEMEASM_CACHE_DIR\n");
+    printf(" --build-dir dir - compiles every input file into a separate object in the given directory. On subsequent compilations, only changed files are parsed and assembled again\n");
+    printf(" --emit=ir-bin \t- saves the parsed and analysed program as a binary IR file instead of translating it. IR files can be used as input files and are loaded without parsing them again\n");
+    printf(" --stream \t- parses, checks and translates one function at a time instead of keeping all input files in memory. Cannot be used in bully mode or with --stack-usage\n");
+    printf(" -frandom-seed=seed - seeds the random choices of \"confused stonks\" and \"perfectly balanced as all things should be\" so that the output is reproducible. By default, the current time is used\n");
+    printf(" -ftime-report \t- prints the duration and peak memory usage of every compilation phase as JSON to stderr\n");
+    printf(" --stats \t- prints counters of the parser (lines, pattern comparisons, commands), the memory usage and the output size per section as JSON to stderr\n");
+    printf(" -Rpass=regex \t- prints a remark for every transformation of your code (e.g. lines deleted by \"perfectly balanced as all things should be\", commands replaced in bully mode, code inserted by -O-1) done by a pass whose name matches the regular expression. Passes: perfectly-balanced, bully, o69420, reverse-optimisation, reverse-storage\n");
+    printf(" -Rpass-missed=regex - prints a remark for every transformation that could not be done by a pass whose name matches the regular expression\n");
+    printf(" -fsave-optimization-record[=yaml|json] - writes all remarks into outputFile.opt.yaml (or .opt.json). The file name can be changed using -foptimization-record-file=file\n");
+    printf(" -j jobs \t- compiles every input file into a separate object, using the given number of processes in parallel, and links them afterwards\n");
     printf(" -d \t\t- enables debug logs\n");
 }
 
+/**
+ * Checks if any of the input files is a binary IR file
+ */
+static bool containsIRFile(int fileCount, char* fileNames[]) {
+    for(int i = 0; i < fileCount; i++) {
+        FILE* inputFile = fopen(fileNames[i], "rb");
+        if(inputFile != NULL) {
+            bool irFile = isIRFile(inputFile);
+            fclose(inputFile);
+            if(irFile) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void printExplanationMessage(char* programName) {
     printf("Usage: %s -o outputFile inputFile\n", programName);
 }
 
-int main(int argc, char* argv[]) {
+/**
+ * Parses the number of jobs or workers given with -j
+ * @return false if it is not a number from 1 to 1024
+ */
+static bool parseJobCount(const char* string, unsigned* jobs) {
+    char *endptr;
+    errno = 0;
+    long result = strtol(string, &endptr, 10);
+    if(endptr == string || *endptr != '\0' || errno != 0 || result < 1 || result > 1024) {
+        fprintf(stderr, "Invalid number of jobs specified: %s\n", string);
+        return false;
+    }
+    *jobs = (unsigned) result;
+    return true;
+}
+
+/**
+ * Hands the files parsed so far and the remarks of arguments that cannot be compiled to the caller, so that a long-lived
+ * process (e.g. the compile server) can free them
+ * @return exitCode
+ */
+static int rejectArguments(struct compileState* compileStatePtr, struct compileState* compileState, struct file* fileStructs, uint32_t fileCount, int exitCode) {
+    compileState->files = fileStructs;
+    compileState->fileCount = fileCount;
+    *compileStatePtr = *compileState;
+    return exitCode;
+}
+
+/**
+ * Parses the command line options and all input files
+ * @param compileStatePtr the compile state that is filled according to the options. It is also set if compilation
+ *                        cannot start, its files and remarks must then be freed with freeRequestFiles() and freeRemarks()
+ * @param outputFileName is set to the name of the output file
+ * @param parseCache if not NULL, parsed files are looked up in and added to this cache (used by the compile server)
+ * @return -1 if compilation can start, otherwise the exit code the program should exit with
+ */
+int parseArguments(int argc, char* argv[], struct compileState* compileStatePtr, char** outputFileName, struct parseCache* parseCache) {
+    *compileStatePtr = (struct compileState) {0};
     struct compileState compileState = {
         .compileMode = noob,
         .optimisationLevel = none,
@@ -64,27 +146,58 @@ int main(int argc, char* argv[]) {
         .outputMode = executable,
         .useStabs = false,
         .compilerErrors = 0,
-        .logLevel = normal
+        .logLevel = normal,
+        .jobs = 1,
+        .computedIndex = COMPUTED_INDEX_START
     };
 
     char *outputFileString = NULL;
+    char *cacheDir = getenv("MEMEASM_CACHE_DIR");
+    char *buildDir = NULL;
     FILE *inputFile;
 
     int optimisationLevel = 0;
     int martyrdom = true;
+    int stackUsage = false;
+    int streaming = false;
+    int timeReport = false;
+    int stats = false;
+    char* remarkPatterns[] = {NULL, NULL};
+    remarkRecordFormat recordFormat = recordNone;
+    char* recordFileName = NULL;
     const struct option long_options[] = {
             {"output",  required_argument, 0, 'o'},
             {"help",    no_argument,       0, 'h'},
             {"debug",   no_argument,       0, 'd'},
             {"fno-martyrdom",    no_argument,&martyrdom, false},
+            {"stack-usage",    no_argument,&stackUsage, true},
+            {"stream",    no_argument,&streaming, true},
+            {"ftime-report",    no_argument,&timeReport, true},
+            {"stats",    no_argument,&stats, true},
             {"fcompile-mode",    required_argument,0, 'c'},
+            {"cache-dir",    required_argument,0, 'C'},
+            {"build-dir",    required_argument,0, 'B'},
+            {"emit",    required_argument,0, 'e'},
+            {"frandom-seed",    required_argument,0, 'R'},
+            {"Rpass",    required_argument,0, 'P'},
+            {"Rpass-missed",    required_argument,0, 'M'},
+            {"fsave-optimization-record",    optional_argument,0, 'Y'},
+            {"foptimization-record-file",    required_argument,0, 'F'},
             { 0, 0, 0, 0 }
     };
 
     int opt;
     int option_index = 0;
 
-    while ((opt = getopt_long_only(argc, argv, "o:hO::dgSv", long_options, &option_index)) != -1) {
+    //The compile server parses the arguments of every request, so getopt needs to be reset
+    #ifdef MACOS
+    optreset = 1;
+    optind = 1;
+    #else
+    optind = 0;
+    #endif
+
+    while ((opt = getopt_long_only(argc, argv, "o:hO::dgSvj:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'h':
                 printHelpPage(argv[0]);
@@ -148,6 +261,56 @@ int main(int argc, char* argv[]) {
                     return 1;
                 }
                 break;
+            case 'C': //--cache-dir
+                cacheDir = optarg;
+                break;
+            case 'B': //--build-dir
+                buildDir = optarg;
+                break;
+            case 'e': //--emit
+                if(strcmp(optarg, "ir-bin") == 0) {
+                    compileState.outputMode = irBinaryFile;
+                } else {
+                    fprintf(stderr, "Error: invalid output format (must be \"ir-bin\")\n");
+                    return 1;
+                }
+                break;
+            case 'R': { //--frandom-seed
+                char *endptr;
+                errno = 0;
+                unsigned long long seed = strtoull(optarg, &endptr, 0);
+                if(endptr == optarg || *endptr != '\0' || errno != 0 || optarg[0] == '-') {
+                    fprintf(stderr, "Invalid random seed specified: %s\n", optarg);
+                    return 1;
+                }
+                seedRandom(&compileState, (uint64_t) seed);
+                compileState.fixedRandomSeed = true;
+                break;
+            }
+            case 'P': //-Rpass
+                remarkPatterns[remarkPassed] = optarg;
+                break;
+            case 'M': //-Rpass-missed
+                remarkPatterns[remarkMissed] = optarg;
+                break;
+            case 'Y': //-fsave-optimization-record
+                if(optarg == NULL || strcmp(optarg, "yaml") == 0) {
+                    recordFormat = recordYAML;
+                } else if(strcmp(optarg, "json") == 0) {
+                    recordFormat = recordJSON;
+                } else {
+                    fprintf(stderr, "Error: invalid optimisation record format (must be \"yaml\" or \"json\")\n");
+                    return 1;
+                }
+                break;
+            case 'F': //-foptimization-record-file
+                recordFileName = optarg;
+                break;
+            case 'j':
+                if(!parseJobCount(optarg, &compileState.jobs)) {
+                    return 1;
+                }
+                break;
             case '?':
                 fprintf(stderr, "Error: Unknown option provided\n");
                 printExplanationMessage(argv[0]);
@@ -155,10 +318,68 @@ int main(int argc, char* argv[]) {
         }
     }
     compileState.martyrdom = martyrdom;
+    compileState.stackUsage = stackUsage;
+    compileState.timeReport.enabled = timeReport;
+    compileState.stats.enabled = stats;
+    if(!compileState.fixedRandomSeed) {
+        seedRandom(&compileState, (uint64_t) time(NULL));
+    }
     if(compileState.useStabs && compileState.compileMode == bully) {
         printNote("-g cannot be used in bully mode, this option will be ignored.", false, 0);
         compileState.useStabs = false;
     }
+    #ifdef WINDOWS
+    if(cacheDir != NULL && cacheDir[0] != 0) {
+        printNote("--cache-dir cannot be used on Windows-systems, this option will be ignored.", false, 0);
+    }
+    if(buildDir != NULL) {
+        printNote("--build-dir cannot be used on Windows-systems, this option will be ignored.", false, 0);
+    }
+    if(compileState.jobs > 1) {
+        printNote("-j cannot be used on Windows-systems, this option will be ignored.", false, 0);
+    }
+    cacheDir = NULL;
+    buildDir = NULL;
+    compileState.jobs = 1;
+    #endif
+    if(recordFileName != NULL && recordFormat == recordNone) {
+        recordFormat = recordYAML;
+    }
+    bool remarksRequested = remarkPatterns[remarkPassed] != NULL || remarkPatterns[remarkMissed] != NULL || recordFormat != recordNone;
+    if(remarksRequested && (buildDir != NULL || compileState.jobs > 1)) {
+        //Unchanged files are not compiled again and separately compiled files are translated by other processes, so their remarks would be missing
+        printNote("--build-dir and -j cannot be combined with remarks, these options will be ignored.", false, 0);
+        buildDir = NULL;
+        compileState.jobs = 1;
+    }
+    if(compileState.outputMode == irBinaryFile && compileState.compileMode == bully) {
+        //In bully mode, functions contain copies of commands, which cannot be stored as part of a file
+        fprintf(stderr, "Error: --emit=ir-bin cannot be used in bully mode\n");
+        return 1;
+    }
+    if(streaming && (compileState.compileMode == bully || compileState.stackUsage || compileState.outputMode == irBinaryFile)) {
+        printNote("--stream cannot be used in bully mode, with --stack-usage or --emit, this option will be ignored.", false, 0);
+        streaming = false;
+    }
+    if(streaming && containsIRFile(argc - optind, argv + optind)) {
+        printNote("--stream cannot be used with binary IR input files, this option will be ignored.", false, 0);
+        streaming = false;
+    }
+    if(streaming && (buildDir != NULL || compileState.jobs > 1)) {
+        printNote("--build-dir and -j cannot be combined with --stream, these options will be ignored.", false, 0);
+        buildDir = NULL;
+        compileState.jobs = 1;
+    }
+    compileState.streaming = streaming;
+    if(buildDir != NULL && containsIRFile(argc - optind, argv + optind)) {
+        printNote("--build-dir cannot be used with binary IR input files, this option will be ignored.", false, 0);
+        buildDir = NULL;
+    }
+    if(buildDir != NULL && (compileState.compileMode != noob || compileState.outputMode == assemblyFile || compileState.outputMode == irBinaryFile || compileState.stackUsage)) {
+        printNote("--build-dir can only be used in noob mode when generating an executable or object file, this option will be ignored.", false, 0);
+        buildDir = NULL;
+    }
+    compileState.buildDir = buildDir;
 
     if(outputFileString == NULL) {
         fprintf(stderr, "Error: No output file specified\n");
@@ -173,18 +394,47 @@ int main(int argc, char* argv[]) {
         //The first is at optind, the last at argc-1
         uint32_t fileCount = argc - optind;
 
+        for(remarkKind kind = remarkPassed; kind <= remarkMissed; kind++) {
+            if(remarkPatterns[kind] != NULL && !setRemarkFilter(&compileState, kind, remarkPatterns[kind])) {
+                fprintf(stderr, "Error: invalid regular expression for %s: %s\n", (kind == remarkPassed) ? "-Rpass" : "-Rpass-missed", remarkPatterns[kind]);
+                return rejectArguments(compileStatePtr, &compileState, NULL, 0, 1);
+            }
+        }
+        if(recordFormat != recordNone) {
+            if(recordFileName != NULL) {
+                setRemarkRecord(&compileState, recordFormat, recordFileName);
+            } else {
+                //Like the output file, but with the suffix .opt.yaml or .opt.json
+                char defaultFileName[strlen(outputFileString) + sizeof(".opt.yaml")];
+                sprintf(defaultFileName, "%s.opt.%s", outputFileString, (recordFormat == recordYAML) ? "yaml" : "json");
+                setRemarkRecord(&compileState, recordFormat, defaultFileName);
+            }
+        }
+
+        //The stack usage report, the time report, the statistics, remarks and debug logs are printed during compilation, so a cached output cannot be used
+        if(cacheDir != NULL && cacheDir[0] != 0 && !compileState.stackUsage && compileState.logLevel != debug && !compileState.timeReport.enabled && !compileState.stats.enabled && !remarksRequested
+           && computeCacheKey(&compileState, (int) fileCount, argv + optind)) {
+            compileState.cacheDir = cacheDir;
+            if(restoreFromCache(&compileState, outputFileString)) {
+                return rejectArguments(compileStatePtr, &compileState, NULL, 0, 0);
+            }
+        }
+
         //Now allocate fileCount file structs on the heap
         struct file* fileStructs = calloc(fileCount, sizeof(struct file));
         CHECK_ALLOC(fileStructs);
 
-        //Open each file one by one and parse it into a "struct file"
-        for(int i = optind; i < argc; i++) {
-            inputFile = fopen(argv[i], "r");
+        //Open each file one by one and parse it into a "struct file". A binary IR file can contain multiple files
+        startPhase(&compileState);
+        uint32_t fileNum = 0;
+        for(int i = optind; i < argc; i++, fileNum++) {
+            //The compile server can receive an input file's content instead of its path
+            inputFile = openRequestInput(parseCache, argv[i]);
             //If the pointer is NULL, then the file failed to open. Print an error
             if (inputFile == NULL) {
                 perror("Failed to open input file");
                 printExplanationMessage(argv[0]);
-                return 1;
+                return rejectArguments(compileStatePtr, &compileState, fileStructs, fileNum, 1);
             }
 
             //Create a stat struct to check if the file is a regular file. If we did not check for this, an input file like "/dev/urandom" would pass without errors
@@ -195,20 +445,53 @@ int main(int argc, char* argv[]) {
                         "Error while opening input file: Your provided file name does not point to a regular file (e.g. it could be a directory, character device or a socket)\n");
                 fclose(inputFile);
                 printExplanationMessage(argv[0]);
-                return 1;
+                return rejectArguments(compileStatePtr, &compileState, fileStructs, fileNum, 1);
+            }
+
+            //Binary IR files are mapped into memory instead of being parsed
+            if(isIRFile(inputFile)) {
+                printDebugMessage(compileState.logLevel, "Loading binary IR file \"%s\"", 1, argv[i]);
+                struct file* irFiles;
+                size_t irFileCount = loadIRFile(argv[i], inputFile, &irFiles);
+                fclose(inputFile);
+                if(irFileCount == 0) {
+                    return rejectArguments(compileStatePtr, &compileState, fileStructs, fileNum, 1);
+                }
+
+                fileCount += irFileCount - 1;
+                fileStructs = realloc(fileStructs, fileCount * sizeof(struct file));
+                CHECK_ALLOC(fileStructs);
+                memcpy(&fileStructs[fileNum], irFiles, irFileCount * sizeof(struct file));
+                memset(&fileStructs[fileNum + irFileCount], 0, (fileCount - fileNum - irFileCount) * sizeof(struct file));
+                fileNum += irFileCount - 1;
+                free(irFiles);
+                continue;
             }
 
             //Set the attribute "fileName" in the struct, because the parsing function uses this attribute for error printing
-            fileStructs[i - optind].fileName = argv[i];
+            fileStructs[fileNum].fileName = argv[i];
+
+            //In incremental mode, the files are parsed during compilation if they changed. In streaming mode, they are parsed while being translated
+            if(compileState.buildDir != NULL || compileState.streaming) {
+                fclose(inputFile);
+                continue;
+            }
 
             //Parse file
             printDebugMessage(compileState.logLevel, "Opening file \"%s\" successful, parsing file...", 1, argv[i]);
-            parseFile(&fileStructs[i - optind], inputFile, &compileState);
+            if(parseCache != NULL) {
+                parseFileCached(parseCache, &fileStructs[fileNum], inputFile, &compileState);
+            } else {
+                parseFile(&fileStructs[fileNum], inputFile, &compileState);
+            }
             printDebugMessage(compileState.logLevel, "File parsing done, closing file...", 0);
             fclose(inputFile);
         }
         compileState.fileCount = fileCount;
         compileState.files = fileStructs;
+        if(compileState.buildDir == NULL && !compileState.streaming) {
+            endPhase(&compileState, phaseParse);
+        }
 
         //Convert our optmisationLevel to a value that our struct can work with to make it more readable later on
         //If optimisationLevel == 0, then leave the value at none (default)
@@ -224,6 +507,66 @@ int main(int argc, char* argv[]) {
             compileState.optimisationLevel = o69420;
         }
 
-        compile(compileState, outputFileString);
+        *compileStatePtr = compileState;
+        *outputFileName = outputFileString;
+        return -1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    //memeasm --server socket [-j workers]
+    if(argc >= 3 && strcmp(argv[1], "--server") == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        unsigned workers = (processors > 0) ? (unsigned) processors : 1;
+        if(argc == 5 && strcmp(argv[3], "-j") == 0) {
+            if(!parseJobCount(argv[4], &workers)) {
+                return 1;
+            }
+        } else if(argc != 3) {
+            fprintf(stderr, "Usage: %s --server socket [-j workers]\n", argv[0]);
+            return 1;
+        }
+        return runServer(argv[2], workers, &parseArguments);
+    }
+
+    //memeasm --batch manifest [-j workers]
+    if(argc >= 3 && strcmp(argv[1], "--batch") == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        unsigned workers = (processors > 0) ? (unsigned) processors : 1;
+        if(argc == 5 && strcmp(argv[3], "-j") == 0) {
+            if(!parseJobCount(argv[4], &workers)) {
+                return 1;
+            }
+        } else if(argc != 3) {
+            fprintf(stderr, "Usage: %s --batch manifest [-j workers]\n", argv[0]);
+            return 1;
+        }
+        return runBatch(argv[2], workers, argv[0], &parseArguments);
+    }
+
+    //memeasm --lsp
+    if(argc == 2 && strcmp(argv[1], "--lsp") == 0) {
+        return runLanguageServer();
+    }
+
+    //memeasm --watch [options] -o outputFile inputFile(s)
+    if(argc >= 2 && strcmp(argv[1], "--watch") == 0) {
+        argv[1] = argv[0];
+        return runWatch(argc - 1, argv + 1, &parseArguments);
+    }
+
+    //memeasm --client socket [options] -o outputFile inputFile(s)
+    if(argc >= 3 && strcmp(argv[1], "--client") == 0) {
+        char* socketPath = argv[2];
+        argv[2] = argv[0];
+        return runClient(socketPath, argc - 2, argv + 2);
+    }
+
+    struct compileState compileState;
+    char* outputFileName;
+    int exitCode = parseArguments(argc, argv, &compileState, &outputFileName, NULL);
+    if(exitCode != -1) {
+        return exitCode;
     }
+    return compile(&compileState, outputFileName);
 }
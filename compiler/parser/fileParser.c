@@ -23,26 +23,21 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <string.h>
 
 #include "../logger/log.h"
-
-#ifdef WINDOWS
-/* strtok_r does not exist on Windows and instead is strtok_s. Use a preprocessor directive to replace all occurrences */
-# define strtok_r strtok_s
-#endif
+#include "../analyser/parameters.h"
+#include "../report/stats.h"
+#include "../report/remarks.h"
 
 extern struct command commandList[];
 
-//Used to pseudo-random generation when using bully mode
-uint64_t computedIndex = 69;
-
 /**
  * Removes the \n from a string if it is present at the end of the string
  */
 void removeLineBreaksAndTabs(char* line) {
-    size_t i = strlen(line) - 1;
-    while (line[i] == '\t' || line[i] == '\n' || line[i] == ' ') {
-        i--;
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\t' || line[length - 1] == '\n' || line[length - 1] == ' ')) {
+        length--;
     }
-    line[i + 1] = '\0';
+    line[length] = '\0';
 }
 
 /**
@@ -64,7 +59,7 @@ int isLineOfInterest(const char* line, ssize_t lineLength) {
 
 /**
  * A basic implementation of a getline-function.
- * Reads a full line and stores it in lineptr. If lineptr is NULL, it will be initialised and n will be set accordingly. When too little is allocated, 128 more Bytes will be added
+ * Reads a full line and stores it in lineptr. If lineptr is NULL, it will be initialised and n will be set accordingly. When too little is allocated, the buffer is doubled
  * @param lineptr a pointer to the current storage for lines. May be NULL
  * @param n must be the size of lineptr and will be updated by this function
  * @param stream from where to read
@@ -79,11 +74,11 @@ ssize_t getLine(char **restrict lineptr, size_t *restrict n, FILE *restrict stre
     }
 
     char* result = *lineptr;
-    char c = 'c';
+    int c = 'c';
     ssize_t bytesRead = 0;
     while(c != '\n') {
-        size_t readRes = fread(&c, 1, 1, stream);
-        if(readRes == 0) {
+        c = getc(stream);
+        if(c == EOF) {
             if(bytesRead == 0) {
                 return -1;
             }
@@ -91,24 +86,25 @@ ssize_t getLine(char **restrict lineptr, size_t *restrict n, FILE *restrict stre
             break;
         }
 
-        *result = c;
+        *result = (char) c;
         bytesRead++;
         result++;
         if(bytesRead == (ssize_t) *n) {
-            *n += 128;
-            *lineptr = realloc(*lineptr, *n);
-            result = *lineptr + bytesRead;
-
-            if(!*lineptr) {
+            //Growing geometrically keeps reading a long line linear in its length
+            char* newLine = realloc(*lineptr, *n * 2);
+            if(!newLine) {
                 return -1;
             }
+            *n *= 2;
+            *lineptr = newLine;
+            result = *lineptr + bytesRead;
         }
     }
 
     //On Windows, file endings are done using \r\n. This means that there will be a \r at the end of every string, breaking the entire compiler
     //To fix this, check if the string ends with \r\n. If so, replace it with \n
     //However, we first need to check that we are not reading out of bounds
-    if(((uintptr_t) result - 2 >= (uintptr_t) *lineptr) && *(result - 2) == '\r') {
+    if(bytesRead >= 2 && *(result - 2) == '\r') {
         *(result - 2) = '\n';
         result--;
     }
@@ -143,14 +139,181 @@ size_t getLinesOfCode(FILE *inputFile) {
 }
 
 /**
- * Frees the memory of variables after they are not needed anymore
- * @param parsedCommand the parsedCommand struct
- * @param numberOfParameters how many variables are currently in use (allocated)
+ * Returns the next token of a line or command pattern. Tokens are split like strtok_r() would split them, but the string
+ * is not modified and nothing is copied
+ * @param position the current position. Is moved behind the token and the delimiter following it
+ * @param delimiters the characters separating tokens
+ * @param length is set to the length of the token
+ * @return the start of the token, or NULL if there are no more tokens
+ */
+const char* nextToken(const char** position, const char* delimiters, size_t* length) {
+    const char* token = *position + strspn(*position, delimiters);
+    if(*token == '\0') {
+        *position = token;
+        return NULL;
+    }
+    *length = strcspn(token, delimiters);
+    *position = token + *length + (token[*length] != '\0');
+    return token;
+}
+
+/**
+ * A token of the line that is currently parsed
+ */
+struct lineToken {
+    const char* text;
+    size_t length;
+    const char* rest; //The rest of the line after this token and its delimiter
+};
+
+//Lines with up to this many tokens are split without allocating memory. Longer lines use a heap-allocated array
+#define MAX_STACK_TOKENS 32
+
+/**
+ * Splits a line into tokens. Tabs at the beginning are allowed and should be ignored, hence they are a delimiter for the first token
+ * @param tokens where to store the tokens. If NULL, they are only counted
+ * @return the number of tokens in the line
+ */
+static size_t tokenizeLine(const char* line, struct lineToken* tokens) {
+    size_t tokenCount = 0;
+    size_t length;
+    const char* position = line;
+    const char* token = nextToken(&position, " \t", &length);
+    while(token != NULL) {
+        if(tokens != NULL) {
+            tokens[tokenCount] = (struct lineToken) {.text = token, .length = length, .rest = position};
+        }
+        tokenCount++;
+        token = nextToken(&position, " ", &length);
+    }
+    return tokenCount;
+}
+
+/**
+ * The result of matching a line against a single command pattern. Parameters are only copied once the whole
+ * pattern matched, so that a long line is not copied once per command that it is compared with
+ */
+struct patternMatch {
+    int numberOfParameters;
+    const char* parameters[MAX_PARAMETER_COUNT];
+    size_t parameterLengths[MAX_PARAMETER_COUNT];
+    uint8_t isPointer;
+    uint8_t pointerSize;
+    bool multiplePointers;
+};
+
+typedef enum { noMatch, matched, matchedOrDraw25 } matchResult;
+
+/**
+ * Checks if the rest of a line starts with "do you know de wey" or a variant stating the size of the memory access, like "do you know de QWORD wey"
+ * @param pointerSize is set to the register type of the stated size, or 0 if no size was stated
+ * @return the length of the suffix, or 0 if the rest of the line does not start with it
+ */
+static size_t matchPointerSuffix(const char* rest, uint8_t* pointerSize) {
+    size_t length = 0;
+    *pointerSize = 0;
+    if(strncmp(rest, pointerSuffix, strlen(pointerSuffix)) == 0) {
+        length = strlen(pointerSuffix);
+    } else if(strncmp(rest, sizedPointerSuffixStart, strlen(sizedPointerSuffixStart)) == 0) {
+        const char* sizeName = rest + strlen(sizedPointerSuffixStart);
+        for(uint8_t size = PARAM_REG64; size <= PARAM_REG8; size <<= 1) {
+            const char* name = getPointerSizeName(size);
+            if(strncmp(sizeName, name, strlen(name)) == 0 && strncmp(sizeName + strlen(name), sizedPointerSuffixEnd, strlen(sizedPointerSuffixEnd)) == 0) {
+                length = strlen(sizedPointerSuffixStart) + strlen(name) + strlen(sizedPointerSuffixEnd);
+                *pointerSize = size;
+                break;
+            }
+        }
+    }
+
+    //The suffix must be followed by the next token or the end of the line
+    if(length == 0 || (rest[length] != ' ' && rest[length] != '\0')) {
+        *pointerSize = 0;
+        return 0;
+    }
+    return length;
+}
+
+/**
+ * Compares the tokens of a line with a command pattern
+ * @param lastParameterIsRest if true and the pattern ends with {p}, this parameter is the rest of the line including its spaces
  */
-void freeAllocatedMemory(struct parsedCommand parsedCommand, int numberOfParameters) {
-    for(int i = 0; i < numberOfParameters; i++) {
-        free(parsedCommand.parameters[i]);
+static matchResult matchPattern(const char* pattern, bool lastParameterIsRest, const struct lineToken* tokens, size_t tokenCount, struct patternMatch* match, struct compileState* compileState) {
+    *match = (struct patternMatch) {0};
+
+    size_t patternLength;
+    const char* patternPosition = pattern;
+    const char* patternToken = nextToken(&patternPosition, " \t", &patternLength);
+    size_t t = 0;
+
+    while(patternToken != NULL && t < tokenCount) {
+        const struct lineToken* lineToken = &tokens[t];
+        printDebugMessage(compileState->logLevel, "\tcomparing with %.*s", 2, (int) patternLength, patternToken);
+
+        const char* parameterStart = strstr(patternToken, "{p}");
+        if(parameterStart != NULL && parameterStart < patternToken + patternLength) {
+            //First check that everything before and after the {p} matches
+            size_t charsBefore = parameterStart - patternToken;
+            size_t charsAfter = patternLength - charsBefore - 3;
+
+            if(lineToken->length < charsBefore + charsAfter || match->numberOfParameters == MAX_PARAMETER_COUNT ||
+                    memcmp(patternToken, lineToken->text, charsBefore) != 0 ||
+                    memcmp(parameterStart + 3, lineToken->text + lineToken->length - charsAfter, charsAfter) != 0) {
+                printDebugMessage(compileState->logLevel, "\t\tMatching failed - chars before or after {p} mismatching, attempting to match next command", 0);
+                return noMatch;
+            }
+            printDebugMessage(compileState->logLevel, "\t\t%.*s contains a parameter", 2, (int) lineToken->length, lineToken->text);
+
+            match->parameters[match->numberOfParameters] = lineToken->text + charsBefore;
+            match->parameterLengths[match->numberOfParameters] = lineToken->length - charsBefore - charsAfter;
+            match->numberOfParameters++;
+
+            //Inline assembly and the values of data are kept verbatim, so the parameter takes all remaining tokens
+            if(lastParameterIsRest && *patternPosition == '\0' && charsAfter == 0) {
+                match->parameterLengths[match->numberOfParameters - 1] = strlen(lineToken->text) - charsBefore;
+                return matched;
+            }
+
+            //If the line after this parameter continues with "do you know de wey", mark it as a pointer
+            uint8_t pointerSize;
+            const size_t suffixLength = matchPointerSuffix(lineToken->rest, &pointerSize);
+            if(suffixLength > 0) {
+                printDebugMessage(compileState->logLevel, "\t\t\t'do you know de wey' was found, interpreting as pointer", 0);
+                match->multiplePointers |= (match->isPointer != 0);
+                match->isPointer = (uint8_t) match->numberOfParameters;
+                match->pointerSize = pointerSize;
+                //Skip the tokens of "do you know de wey"
+                const char* suffixEnd = lineToken->rest + suffixLength;
+                while(t + 1 < tokenCount && tokens[t + 1].text < suffixEnd) {
+                    t++;
+                }
+            }
+        } else if(patternLength != lineToken->length || memcmp(patternToken, lineToken->text, patternLength) != 0) {
+            //If both tokens do not match, try the next command
+            printDebugMessage(compileState->logLevel, "\t\tMatching failed, attempting to match next command", 0);
+            return noMatch;
+        }
+
+        patternToken = nextToken(&patternPosition, " ", &patternLength);
+        t++;
     }
+
+    /*Either the line or the command pattern have reached their end. We now have to check what caused the problem
+     * - if both have ended, then there is no problem!
+     * - if the pattern has ended, then we should have been at the end of the line. Check if the rest is equal to 'or draw 25'. If not, try the next command
+     * - if the line has ended, then the line is too short, try the next command
+     */
+    if(patternToken == NULL && t == tokenCount) {
+        return matched;
+    } else if(t == tokenCount) {
+        printDebugMessage(compileState->logLevel, "\t\tMatching failed, the line ended before the command did. Attempting to match next command", 0);
+        return noMatch;
+    } else if(patternToken == NULL && tokens[t].length == strlen(orDraw25Start) && memcmp(tokens[t].text, orDraw25Start, tokens[t].length) == 0
+                && strcmp(tokens[t].rest, orDraw25End) == 0) {
+        printDebugMessage(compileState->logLevel, "\t\t'or draw 25' was found, replacing opcode", 0);
+        return matchedOrDraw25;
+    }
+    return noMatch;
 }
 
 /**
@@ -162,135 +325,78 @@ void freeAllocatedMemory(struct parsedCommand parsedCommand, int numberOfParamet
  * @return
  */
 struct parsedCommand parseLine(char* inputFileName, size_t lineNum, char* line, struct compileState* compileState) {
-    struct parsedCommand parsedCommand;
+    struct parsedCommand parsedCommand = {0};
     parsedCommand.lineNum = lineNum; //Set the line number
     parsedCommand.translate = 1;
 
-    //Temporarily save the line on the stack to be able to restore when a comparison failed
-    char lineCpy[strlen(line) + 1];
-    strcpy(lineCpy, line);
-
-    //Define save pointers for strtok_r
-    char *savePtrLine;
-    char *savePtrPattern;
+    //The line is split into tokens once and every command pattern is compared with these tokens
+    struct lineToken stackTokens[MAX_STACK_TOKENS];
+    struct lineToken* tokens = stackTokens;
+    size_t tokenCount = tokenizeLine(line, NULL);
+    if(tokenCount > MAX_STACK_TOKENS) {
+        tokens = malloc(tokenCount * sizeof(struct lineToken));
+        CHECK_ALLOC(tokens);
+    }
+    tokenizeLine(line, tokens);
 
     //Iterate through all possible commands
+    struct patternMatch match;
     for(int i = 0; i < NUMBER_OF_COMMANDS - 2; i++) {
-        strcpy(lineCpy, line);
-        savePtrLine = NULL;
-        savePtrPattern = NULL;
-
-        //Copy the current command pattern out of read-only memory
-        char commandString[strlen(commandList[i].pattern) + 1];
-        strcpy(commandString, commandList[i].pattern);
-
-        //Tokenize both strings. Tabs at the beginning are allowed and should be ignored, hence they are a delimiter
-        char *commandToken = strtok_r(commandString, " \t", &savePtrPattern);
-        char *lineToken = strtok_r(lineCpy, " \t", &savePtrLine);
-
-        int numberOfParameters = 0;
-        parsedCommand.isPointer = 0;
-
-        //Enter the comparison loop
-        while (commandToken != NULL && lineToken != NULL) {
-            printDebugMessage(compileState->logLevel, "\tcomparing with %s", 1, commandToken);
-
-            if(strstr(commandToken, "{p}") != NULL) {
-                //First check that everything before and after the {p} matches
-
-                //The difference between the starting address of commandToken and the starting address of {p} is the number of characters before {p}
-                size_t charsBefore = ((size_t) strstr(commandToken, "{p}") - (size_t) commandToken);
-                //The difference between the total string length of commandToken and (charsBefore + 3)
-                size_t charsAfter = (strlen(commandToken) - charsBefore - 3);
-
-                if(strncmp(commandToken, lineToken, charsBefore) == 0 &&
-                                        strncmp(commandToken + charsBefore + 3, lineToken + strlen(lineToken) - charsAfter, charsAfter) == 0) {
-                    printDebugMessage(compileState->logLevel, "\t\t%s contains a parameter", 1, lineToken);
-
-                    size_t parameterLength = strlen(lineToken) - charsBefore - charsAfter;
-
-                    //When allocating space for a function name on MacOS, we need an extra _ -prefix, hence +2
-                    char *variable = malloc(parameterLength + 2);
-                    CHECK_ALLOC(variable);
-
-                    #ifdef MACOS
-                    if (i == 0 || i == 4) {
-                        strcpy(variable, "_");
-                        strncat(variable, lineToken, parameterLength);
-                        variable[parameterLength + 1] = '\0';
-                    } else {
-                    #endif
-                    //On Windows and Linux, only this line is executed
-                    strncpy(variable, lineToken, parameterLength);
-                    variable[parameterLength] = '\0';
-                    #ifdef MACOS
-                    }
-                    #endif
-
-                    parsedCommand.parameters[numberOfParameters++] = variable;
-
-                    //If the line after this parameter contains "do you know de wey", mark it as a pointer
-                    if (savePtrLine != NULL && strlen(savePtrLine) >= strlen(pointerSuffix) &&
-                        strncmp(pointerSuffix, savePtrLine, strlen(pointerSuffix)) == 0) {
-                        printDebugMessage(compileState->logLevel,
-                                          "\t\t\t'do you know de wey' was found, interpreting as pointer", 0);
-                        //If another parameter is already marked as a variable, print an error
-                        //This error is skipped when bully mode is on
-                        if (parsedCommand.isPointer != 0 && compileState->compileMode != bully) {
-                            printError(inputFileName, lineNum, compileState,
-                                       "Only one parameter is allowed to be a pointer", 0);
-                        }
-                        parsedCommand.isPointer = (uint8_t) numberOfParameters;
-                        //Move the save pointer so that "do you know de wey" is not tokenized by strtok_r
-                        savePtrLine += strlen(pointerSuffix);
-                    }
-                } else {
-                    //Characters before and after parameter do not match
-                    printDebugMessage( compileState->logLevel, "\t\tMatching failed - chars before or after {p} mismatching, attempting to match next command", 0);
-                    freeAllocatedMemory(parsedCommand, numberOfParameters);
-                    break;
-                }
-            } else if(strcmp(commandToken, lineToken) != 0) {
-                //If both tokens do not match, try the next command
-                printDebugMessage( compileState->logLevel, "\t\tMatching failed, attempting to match next command", 0);
-                freeAllocatedMemory(parsedCommand, numberOfParameters);
-                break;
-            }
-
-            //Tokenize both strings again. This time, only spaces are allowed
-            commandToken = strtok_r(NULL, " ", &savePtrPattern);
-            lineToken = strtok_r(NULL, " ", &savePtrLine);
-        }
-
-        if(commandToken != NULL && lineToken != NULL) {
+        uint8_t commandType = commandList[i].commandType;
+        bool lastParameterIsRest = commandType == COMMAND_TYPE_INLINE_ASM_START || commandType == COMMAND_TYPE_INLINE_ASM || commandType == COMMAND_TYPE_DATA;
+        matchResult result = matchPattern(commandList[i].pattern, lastParameterIsRest, tokens, tokenCount, &match, compileState);
+        if(result == noMatch) {
             continue;
         }
+        if(tokens != stackTokens) {
+            free(tokens);
+        }
+        countParsedLine(compileState, i + 1, true);
 
-        /*Either the line or the command pattern have reached their end. We now have to check what caused the problem
-         * - if both are NULL, then there is no problem!
-         * - if the commandToken is NULL, then we should have been at the end of the line. Check if the rest is equal to 'or draw 25'. If not, try the next command
-         * - if the token is NULL, then the line is too short, try the next command
-         */
-        if(commandToken == NULL && lineToken == NULL) {
-            parsedCommand.opcode = (uint8_t) i;
-            return parsedCommand;
-        } else if(lineToken == NULL) {
-            printDebugMessage(compileState->logLevel, "\t\tMatching failed, lineToken is NULL while commandToken is not. Attempting to match next command", 0);
-            freeAllocatedMemory(parsedCommand, numberOfParameters);
-            continue;
-            //If the current token is 'or' and the rest of the string is only 'draw 25', then set the opcode as "or draw 25" and return
-        } else if(strcmp(lineToken, orDraw25Start) == 0 && strlen(savePtrLine) == strlen(orDraw25End) && strncmp(orDraw25End, savePtrLine, strlen(orDraw25End)) == 0) {
-            printDebugMessage(compileState->logLevel, "\t\t'or draw 25' was found, replacing opcode", 0);
-            //Before we replace the opcode though, we need to free memory that was allocated for parameters
-            for(int j = 0; j < commandList[i].usedParameters; j++) {
-                free(parsedCommand.parameters[j]);
-            }
-            //Now we can change the opcode and return the struct
+        //If the line ended with "or draw 25", the parameters are not needed
+        if(result == matchedOrDraw25) {
             parsedCommand.opcode = OR_DRAW_25_OPCODE;
             return parsedCommand;
         }
+
+        parsedCommand.opcode = (uint8_t) i;
+        for(int j = 0; j < match.numberOfParameters; j++) {
+            size_t parameterLength = match.parameterLengths[j];
+            //When allocating space for a function name on MacOS, we need an extra _ -prefix, hence +2
+            char *variable = malloc(parameterLength + 2);
+            CHECK_ALLOC(variable);
+            countParameter(compileState, parameterLength + 2);
+
+            #ifdef MACOS
+            if (i == 0 || i == 4) {
+                variable[0] = '_';
+                memcpy(variable + 1, match.parameters[j], parameterLength);
+                variable[parameterLength + 1] = '\0';
+            } else {
+            #endif
+            //On Windows and Linux, only this line is executed
+            memcpy(variable, match.parameters[j], parameterLength);
+            variable[parameterLength] = '\0';
+            #ifdef MACOS
+            }
+            #endif
+            parsedCommand.parameters[j] = variable;
+        }
+
+        //If more than one parameter is marked as a pointer, print an error
+        //This error is skipped when bully mode is on
+        if(match.multiplePointers && compileState->compileMode != bully) {
+            printError(inputFileName, lineNum, compileState, "Only one parameter is allowed to be a pointer", 0);
+        }
+        parsedCommand.isPointer = match.isPointer;
+        parsedCommand.pointerSize = match.pointerSize;
+        return parsedCommand;
+    }
+    if(tokens != stackTokens) {
+        free(tokens);
     }
 
+    countParsedLine(compileState, NUMBER_OF_COMMANDS - 2, false);
     if(compileState->compileMode == bully) {
         /*
          * In bully mode, we replace this non-working command with a valid one
@@ -298,26 +404,34 @@ struct parsedCommand parseLine(char* inputFileName, size_t lineNum, char* line,
          * so we take the sum of ascii characters in this line, and use this value
          * to create the random command
          *
-         * The variable "computedIndex" is global, meaning that the value
+         * The variable "computedIndex" is part of the compile state, meaning that the value
          * is dependent on the previous illegal commands - *perfection*
          */
         const char* randomParams[] = {"rax", "rcx", "rbx", "r8", "r9", "r10", "r12", "rsp", "rbp", "ax", "al", "r8b", "r9d", "r14b", "99", "1238", "12", "420", "987654321", "8", "9", "69", "8268", "2", "_", "a", "b", "d", "f", "F", "sigreturn", "uaauuaa", "uau", "uu", "main", "gets", "srand", "mprotect", "au", "uwu", "space"};
         unsigned randomParamCount = sizeof randomParams / sizeof(char*);
 
-        for(size_t i = 0; i < strlen(line); i++) {
-            computedIndex += line[i];
+        for(size_t i = 0; line[i] != '\0'; i++) {
+            compileState->computedIndex += line[i];
         }
-        computedIndex = ((computedIndex * lineNum) % 420) * inputFileName[0];
+        compileState->computedIndex = ((compileState->computedIndex * lineNum) % 420) * inputFileName[0];
 
-        parsedCommand.opcode = computedIndex % (NUMBER_OF_COMMANDS - 1);
+        //Only the commands up to "it's a trap" and "or draw 25" are chosen from, so that adding commands does not change what a source file turns into
+        parsedCommand.opcode = compileState->computedIndex % NUMBER_OF_BULLY_COMMANDS;
+        if(parsedCommand.opcode == NUMBER_OF_BULLY_COMMANDS - 1) {
+            parsedCommand.opcode = OR_DRAW_25_OPCODE;
+        }
         if(commandList[parsedCommand.opcode].usedParameters > 0) {
-            parsedCommand.parameters[0] = strdup(randomParams[computedIndex % randomParamCount]);
+            parsedCommand.parameters[0] = strdup(randomParams[compileState->computedIndex % randomParamCount]);
             CHECK_ALLOC(parsedCommand.parameters[0]);
+            countParameter(compileState, strlen(parsedCommand.parameters[0]) + 1);
         }
         if (commandList[parsedCommand.opcode].usedParameters > 1) {
-            parsedCommand.parameters[1] = strdup(randomParams[(computedIndex * inputFileName[0]) % randomParamCount]);
+            parsedCommand.parameters[1] = strdup(randomParams[(compileState->computedIndex * inputFileName[0]) % randomParamCount]);
             CHECK_ALLOC(parsedCommand.parameters[1]);
+            countParameter(compileState, strlen(parsedCommand.parameters[1]) + 1);
         }
+        emitRemark(compileState, remarkPassed, "bully", "CommandReplaced", inputFileName, lineNum, "invalid command \"%s\" replaced by \"%s\"",
+                   line, commandList[parsedCommand.opcode].pattern);
     } else {
         parsedCommand.opcode = INVALID_COMMAND_OPCODE;
         printError(inputFileName, lineNum, compileState, "Invalid command: \"%s\"", 1, line);
@@ -356,11 +470,16 @@ void parseCommands(FILE *inputFile, char* inputFileName, struct compileState* co
     printDebugMessage( compileState->logLevel, "Struct array was created successfully", 0);
 
     //Iterate through the file again, this time parsing each line of interest and adding it to our command struct array
-    int i = 0; //The number of structs in the array
-    int lineNumber = 1; //The line number we are currently on. We differentiate between number of commands and number of lines to print the correct line number in case of an error
+    size_t i = 0; //The number of structs in the array
+    size_t lineNumber = 1; //The line number we are currently on. We differentiate between number of commands and number of lines to print the correct line number in case of an error
 
     //Parse the file line by line
     while((lineLength = getLine(&line, &len, inputFile)) != -1) {
+        //Line numbers are stored in 32 bits
+        if(lineNumber > MAX_LINE_NUMBER) {
+            printError(inputFileName, 0, compileState, "files with more than %u lines are not supported", 1, MAX_LINE_NUMBER);
+            break;
+        }
         //Check if the line contains actual code or if it's empty/contains comments
         if(isLineOfInterest(line, lineLength) == 1) {
             //Remove \n from the end of the line
@@ -368,13 +487,16 @@ void parseCommands(FILE *inputFile, char* inputFileName, struct compileState* co
             printDebugMessage( compileState->logLevel, "Parsing line: %s", 1, line);
             //Parse the command and add the returned struct into the array
             *(commands + i) = parseLine(inputFileName, lineNumber, line, compileState);
+            countCommand(compileState, commands[i].opcode);
             //Increase our number of structs in the array
             i++;
+        } else {
+            countSkippedLine(compileState, line);
         }
         lineNumber++;
     }
 
-    commandsArray->size = loc;
+    commandsArray->size = i; //Only differs from loc if the file was too long
     commandsArray->arrayPointer = commands;
 
     free(line);
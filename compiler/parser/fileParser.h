@@ -31,4 +31,11 @@ struct commandsArray {
  * Parses an input file line by line and fills a provided struct commandsArray
  */
 void parseCommands(FILE *inputFile, char* inputFileName, struct compileState* compileState, struct commandsArray* commandsArray);
+
+//Lines are independent of each other, so the language server and streaming mode parse single lines using these functions
+ssize_t getLine(char **restrict lineptr, size_t *restrict n, FILE *restrict stream);
+int isLineOfInterest(const char* line, ssize_t lineLength);
+void removeLineBreaksAndTabs(char* line);
+const char* nextToken(const char** position, const char* delimiters, size_t* length);
+struct parsedCommand parseLine(char* inputFileName, size_t lineNum, char* line, struct compileState* compileState);
 #endif
@@ -20,12 +20,48 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <string.h>
 #include "functionParser.h"
 #include "../logger/log.h"
+#include "../report/remarks.h"
 
 extern const struct command commandList[];
-char *functionNames[] = {"mprotect", "kill", "signal", "raise", "dump", "atoi",
-                         "generateExcellence", "isExcellent", "memeify", "uwufy", "test",
-                         "helloWorld", "snake_case_sucks", "gets", "uwu", "skillIssue"};
-unsigned numFunctionNames = sizeof(functionNames) / sizeof (char*);
+const char* const functionNames[] = {"mprotect", "kill", "signal", "raise", "dump", "atoi",
+                                      "generateExcellence", "isExcellent", "memeify", "uwufy", "test",
+                                      "helloWorld", "snake_case_sucks", "gets", "uwu", "skillIssue"};
+const unsigned numFunctionNames = sizeof(functionNames) / sizeof (char*);
+
+/**
+ * Checks the commands of a function body: assembly lines are only used inside of inline assembly blocks, every block of a
+ * function is closed before it returns for the last time and no data is declared inside of the function
+ * @param commands the commands of the function, starting with its definition
+ */
+void checkFunctionBody(const struct parsedCommand* commands, size_t numberOfCommands, char* inputFileName, struct compileState* compileState) {
+    if(compileState->compileMode == bully) {
+        return;
+    }
+
+    const struct parsedCommand* blockStart = NULL;
+    for(size_t i = 0; i < numberOfCommands; i++) {
+        uint8_t commandType = commandList[commands[i].opcode].commandType;
+        if(commandType == COMMAND_TYPE_INLINE_ASM_START) {
+            if(blockStart != NULL) {
+                printError(inputFileName, commands[i].lineNum, compileState, "inline assembly blocks cannot be nested, the block of line %u was not ended yet", 1, blockStart->lineNum);
+            }
+            blockStart = &commands[i];
+        } else if(commandType == COMMAND_TYPE_INLINE_ASM_END) {
+            if(blockStart == NULL) {
+                printError(inputFileName, commands[i].lineNum, compileState, "there is no inline assembly block to end", 0);
+            }
+            blockStart = NULL;
+        } else if(commandType == COMMAND_TYPE_INLINE_ASM && blockStart == NULL) {
+            printError(inputFileName, commands[i].lineNum, compileState, "assembly code can only be used inside of an inline assembly block", 0);
+        } else if(commandType == COMMAND_TYPE_DATA) {
+            printError(inputFileName, commands[i].lineNum, compileState, "data can only be declared outside of functions", 0);
+        }
+    }
+
+    if(blockStart != NULL) {
+        printError(inputFileName, blockStart->lineNum, compileState, "inline assembly block is not ended before the function returns", 0);
+    }
+}
 
 /**
  * Creates a function struct by starting at the function definition and then traversing the
@@ -36,23 +72,23 @@ unsigned numFunctionNames = sizeof(functionNames) / sizeof (char*);
  * @return a function struct containing all parsed information
  */
 struct function parseFunction(struct commandsArray commandsArray, char* inputFileName, size_t functionStartAtIndex, struct compileState* compileState) {
-    struct parsedCommand functionStart = *(commandsArray.arrayPointer + functionStartAtIndex);
+    const struct parsedCommand* functionStart = &commandsArray.arrayPointer[functionStartAtIndex];
 
     //Define the structs
     struct function function;
-    function.definedInLine = (size_t) functionStart.lineNum;
+    function.definedInLine = (size_t) functionStart->lineNum;
     function.definedInFile = inputFileName;
 
-    printDebugMessage(compileState->logLevel, "\tParsing function:", 1, functionStart.parameters[0]);
+    printDebugMessage(compileState->logLevel, "\tParsing function:", 1, functionStart->parameters[0]);
 
     size_t index = 1;
     size_t functionEndIndex = 0; //This points to the last found return-statement and is 0 if no return statement was found until now
 
     //Iterate through all commands until a return statement is found or the end of the array is reached
     while (functionStartAtIndex + index < commandsArray.size) {
-        struct parsedCommand parsedCommand = *(commandsArray.arrayPointer + (functionStartAtIndex + index));
+        const struct parsedCommand* parsedCommand = &commandsArray.arrayPointer[functionStartAtIndex + index];
         //Get the opcode
-        uint8_t opcode = parsedCommand.opcode;
+        uint8_t opcode = parsedCommand->opcode;
 
         //Is this a new function definition
         if(commandList[opcode].commandType == COMMAND_TYPE_FUNC_DEF) {
@@ -61,7 +97,7 @@ struct function parseFunction(struct commandsArray commandsArray, char* inputFil
             if(functionEndIndex != functionStartAtIndex + index - 1) {
                 if(compileState->compileMode != bully) {
                     //Throw an error since the last statement was not a return
-                    printError(inputFileName, parsedCommand.lineNum, compileState,
+                    printError(inputFileName, parsedCommand->lineNum, compileState,
                                "expected a return statement, but got a new function definition", 0);
                 }
             }
@@ -74,11 +110,12 @@ struct function parseFunction(struct commandsArray commandsArray, char* inputFil
     printDebugMessage(compileState->logLevel, "\t\tIteration stopped at index %lu", 1, index);
 
     if(functionEndIndex == 0 && compileState->compileMode != bully) {
-        printError(inputFileName, functionStart.lineNum, compileState, "function does not return", 0);
+        printError(inputFileName, functionStart->lineNum, compileState, "function does not return", 0);
     }
 
     //Our function definition is also a command, hence there are functionEndIndex - functionStartAtIndex + 1 commands
     function.numberOfCommands = (functionEndIndex != 0) ? (functionEndIndex - functionStartAtIndex) + 1 : 1;
+    checkFunctionBody(functionStart, function.numberOfCommands, inputFileName, compileState);
     return function;
 }
 
@@ -102,6 +139,7 @@ void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray,
     while (commandArrayIndex < commandsArray.size) {
         /*
          * Here, we have not found another function definition yet. Traverse over all commands.
+         * - Data declarations do not belong to a function, they are skipped
          * - If they are not function definitions, we need to check if bully mode is on
          *    - if not, just throw a compiler error for each command that does not belong to a function
          *    - if so, those "orphaned" commands are added to newly created functions, with a random function name
@@ -110,7 +148,10 @@ void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray,
         size_t startIndex = commandArrayIndex;
         bool orphanedCommands = false;
         for (; commandArrayIndex < commandsArray.size; commandArrayIndex++) {
-            if (commandList[commandsArray.arrayPointer[commandArrayIndex].opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
+            uint8_t commandType = commandList[commandsArray.arrayPointer[commandArrayIndex].opcode].commandType;
+            if (commandType == COMMAND_TYPE_DATA) {
+                continue;
+            } else if (commandType != COMMAND_TYPE_FUNC_DEF) {
                 orphanedCommands = true;
                 if(compileState->compileMode != bully) {
                     printError(fileStruct->fileName, commandsArray.arrayPointer[commandArrayIndex].lineNum,
@@ -124,7 +165,8 @@ void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray,
         //If we're in bully mode and there were orphaned commands, then they range from startIndex to commandArrayIndex - 1
         //Inject a fake function with those commands
         if(compileState->compileMode == bully && orphanedCommands) {
-            char* funcName = functionNames[commandArrayIndex % (sizeof(functionNames) / sizeof(char*))];
+            char* funcName = strdup(functionNames[commandArrayIndex % numFunctionNames]);
+            CHECK_ALLOC(funcName);
 
             //We create two extra commands (function definition and return)
             size_t numCommands = commandArrayIndex - startIndex + 2;
@@ -133,8 +175,8 @@ void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray,
             //We cannot use reallocarray(), since it does not exist on MacOS/Windows :(
             size_t functionsArraySize = 0;
             if (__builtin_umull_overflow(++functionDefinitions, sizeof(struct function), &functionsArraySize)) {
-                fprintf(stderr, "Critical error: Memory allocation for command parameter failed!");
-                exit(EXIT_FAILURE);
+                printInternalCompilerError("Too many functions to allocate the function array", false, 0);
+                abortCompilation(abortInternalError);
             }
             functions = realloc(functions, functionsArraySize);
             CHECK_ALLOC(functions);
@@ -157,6 +199,9 @@ void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray,
             commands[numCommands - 1].translate = true;
 
 
+            emitRemark(compileState, remarkPassed, "bully", "FunctionInserted", fileStruct->fileName, commandsArray.arrayPointer[startIndex].lineNum,
+                       "%lu command(s) outside of a function were moved into the new function \"%s\"", numCommands - 2, funcName);
+
             //Set the function-struct accordingly
             functions[functionArrayIndex].definedInFile = fileStruct->fileName;
             functions[functionArrayIndex].numberOfCommands = numCommands;
@@ -23,6 +23,11 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include "parser.h"
 #include "fileParser.h"
 
+//Names used for functions generated in bully mode
+extern const char* const functionNames[];
+extern const unsigned numFunctionNames;
+
 void parseFunctions(struct file* fileStruct, struct commandsArray commandsArray, struct compileState* compileState);
+void checkFunctionBody(const struct parsedCommand* commands, size_t numberOfCommands, char* inputFileName, struct compileState* compileState);
 
 #endif
@@ -19,8 +19,11 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 
 #include "parser.h"
 #include "functionParser.h"
+#include "../ir/ir.h"
 #include <stdio.h>
 
+extern const struct command commandList[];
+
 void parseFile(struct file* fileStruct, FILE* inputFile, struct compileState* compileState) {
     struct commandsArray commandsArray;
     parseCommands(inputFile, fileStruct->fileName, compileState, &commandsArray);
@@ -29,3 +32,49 @@ void parseFile(struct file* fileStruct, FILE* inputFile, struct compileState* co
     fileStruct->loc = commandsArray.size;
     fileStruct->parsedCommands = commandsArray.arrayPointer;
 }
+
+/**
+ * Frees all memory that was allocated while parsing (and analysing) a file
+ * @param fileStruct the file struct. The struct itself is not freed
+ * @param compileMode the compile mode the file was parsed with
+ */
+void freeFile(struct file* fileStruct, compileMode compileMode) {
+    if(fileStruct->irMapping != NULL) {
+        releaseIRMapping(fileStruct->irMapping);
+        fileStruct->irMapping = NULL;
+        fileStruct->functions = NULL;
+        fileStruct->parsedCommands = NULL;
+        fileStruct->functionCount = 0;
+        fileStruct->loc = 0;
+        return;
+    }
+
+    if(compileMode == bully) {
+        //In bully mode, every command belongs to exactly one function. Orphaned commands were copied into
+        //newly created functions, which own their own command array
+        for(size_t i = 0; i < fileStruct->functionCount; i++) {
+            struct function* function = &fileStruct->functions[i];
+            for(size_t j = 0; j < function->numberOfCommands; j++) {
+                for(unsigned k = 0; k < commandList[function->commands[j].opcode].usedParameters; k++) {
+                    free(function->commands[j].parameters[k]);
+                }
+            }
+            if(function->commands < fileStruct->parsedCommands || function->commands >= fileStruct->parsedCommands + fileStruct->loc) {
+                free(function->commands);
+            }
+        }
+    } else {
+        for(size_t i = 0; i < fileStruct->loc; i++) {
+            for(unsigned k = 0; k < commandList[fileStruct->parsedCommands[i].opcode].usedParameters; k++) {
+                free(fileStruct->parsedCommands[i].parameters[k]);
+            }
+        }
+    }
+
+    free(fileStruct->functions);
+    free(fileStruct->parsedCommands);
+    fileStruct->functions = NULL;
+    fileStruct->parsedCommands = NULL;
+    fileStruct->functionCount = 0;
+    fileStruct->loc = 0;
+}
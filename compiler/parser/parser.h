@@ -26,5 +26,6 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #define MEMEASSEMBLY_PARSER_H
 
 void parseFile(struct file* fileStruct, FILE* inputFile, struct compileState* compileState);
+void freeFile(struct file* fileStruct, compileMode compileMode);
 
 #endif
@@ -0,0 +1,253 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Optimisation remarks report every transformation the compiler applies to a program, e.g. lines deleted by "perfectly
+ * balanced as all things should be" or commands replaced in bully mode. Each remark belongs to a pass and is tied to a
+ * line of the input. Remarks of passes matching the regular expression of -Rpass (or -Rpass-missed for transformations
+ * that could not be done) are printed like errors. With -fsave-optimization-record, all remarks are additionally
+ * written to a YAML or JSON file for other tools.
+ */
+
+#include "remarks.h"
+#include "../logger/log.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifndef WINDOWS
+#include <regex.h>
+#endif
+
+struct remarkFilter {
+    #ifndef WINDOWS
+    regex_t regex;
+    #else
+    char* pattern; //Windows has no regex.h, so the pass name only needs to contain the pattern
+    #endif
+};
+
+const char* const remarkOptions[] = {"-Rpass", "-Rpass-missed"};
+const char* const remarkTags[] = {"Passed", "Missed"};
+
+/**
+ * Sets the regular expression (POSIX extended syntax) that selects which remarks of the given kind are printed
+ * @return false if the regular expression is invalid
+ */
+bool setRemarkFilter(struct compileState* compileState, remarkKind kind, const char* pattern) {
+    struct remarkFilter* filter = malloc(sizeof(struct remarkFilter));
+    CHECK_ALLOC(filter);
+    #ifndef WINDOWS
+    if(regcomp(&filter->regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+        free(filter);
+        return false;
+    }
+    #else
+    filter->pattern = strdup(pattern);
+    CHECK_ALLOC(filter->pattern);
+    #endif
+
+    compileState->remarks.filters[kind] = filter;
+    compileState->remarks.enabled = true;
+    return true;
+}
+
+/**
+ * Makes all remarks be collected and written to the given file after compilation
+ */
+void setRemarkRecord(struct compileState* compileState, remarkRecordFormat format, const char* fileName) {
+    compileState->remarks.recordFileName = strdup(fileName);
+    CHECK_ALLOC(compileState->remarks.recordFileName);
+    compileState->remarks.recordFormat = format;
+    compileState->remarks.enabled = true;
+}
+
+static bool passMatches(struct remarkFilter* filter, const char* pass) {
+    if(filter == NULL) {
+        return false;
+    }
+    #ifndef WINDOWS
+    return regexec(&filter->regex, pass, 0, NULL, 0) == 0;
+    #else
+    return strstr(pass, filter->pattern) != NULL;
+    #endif
+}
+
+/**
+ * Reports a transformation of the program. It can be called with a variable number of arguments that will be inserted in the respective places in the format string
+ * @param kind remarkPassed if the transformation was applied, remarkMissed if it could not be applied (completely)
+ * @param pass the name of the pass, which is matched against the regular expression of -Rpass or -Rpass-missed
+ * @param name a fixed identifier of the transformation within the pass, for tools reading the record
+ * @param fileName the file the remark refers to
+ * @param lineNum the line the remark refers to, 0 if it refers to the whole file
+ * @param message the message (with printf-like formatting)
+ */
+void emitRemark(struct compileState* compileState, remarkKind kind, const char* pass, const char* name, char* fileName, size_t lineNum, const char* message, ...) {
+    struct remarks* remarks = &compileState->remarks;
+    if(!remarks->enabled) {
+        return;
+    }
+    bool print = passMatches(remarks->filters[kind], pass);
+    if(!print && remarks->recordFormat == recordNone) {
+        return;
+    }
+
+    va_list vaList;
+    va_start(vaList, message);
+    int length = vsnprintf(NULL, 0, message, vaList);
+    va_end(vaList);
+    char* formattedMessage = malloc(length + 1);
+    CHECK_ALLOC(formattedMessage);
+    va_start(vaList, message);
+    vsnprintf(formattedMessage, length + 1, message, vaList);
+    va_end(vaList);
+
+    if(print) {
+        printf("%s:%lu: " CYN "remark: " RESET "%s [%s=%s]\n", fileName, lineNum, formattedMessage, remarkOptions[kind], pass);
+    }
+
+    if(remarks->recordFormat == recordNone) {
+        free(formattedMessage);
+        return;
+    }
+    if(remarks->recordCount == remarks->recordCapacity) {
+        size_t newCapacity = (remarks->recordCapacity == 0) ? 64 : remarks->recordCapacity * 2;
+        struct remark* records = realloc(remarks->records, newCapacity * sizeof(struct remark));
+        CHECK_ALLOC(records);
+        remarks->records = records;
+        remarks->recordCapacity = newCapacity;
+    }
+    remarks->records[remarks->recordCount++] = (struct remark) {
+        .kind = kind,
+        .pass = pass,
+        .name = name,
+        .fileName = fileName,
+        .lineNum = lineNum,
+        .message = formattedMessage
+    };
+}
+
+/**
+ * Writes a string as a single-quoted YAML scalar, in which only single quotes need to be escaped (by doubling them)
+ */
+static void writeYAMLString(FILE* output, const char* string) {
+    fputc('\'', output);
+    for(; *string != '\0'; string++) {
+        if(*string == '\'') {
+            fputc('\'', output);
+        }
+        fputc(*string, output);
+    }
+    fputc('\'', output);
+}
+
+static void writeJSONString(FILE* output, const char* string) {
+    fputc('"', output);
+    for(const unsigned char* c = (const unsigned char*) string; *c != '\0'; c++) {
+        if(*c == '"' || *c == '\\') {
+            fprintf(output, "\\%c", *c);
+        } else if(*c < 0x20) {
+            fprintf(output, "\\u%04x", *c);
+        } else {
+            fputc(*c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+/**
+ * Writes the record in the format of LLVM's optimisation records, i.e. one YAML document per remark
+ */
+static void writeYAMLRecord(struct remarks* remarks, FILE* output) {
+    for(size_t i = 0; i < remarks->recordCount; i++) {
+        struct remark* remark = &remarks->records[i];
+        fprintf(output, "--- !%s\nPass: %s\nName: %s\nDebugLoc: { File: ", remarkTags[remark->kind], remark->pass, remark->name);
+        writeYAMLString(output, remark->fileName);
+        fprintf(output, ", Line: %lu }\nMessage: ", remark->lineNum);
+        writeYAMLString(output, remark->message);
+        fprintf(output, "\n...\n");
+    }
+}
+
+/**
+ * Writes the record as a JSON array with one object per remark
+ */
+static void writeJSONRecord(struct remarks* remarks, FILE* output) {
+    fprintf(output, "[");
+    for(size_t i = 0; i < remarks->recordCount; i++) {
+        struct remark* remark = &remarks->records[i];
+        fprintf(output, "%s\n{\"kind\":\"%s\",\"pass\":\"%s\",\"name\":\"%s\",\"file\":", (i == 0) ? "" : ",",
+                (remark->kind == remarkPassed) ? "passed" : "missed", remark->pass, remark->name);
+        writeJSONString(output, remark->fileName);
+        fprintf(output, ",\"line\":%lu,\"message\":", remark->lineNum);
+        writeJSONString(output, remark->message);
+        fprintf(output, "}");
+    }
+    fprintf(output, "\n]\n");
+}
+
+/**
+ * Writes the record file if requested and frees all remarks and filters. Called once compilation is done, also if it failed
+ * @return false if the record file could not be written
+ */
+bool finishRemarks(struct compileState* compileState) {
+    struct remarks* remarks = &compileState->remarks;
+    bool success = true;
+    if(remarks->recordFormat != recordNone) {
+        FILE* output = fopen(remarks->recordFileName, "w");
+        if(output == NULL) {
+            perror("Failed to open optimisation record file");
+            success = false;
+        } else {
+            if(remarks->recordFormat == recordYAML) {
+                writeYAMLRecord(remarks, output);
+            } else {
+                writeJSONRecord(remarks, output);
+            }
+            success = fclose(output) == 0;
+        }
+    }
+
+    freeRemarks(compileState);
+    return success;
+}
+
+/**
+ * Frees all remarks and filters without writing the record file
+ */
+void freeRemarks(struct compileState* compileState) {
+    struct remarks* remarks = &compileState->remarks;
+    for(size_t i = 0; i < remarks->recordCount; i++) {
+        free(remarks->records[i].message);
+    }
+    for(unsigned kind = remarkPassed; kind <= remarkMissed; kind++) {
+        if(remarks->filters[kind] != NULL) {
+            #ifndef WINDOWS
+            regfree(&remarks->filters[kind]->regex);
+            #else
+            free(remarks->filters[kind]->pattern);
+            #endif
+            free(remarks->filters[kind]);
+        }
+    }
+    free(remarks->records);
+    free(remarks->recordFileName);
+    *remarks = (struct remarks) {0};
+}
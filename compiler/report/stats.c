@@ -0,0 +1,305 @@
+
+/*
+ * --stats counts what the compiler does: how many lines were read and skipped, how many command patterns parseLine()
+ * compared against each line, how often every command was used, how many parameter strings were allocated, the largest
+ * heap usage seen at the end of a phase and how many bytes of assembly code were written into each section.
+ * Like -ftime-report, the result is printed as a single line of JSON
+ */
+
+#ifdef LINUX
+#define _GNU_SOURCE //fopencookie()
+#endif
+
+#include "stats.h"
+#include "../logger/log.h"
+
+#include <string.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAS_MALLINFO2
+#elif defined(MACOS)
+#include <malloc/malloc.h>
+#endif
+
+extern struct command commandList[NUMBER_OF_COMMANDS];
+
+/**
+ * Counts a line that was skipped by the parser, i.e. an empty line or a comment
+ */
+void countSkippedLine(struct compileState* compileState, const char* line) {
+    if(!compileState->stats.enabled) {
+        return;
+    }
+    while(*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if(*line == '\0' || *line == '\n' || *line == '\r') {
+        compileState->stats.blankLines++;
+    } else {
+        compileState->stats.commentLines++;
+    }
+}
+
+/**
+ * Counts a line that was passed to parseLine()
+ * @param matchAttempts how many command patterns were compared against the line
+ * @param matched whether a command was found
+ */
+void countParsedLine(struct compileState* compileState, unsigned matchAttempts, bool matched) {
+    struct compileStats* stats = &compileState->stats;
+    if(!stats->enabled) {
+        return;
+    }
+    stats->parsedLines++;
+    stats->matchAttempts += matchAttempts;
+    if(matchAttempts > stats->maxMatchAttempts) {
+        stats->maxMatchAttempts = matchAttempts;
+    }
+    if(!matched) {
+        stats->unmatchedLines++;
+    }
+}
+
+void countCommand(struct compileState* compileState, uint8_t opcode) {
+    if(compileState->stats.enabled && opcode < NUMBER_OF_COMMANDS) {
+        compileState->stats.commandsPerOpcode[opcode]++;
+    }
+}
+
+/**
+ * Counts an allocated parameter string
+ * @param bytes the size of the allocation
+ */
+void countParameter(struct compileState* compileState, size_t bytes) {
+    if(compileState->stats.enabled) {
+        compileState->stats.parametersAllocated++;
+        compileState->stats.parameterBytes += bytes;
+    }
+}
+
+/**
+ * Updates the largest sampled heap usage. Only the current usage can be queried, so this is called at the end of every phase and
+ * before the analysis frees its command lists. The true peak inside a phase can be higher, which is why the value is reported as "sampledHeapBytes"
+ */
+void sampleHeapUsage(struct compileState* compileState) {
+    if(!compileState->stats.enabled) {
+        return;
+    }
+    size_t heapBytes = 0;
+    #if defined(HAS_MALLINFO2)
+    struct mallinfo2 info = mallinfo2();
+    heapBytes = info.uordblks + info.hblkhd;
+    #elif defined(MACOS)
+    heapBytes = mstats().bytes_used;
+    #endif
+    if(heapBytes > compileState->stats.sampledHeapBytes) {
+        compileState->stats.sampledHeapBytes = heapBytes;
+    }
+}
+
+#if defined(LINUX) || defined(MACOS)
+/*
+ * The output is counted by a stream that forwards everything to the real output. Every line is attributed to the section
+ * it is written into. Stabs directives and the labels only emitted for them are counted separately
+ */
+struct outputCounter {
+    struct compileStats* stats;
+    FILE* output;
+    unsigned currentSection;
+    size_t lineBytes;
+    bool leadingWhitespace;
+    char lineStart[32]; //The line without leading whitespace, truncated
+    size_t lineStartLength;
+};
+
+static unsigned findSection(struct compileStats* stats, const char* name, size_t nameLength) {
+    for(unsigned i = 0; i < stats->sectionCount; i++) {
+        if(strlen(stats->sectionNames[i]) == nameLength && strncmp(stats->sectionNames[i], name, nameLength) == 0) {
+            return i;
+        }
+    }
+    if(stats->sectionCount == MAX_STATS_SECTIONS) {
+        return MAX_STATS_SECTIONS - 1;
+    }
+    if(nameLength >= sizeof(stats->sectionNames[0])) {
+        nameLength = sizeof(stats->sectionNames[0]) - 1;
+    }
+    memcpy(stats->sectionNames[stats->sectionCount], name, nameLength);
+    stats->sectionNames[stats->sectionCount][nameLength] = '\0';
+    return stats->sectionCount++;
+}
+
+static bool startsWithDirective(const char* line, const char* directive) {
+    size_t length = strlen(directive);
+    return strncmp(line, directive, length) == 0 && (line[length] == '\0' || line[length] == ' ' || line[length] == '\t');
+}
+
+static void countLine(struct outputCounter* counter) {
+    struct compileStats* stats = counter->stats;
+    char* line = counter->lineStart;
+    line[counter->lineStartLength] = '\0';
+
+    if(strncmp(line, ".stab", 5) == 0 || strncmp(line, ".Lcmd_", 6) == 0 || strncmp(line, ".Lret_", 6) == 0) {
+        stats->stabsBytes += counter->lineBytes;
+    } else {
+        if(startsWithDirective(line, ".data") || startsWithDirective(line, ".text") || startsWithDirective(line, ".bss")) {
+            counter->currentSection = findSection(stats, line, strcspn(line, " \t"));
+        } else if(startsWithDirective(line, ".section")) {
+            char* name = line + strlen(".section");
+            name += strspn(name, " \t");
+            counter->currentSection = findSection(stats, name, strcspn(name, " \t,"));
+        }
+        stats->sectionBytes[counter->currentSection] += counter->lineBytes;
+    }
+
+    counter->lineBytes = 0;
+    counter->lineStartLength = 0;
+    counter->leadingWhitespace = true;
+}
+
+static void countBytes(struct outputCounter* counter, const char* buffer, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        counter->lineBytes++;
+        if(buffer[i] == '\n') {
+            countLine(counter);
+        } else if(counter->leadingWhitespace && (buffer[i] == ' ' || buffer[i] == '\t')) {
+            continue;
+        } else {
+            counter->leadingWhitespace = false;
+            if(counter->lineStartLength < sizeof(counter->lineStart) - 1) {
+                counter->lineStart[counter->lineStartLength++] = buffer[i];
+            }
+        }
+    }
+}
+
+static int closeCounter(void* cookie) {
+    struct outputCounter* counter = cookie;
+    if(counter->lineBytes > 0) {
+        countLine(counter);
+    }
+    free(counter);
+    return 0;
+}
+
+#ifdef LINUX
+static ssize_t writeCounted(void* cookie, const char* buffer, size_t size) {
+    struct outputCounter* counter = cookie;
+    size_t written = fwrite(buffer, 1, size, counter->output);
+    countBytes(counter, buffer, written);
+    return (written == 0 && size > 0) ? -1 : (ssize_t) written;
+}
+#else
+static int writeCounted(void* cookie, const char* buffer, int size) {
+    struct outputCounter* counter = cookie;
+    size_t written = fwrite(buffer, 1, size, counter->output);
+    countBytes(counter, buffer, written);
+    return (written == 0 && size > 0) ? -1 : (int) written;
+}
+#endif
+#endif
+
+/**
+ * If --stats is enabled, returns a stream that counts the bytes written per section and forwards them to the output.
+ * Otherwise (or if the platform does not support custom streams), the output itself is returned
+ * @return the stream the translation should be written to. It must be closed using stopCountingOutput()
+ */
+FILE* startCountingOutput(struct compileState* compileState, FILE* output) {
+    if(!compileState->stats.enabled) {
+        return output;
+    }
+    #if defined(LINUX) || defined(MACOS)
+    struct outputCounter* counter = calloc(1, sizeof(struct outputCounter));
+    CHECK_ALLOC(counter);
+    counter->stats = &compileState->stats;
+    counter->output = output;
+    counter->leadingWhitespace = true;
+    counter->currentSection = findSection(&compileState->stats, "header", strlen("header"));
+
+    #ifdef LINUX
+    FILE* countedOutput = fopencookie(counter, "w", (cookie_io_functions_t) {.write = writeCounted, .close = closeCounter});
+    #else
+    FILE* countedOutput = funopen(counter, NULL, writeCounted, NULL, closeCounter);
+    #endif
+    if(countedOutput == NULL) {
+        free(counter);
+        return output;
+    }
+    compileState->stats.outputCounted = true;
+    return countedOutput;
+    #else
+    return output;
+    #endif
+}
+
+/**
+ * Flushes all counted bytes into the output. The output itself stays open
+ */
+void stopCountingOutput(FILE* countedOutput, FILE* output) {
+    if(countedOutput != output) {
+        fclose(countedOutput);
+    }
+}
+
+/**
+ * Prints a string as a JSON string literal
+ */
+static void printJsonString(FILE* output, const char* string) {
+    fputc('"', output);
+    for(; *string != '\0'; string++) {
+        if(*string == '"' || *string == '\\') {
+            fputc('\\', output);
+        }
+        fputc(*string, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * Prints the counters as a single line of JSON, e.g.
+ *      {"lines":{"read":120,...},"matching":{...},"commands":[{"opcode":5,"pattern":"stonks {p}","count":3},...],"memory":{...},"output":{...}}
+ * Commands that were not used are left out. "output" is only printed if the translation was written by compileProgram()
+ */
+void printStats(struct compileState* compileState, FILE* output) {
+    struct compileStats* stats = &compileState->stats;
+    if(!stats->enabled) {
+        return;
+    }
+
+    fprintf(output, "{\"lines\":{\"read\":%zu,\"parsed\":%zu,\"comments\":%zu,\"blank\":%zu,\"unmatched\":%zu},",
+            stats->parsedLines + stats->commentLines + stats->blankLines, stats->parsedLines, stats->commentLines, stats->blankLines, stats->unmatchedLines);
+    fprintf(output, "\"matching\":{\"attempts\":%zu,\"averagePerLine\":%.2f,\"maxPerLine\":%zu},", stats->matchAttempts,
+            (stats->parsedLines > 0) ? (double) stats->matchAttempts / (double) stats->parsedLines : 0.0, stats->maxMatchAttempts);
+
+    fprintf(output, "\"commands\":[");
+    bool first = true;
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        if(stats->commandsPerOpcode[i] == 0) {
+            continue;
+        }
+        fprintf(output, "%s{\"opcode\":%u,\"pattern\":", first ? "" : ",", i);
+        printJsonString(output, (commandList[i].pattern[0] != '\0') ? commandList[i].pattern : "<invalid>");
+        fprintf(output, ",\"count\":%zu}", stats->commandsPerOpcode[i]);
+        first = false;
+    }
+
+    fprintf(output, "],\"memory\":{\"parametersAllocated\":%zu,\"parameterBytes\":%zu", stats->parametersAllocated, stats->parameterBytes);
+    if(stats->sampledHeapBytes > 0) {
+        fprintf(output, ",\"sampledHeapBytes\":%zu", stats->sampledHeapBytes);
+    }
+    fprintf(output, "}");
+
+    if(stats->outputCounted) {
+        size_t totalBytes = stats->stabsBytes;
+        fprintf(output, ",\"output\":{\"sections\":{");
+        for(unsigned i = 0; i < stats->sectionCount; i++) {
+            fprintf(output, "%s", (i == 0) ? "" : ",");
+            printJsonString(output, stats->sectionNames[i]);
+            fprintf(output, ":%zu", stats->sectionBytes[i]);
+            totalBytes += stats->sectionBytes[i];
+        }
+        fprintf(output, "},\"stabsBytes\":%zu,\"totalBytes\":%zu}", stats->stabsBytes, totalBytes);
+    }
+    fprintf(output, "}\n");
+}
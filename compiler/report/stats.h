@@ -0,0 +1,35 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMEASSEMBLY_STATS_H
+#define MEMEASSEMBLY_STATS_H
+
+#include "../commands.h"
+#include <stdio.h>
+
+void countSkippedLine(struct compileState* compileState, const char* line);
+void countParsedLine(struct compileState* compileState, unsigned matchAttempts, bool matched);
+void countCommand(struct compileState* compileState, uint8_t opcode);
+void countParameter(struct compileState* compileState, size_t bytes);
+void sampleHeapUsage(struct compileState* compileState);
+FILE* startCountingOutput(struct compileState* compileState, FILE* output);
+void stopCountingOutput(FILE* countedOutput, FILE* output);
+void printStats(struct compileState* compileState, FILE* output);
+
+#endif //MEMEASSEMBLY_STATS_H
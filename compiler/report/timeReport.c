@@ -0,0 +1,126 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * -ftime-report measures the duration and the peak memory usage of every compilation phase. Phases are measured back
+ * to back: a phase lasts from the end of the previous one (or startPhase()) until endPhase() is called. Modes that
+ * parse files during translation (--stream, --build-dir, -j) report everything until the translation is done as the
+ * translate phase.
+ * The report is a single line of JSON, so that it can easily be collected by bench/run.sh
+ */
+
+#include "timeReport.h"
+#include "stats.h"
+
+#include <time.h>
+
+#ifndef WINDOWS
+#include <sys/resource.h>
+#endif
+
+static const char* const phaseNames[NUMBER_OF_PHASES] = {"parse", "analyse", "translate", "assemble"};
+
+/**
+ * @return a monotonic time in seconds
+ */
+static double currentTime(void) {
+    struct timespec now;
+    #ifdef WINDOWS
+    timespec_get(&now, TIME_UTC);
+    #else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    #endif
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/**
+ * @param children if set, the peak of all terminated child processes (i.e. gcc) is returned instead of the own one
+ * @return the peak resident set size in KiB, or 0 if it cannot be determined
+ */
+static long peakRssKiB(bool children) {
+    #ifdef WINDOWS
+    (void) children;
+    return 0;
+    #else
+    struct rusage usage;
+    if(getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    #ifdef MACOS
+    return usage.ru_maxrss / 1024; //macOS reports bytes
+    #else
+    return usage.ru_maxrss;
+    #endif
+    #endif
+}
+
+/**
+ * Starts measuring the first phase
+ */
+void startPhase(struct compileState* compileState) {
+    if(compileState->timeReport.enabled) {
+        compileState->timeReport.phaseStart = currentTime();
+    }
+}
+
+/**
+ * Ends the current phase and starts the next one
+ */
+void endPhase(struct compileState* compileState, compilePhase phase) {
+    sampleHeapUsage(compileState);
+    struct timeReport* report = &compileState->timeReport;
+    if(!report->enabled) {
+        return;
+    }
+    double now = currentTime();
+    report->measured[phase] = true;
+    report->seconds[phase] += now - report->phaseStart;
+    report->peakRssKiB[phase] = peakRssKiB(phase == phaseAssemble);
+    report->phaseStart = now;
+}
+
+/**
+ * Prints the report as a single line of JSON, e.g.
+ *      {"commands":1200,"phases":{"parse":{"seconds":0.001,"peakRssKiB":1800},...},"totalSeconds":0.004}
+ * Phases that did not run are left out. commands is the number of parsed commands (0 if files were parsed during translation)
+ */
+void printTimeReport(struct compileState* compileState, FILE* output) {
+    struct timeReport* report = &compileState->timeReport;
+    if(!report->enabled) {
+        return;
+    }
+
+    size_t commands = 0;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        commands += compileState->files[i].loc;
+    }
+
+    double totalSeconds = 0;
+    fprintf(output, "{\"commands\":%zu,\"phases\":{", commands);
+    bool first = true;
+    for(unsigned i = 0; i < NUMBER_OF_PHASES; i++) {
+        if(!report->measured[i]) {
+            continue;
+        }
+        fprintf(output, "%s\"%s\":{\"seconds\":%.6f,\"peakRssKiB\":%ld}", first ? "" : ",", phaseNames[i], report->seconds[i], report->peakRssKiB[i]);
+        totalSeconds += report->seconds[i];
+        first = false;
+    }
+    fprintf(output, "},\"totalSeconds\":%.6f}\n", totalSeconds);
+}
@@ -0,0 +1,823 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "server.h"
+#include "../compiler.h"
+#include "../parser/parser.h"
+#include "../logger/log.h"
+#include "../cache/cache.h"
+#include "../report/remarks.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+//The first four bytes of every request, "MEME"
+#define REQUEST_MAGIC 0x454D454D
+//Requests whose working directory and arguments are larger than this are rejected
+#define MAX_REQUEST_SIZE (1 << 20)
+//Number of parsed files that are kept in memory by each worker
+#define PARSE_CACHE_SIZE 512
+//A client that does not send anything for this long is disconnected, so that it does not block its worker forever
+#define CLIENT_TIMEOUT_SECONDS 30
+//The input file name that refers to the content sent with the request
+#define CONTENT_INPUT_NAME "-"
+
+/*
+ * A request consists of this header, to which the client's stdout and stderr are attached (SCM_RIGHTS),
+ * followed by the client's working directory and all arguments, each terminated by a \0, and then by contentSize
+ * bytes of input that the arguments refer to as "-".
+ * After compilation, the server answers with the exit code as an int32_t
+ */
+struct requestHeader {
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t payloadSize;
+    uint32_t contentSize;
+};
+
+struct parseCacheEntry {
+    char* key; //working directory and file name, separated by a \n
+    uint64_t hash;
+    size_t size;
+    compileMode compileMode;
+    unsigned long lastUsed; //The request in which this entry was used last. Entries used by the current request are never evicted
+    struct file file;
+};
+
+struct parseCache {
+    struct parseCacheEntry entries[PARSE_CACHE_SIZE];
+    size_t entryCount;
+    unsigned long currentRequest;
+    FILE* requestContent; //The input sent with the current request, NULL if there is none
+};
+
+static volatile sig_atomic_t stopServer = 0;
+//The signal handlers of the main server process write into this pipe so that poll() wakes up
+static int wakeupPipe[2];
+
+static void handleStopSignal(int signal) {
+    (void) signal;
+    stopServer = 1;
+}
+
+static void handleServerSignal(int signal) {
+    int savedErrno = errno;
+    if(signal != SIGCHLD) {
+        stopServer = 1;
+    }
+    if(write(wakeupPipe[1], "s", 1) < 0) {
+        //The pipe is full, poll() will wake up anyway
+    }
+    errno = savedErrno;
+}
+
+/**
+ * Reads the entire file into a heap-allocated buffer
+ * @return the buffer or NULL if reading failed
+ */
+static char* readEntireFile(FILE* inputFile, size_t* size) {
+    size_t capacity = 4096;
+    char* buffer = malloc(capacity);
+    *size = 0;
+    while(buffer != NULL) {
+        *size += fread(buffer + *size, 1, capacity - *size, inputFile);
+        if(*size < capacity) {
+            break;
+        }
+        capacity *= 2;
+        char* newBuffer = realloc(buffer, capacity);
+        if(newBuffer == NULL) {
+            free(buffer);
+        }
+        buffer = newBuffer;
+    }
+    return buffer;
+}
+
+/**
+ * Opens a stream that reads from the given buffer
+ */
+static FILE* openContentStream(char* content, size_t size) {
+    //fmemopen does not accept empty buffers. An empty line has the same meaning as an empty file
+    if(size == 0) {
+        return fmemopen((void*) "\n", 1, "r");
+    }
+    return fmemopen(content, size, "r");
+}
+
+/**
+ * Parses a file, but reuses the parsed representation of a previous request if the file's content did not change.
+ * Files are not cached if they contain errors, if debug logs are enabled, or in bully mode (where parsing a file depends on all previously parsed files).
+ * With --stats, files are always parsed, since the statistics count the work of the parser
+ */
+void parseFileCached(struct parseCache* parseCache, struct file* fileStruct, FILE* inputFile, struct compileState* compileState) {
+    if(compileState->compileMode == bully || compileState->logLevel == debug || compileState->stats.enabled) {
+        parseFile(fileStruct, inputFile, compileState);
+        return;
+    }
+
+    char cwd[PATH_MAX + 1];
+    size_t size;
+    char* content = readEntireFile(inputFile, &size);
+    //The hashed bytes are parsed instead of reading the file again, so that a file changed in between is never cached under the wrong hash
+    FILE* contentStream = (content != NULL) ? openContentStream(content, size) : NULL;
+    if(contentStream == NULL || getcwd(cwd, PATH_MAX) == NULL) {
+        if(contentStream != NULL) {
+            fclose(contentStream);
+        }
+        free(content);
+        rewind(inputFile);
+        parseFile(fileStruct, inputFile, compileState);
+        return;
+    }
+    uint64_t hash = hashBuffer(content, size);
+
+    char* key = malloc(strlen(cwd) + strlen(fileStruct->fileName) + 2);
+    CHECK_ALLOC(key);
+    sprintf(key, "%s\n%s", cwd, fileStruct->fileName);
+
+    for(size_t i = 0; i < parseCache->entryCount; i++) {
+        struct parseCacheEntry* entry = &parseCache->entries[i];
+        if(entry->hash == hash && entry->size == size && entry->compileMode == compileState->compileMode && strcmp(entry->key, key) == 0) {
+            printDebugMessage(compileState->logLevel, "Parse cache hit for %s", 1, fileStruct->fileName);
+            entry->lastUsed = parseCache->currentRequest;
+            *fileStruct = entry->file;
+            fclose(contentStream);
+            free(content);
+            free(key);
+            return;
+        }
+    }
+
+    //Cache miss: find a free entry, or evict the least recently used one
+    struct parseCacheEntry* entry = NULL;
+    if(parseCache->entryCount < PARSE_CACHE_SIZE) {
+        entry = &parseCache->entries[parseCache->entryCount];
+    } else {
+        for(size_t i = 0; i < PARSE_CACHE_SIZE; i++) {
+            struct parseCacheEntry* candidate = &parseCache->entries[i];
+            if(candidate->lastUsed != parseCache->currentRequest && (entry == NULL || candidate->lastUsed < entry->lastUsed)) {
+                entry = candidate;
+            }
+        }
+    }
+
+    unsigned errorsBefore = compileState->compilerErrors;
+    if(entry == NULL) {
+        free(key);
+        parseFile(fileStruct, contentStream, compileState);
+        fclose(contentStream);
+        free(content);
+        return;
+    }
+
+    //The file name must outlive this request, as it is referenced by the parsed functions
+    char* fileName = strdup(fileStruct->fileName);
+    CHECK_ALLOC(fileName);
+    char* originalFileName = fileStruct->fileName;
+    fileStruct->fileName = fileName;
+    parseFile(fileStruct, contentStream, compileState);
+    fclose(contentStream);
+    free(content);
+
+    if(compileState->compilerErrors != errorsBefore || fileStruct->parsedCommands == NULL) {
+        //Do not cache erroneous files, the request owns this file
+        free(key);
+        fileStruct->fileName = originalFileName;
+        for(size_t i = 0; i < fileStruct->functionCount; i++) {
+            fileStruct->functions[i].definedInFile = originalFileName;
+        }
+        free(fileName);
+        return;
+    }
+
+    if(entry == &parseCache->entries[parseCache->entryCount]) {
+        parseCache->entryCount++;
+    } else {
+        free(entry->key);
+        free(entry->file.fileName);
+        freeFile(&entry->file, entry->compileMode);
+    }
+    entry->key = key;
+    entry->hash = hash;
+    entry->size = size;
+    entry->compileMode = compileState->compileMode;
+    entry->lastUsed = parseCache->currentRequest;
+    entry->file = *fileStruct;
+}
+
+/**
+ * Opens an input file of a request. The name "-" refers to the content the client sent with the request, if there is any
+ * @return the opened file or NULL on error (errno is set)
+ */
+FILE* openRequestInput(struct parseCache* parseCache, const char* fileName) {
+    if(parseCache != NULL && parseCache->requestContent != NULL && strcmp(fileName, CONTENT_INPUT_NAME) == 0) {
+        int contentFd = dup(fileno(parseCache->requestContent));
+        FILE* inputFile = (contentFd >= 0) ? fdopen(contentFd, "r") : NULL;
+        if(inputFile == NULL && contentFd >= 0) {
+            close(contentFd);
+        } else if(inputFile != NULL) {
+            //The duplicated descriptor shares the file position with the original
+            rewind(inputFile);
+        }
+        return inputFile;
+    }
+    return fopen(fileName, "r");
+}
+
+/**
+ * Checks if the parsed file is owned by the cache. If not, it belongs to the request and must be freed after the request was handed to a worker
+ */
+static bool isCachedFile(struct parseCache* parseCache, struct file* fileStruct) {
+    for(size_t i = 0; i < parseCache->entryCount; i++) {
+        if(fileStruct->parsedCommands != NULL && parseCache->entries[i].file.parsedCommands == fileStruct->parsedCommands) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct parseCache* createParseCache(void) {
+    struct parseCache* parseCache = calloc(1, sizeof(struct parseCache));
+    CHECK_ALLOC(parseCache);
+    return parseCache;
+}
+
+/**
+ * Must be called before the files of a new request are parsed. Entries used by the current request are never evicted
+ */
+void beginParseRequest(struct parseCache* parseCache) {
+    parseCache->currentRequest++;
+}
+
+/**
+ * Frees all files of a request that are not owned by the cache, as well as the file array itself
+ */
+void freeRequestFiles(struct parseCache* parseCache, struct compileState* compileState) {
+    for(uint32_t i = 0; i < compileState->fileCount; i++) {
+        if(!isCachedFile(parseCache, &compileState->files[i])) {
+            freeFile(&compileState->files[i], compileState->compileMode);
+        }
+    }
+    free(compileState->files);
+}
+
+void freeParseCache(struct parseCache* parseCache) {
+    for(size_t i = 0; i < parseCache->entryCount; i++) {
+        free(parseCache->entries[i].key);
+        free(parseCache->entries[i].file.fileName);
+        freeFile(&parseCache->entries[i].file, parseCache->entries[i].compileMode);
+    }
+    free(parseCache);
+}
+
+static bool readFully(int fd, void* buffer, size_t size) {
+    size_t bytesRead = 0;
+    while(bytesRead < size) {
+        ssize_t result = read(fd, (char*) buffer + bytesRead, size - bytesRead);
+        if(result <= 0) {
+            if(result < 0 && errno == EINTR) continue;
+            return false;
+        }
+        bytesRead += result;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* buffer, size_t size) {
+    size_t bytesWritten = 0;
+    while(bytesWritten < size) {
+        ssize_t result = write(fd, (const char*) buffer + bytesWritten, size - bytesWritten);
+        if(result <= 0) {
+            if(result < 0 && errno == EINTR) continue;
+            return false;
+        }
+        bytesWritten += result;
+    }
+    return true;
+}
+
+static void sendExitCode(int clientSocket, int exitCode) {
+    int32_t code = exitCode;
+    writeFully(clientSocket, &code, sizeof(code));
+    close(clientSocket);
+}
+
+/**
+ * Receives the request header together with the client's stdout and stderr
+ * @return true on success
+ */
+static bool receiveHeader(int clientSocket, struct requestHeader* header, int outputFds[2]) {
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct iovec iov = {.iov_base = header, .iov_len = sizeof(struct requestHeader)};
+    struct msghdr message = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+
+    ssize_t received = recvmsg(clientSocket, &message, 0);
+    struct cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+    if(received <= 0 || controlMessage == NULL || controlMessage->cmsg_type != SCM_RIGHTS || controlMessage->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        return false;
+    }
+    memcpy(outputFds, CMSG_DATA(controlMessage), 2 * sizeof(int));
+
+    if(((size_t) received < sizeof(struct requestHeader) && !readFully(clientSocket, (char*) header + received, sizeof(struct requestHeader) - received)) ||
+       header->magic != REQUEST_MAGIC || header->payloadSize > MAX_REQUEST_SIZE || header->argc == 0) {
+        close(outputFds[0]);
+        close(outputFds[1]);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Copies the input content of a request from the socket into a temporary file
+ * @return the file or NULL if the content could not be received
+ */
+static FILE* receiveContent(int clientSocket, uint32_t contentSize) {
+    FILE* content = tmpfile();
+    char buffer[65536];
+    for(uint32_t remaining = contentSize; content != NULL && remaining > 0;) {
+        size_t chunkSize = (remaining < sizeof(buffer)) ? remaining : sizeof(buffer);
+        if(!readFully(clientSocket, buffer, chunkSize) || fwrite(buffer, 1, chunkSize, content) != chunkSize) {
+            fclose(content);
+            return NULL;
+        }
+        remaining -= chunkSize;
+    }
+    if(content != NULL && fflush(content) != 0) {
+        fclose(content);
+        return NULL;
+    }
+    return content;
+}
+
+/**
+ * Parses the arguments and input files of a request. The diagnostics are written directly to the client.
+ * An abortCompilation() (e.g. because the worker ran out of memory) returns to this function instead of exiting the worker
+ * @return the result of parseArguments(), or -2 if parsing was aborted
+ */
+static int parseRequest(uint32_t argc, char* argv[], int outputFds[2], struct compileState* compileState, char** outputFileName,
+                        struct parseCache* parseCache, argumentParser parseArguments) {
+    fflush(stdout);
+    fflush(stderr);
+    int savedStdout = dup(STDOUT_FILENO);
+    int savedStderr = dup(STDERR_FILENO);
+    dup2(outputFds[0], STDOUT_FILENO);
+    dup2(outputFds[1], STDERR_FILENO);
+
+    int exitCode = -2;
+    jmp_buf abortTarget;
+    jmp_buf* previousAbortTarget = setAbortTarget(&abortTarget);
+    if(setjmp(abortTarget) == 0) {
+        beginParseRequest(parseCache);
+        exitCode = parseArguments((int) argc, argv, compileState, outputFileName, parseCache);
+    }
+    setAbortTarget(previousAbortTarget);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(savedStdout, STDOUT_FILENO);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStdout);
+    close(savedStderr);
+    return exitCode;
+}
+
+/**
+ * Compiles a parsed request in a forked process, so that the analysis works on a copy-on-write snapshot of the cached
+ * files and cannot modify them
+ * @return the exit code of the compilation
+ */
+static int compileRequest(struct compileState* compileState, char* outputFileName, int outputFds[2], int listenSocket, const sigset_t* originalSignalMask) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if(pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        sigprocmask(SIG_SETMASK, originalSignalMask, NULL);
+        close(listenSocket);
+        dup2(outputFds[0], STDOUT_FILENO);
+        dup2(outputFds[1], STDERR_FILENO);
+        exit(compile(compileState, outputFileName));
+    } else if(pid < 0) {
+        dprintf(outputFds[1], "Error: The compile server failed to start a compilation: %s\n", strerror(errno));
+        return 1;
+    }
+
+    int status;
+    while(waitpid(pid, &status, 0) < 0) {
+        if(errno != EINTR) {
+            return 1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/**
+ * Reads a request, parses its arguments and input files and compiles it. The exit code is sent to the client
+ * @return false if parsing was aborted, after which the worker should be replaced
+ */
+static bool handleRequest(int clientSocket, int listenSocket, struct parseCache* parseCache, argumentParser parseArguments, const sigset_t* originalSignalMask) {
+    //A slow or stalled client only blocks this worker, and only until the timeout
+    struct timeval timeout = {.tv_sec = CLIENT_TIMEOUT_SECONDS};
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct requestHeader header;
+    int outputFds[2];
+    if(!receiveHeader(clientSocket, &header, outputFds)) {
+        close(clientSocket);
+        return true;
+    }
+
+    char* payload = malloc(header.payloadSize + 1);
+    char** argv = calloc(header.argc + 1, sizeof(char*));
+    CHECK_ALLOC(payload);
+    CHECK_ALLOC(argv);
+    payload[header.payloadSize] = '\0';
+
+    //Split the payload into the working directory and the arguments
+    bool validRequest = readFully(clientSocket, payload, header.payloadSize);
+    char* cwd = payload;
+    char* current = payload + strlen(payload) + 1;
+    for(uint32_t i = 0; i < header.argc && validRequest; i++) {
+        if(current >= payload + header.payloadSize) {
+            validRequest = false;
+            break;
+        }
+        argv[i] = current;
+        current += strlen(current) + 1;
+    }
+    if(validRequest && header.contentSize > 0) {
+        parseCache->requestContent = receiveContent(clientSocket, header.contentSize);
+        validRequest = parseCache->requestContent != NULL;
+    }
+
+    int exitCode = 1;
+    bool aborted = false;
+    struct compileState compileState = {0};
+    char* outputFileName = NULL;
+
+    if(!validRequest) {
+        dprintf(outputFds[1], "Error: Invalid request received by the compile server\n");
+    } else if(chdir(cwd) != 0) {
+        dprintf(outputFds[1], "Error: The compile server cannot access the working directory %s: %s\n", cwd, strerror(errno));
+    } else {
+        exitCode = parseRequest(header.argc, argv, outputFds, &compileState, &outputFileName, parseCache, parseArguments);
+        if(exitCode == -2) {
+            //The files parsed so far cannot be freed safely, the worker is replaced instead
+            aborted = true;
+            exitCode = 1;
+        } else if(exitCode == -1) {
+            //Streaming and incremental compilation open the input files again by name
+            if(parseCache->requestContent != NULL && (compileState.streaming || compileState.buildDir != NULL)) {
+                dprintf(outputFds[1], "Error: input sent by the client (\"%s\") cannot be used with --stream or --build-dir\n", CONTENT_INPUT_NAME);
+                exitCode = 1;
+            } else {
+                exitCode = compileRequest(&compileState, outputFileName, outputFds, listenSocket, originalSignalMask);
+            }
+        }
+        //The compiling process only freed its own copy of the files and remarks of the request
+        if(!aborted) {
+            freeRequestFiles(parseCache, &compileState);
+            freeRemarks(&compileState);
+        }
+    }
+
+    if(parseCache->requestContent != NULL) {
+        fclose(parseCache->requestContent);
+        parseCache->requestContent = NULL;
+    }
+    close(outputFds[0]);
+    close(outputFds[1]);
+    free(argv);
+    free(payload);
+    sendExitCode(clientSocket, exitCode);
+    return !aborted;
+}
+
+/**
+ * Main loop of a worker process. Every worker accepts requests from the shared socket on its own and keeps its own
+ * cache of parsed files, so a slow client or a large input only occupies the worker that handles it
+ */
+static _Noreturn void runWorker(int listenSocket, argumentParser parseArguments) {
+    //SIGINT and SIGTERM are only handled while waiting for a new request, so that a started request is always finished
+    struct sigaction stopAction = {.sa_handler = handleStopSignal};
+    sigaction(SIGINT, &stopAction, NULL);
+    sigaction(SIGTERM, &stopAction, NULL);
+    signal(SIGCHLD, SIG_DFL);
+    close(wakeupPipe[0]);
+    close(wakeupPipe[1]);
+
+    sigset_t stopSignals, originalSignalMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stopSignals, &originalSignalMask);
+    sigset_t waitMask = originalSignalMask;
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+
+    struct parseCache* parseCache = createParseCache();
+    while(!stopServer) {
+        fd_set readFds;
+        FD_ZERO(&readFds);
+        FD_SET(listenSocket, &readFds);
+        if(pselect(listenSocket + 1, &readFds, NULL, NULL, NULL, &waitMask) <= 0) {
+            continue;
+        }
+
+        //The socket is non-blocking, as another worker may have accepted the connection in the meantime
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if(clientSocket < 0) {
+            continue;
+        }
+        fcntl(clientSocket, F_SETFL, fcntl(clientSocket, F_GETFL) & ~O_NONBLOCK);
+        if(!handleRequest(clientSocket, listenSocket, parseCache, parseArguments, &originalSignalMask)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    freeParseCache(parseCache);
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Starts a worker process
+ * @return its pid, or -1 if it could not be started
+ */
+static pid_t startWorker(int listenSocket, argumentParser parseArguments) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if(pid == 0) {
+        runWorker(listenSocket, parseArguments);
+    } else if(pid < 0) {
+        perror("Failed to start a worker");
+    }
+    return pid;
+}
+
+/**
+ * Starts a compile server listening on a Unix domain socket. Requests are handled by "workers" worker processes, each
+ * of which reads, parses and compiles one request at a time and keeps a cache of parsed files.
+ * Workers that exit unexpectedly (e.g. after running out of memory) are replaced
+ */
+int runServer(const char* socketPath, unsigned workerCount, argumentParser parseArguments) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: socket path is too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenSocket < 0) {
+        perror("Failed to create socket");
+        return 1;
+    }
+
+    //If a server is already listening on this socket, do not steal it. Otherwise, remove the stale socket file, but never any other file
+    struct stat socketStat;
+    if(lstat(socketPath, &socketStat) == 0) {
+        if(!S_ISSOCK(socketStat.st_mode)) {
+            fprintf(stderr, "Error: %s already exists and is not a socket\n", socketPath);
+            close(listenSocket);
+            return 1;
+        }
+        if(connect(listenSocket, (struct sockaddr*) &address, sizeof(address)) == 0) {
+            fprintf(stderr, "Error: a compile server is already listening on %s\n", socketPath);
+            close(listenSocket);
+            return 1;
+        }
+        unlink(socketPath);
+    }
+    close(listenSocket);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenSocket < 0 || bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0) {
+        perror("Failed to listen on socket");
+        return 1;
+    }
+    //Another server may replace the socket file after this one stopped listening on it. Only the own socket is removed on shutdown
+    struct stat boundSocketStat;
+    if(stat(socketPath, &boundSocketStat) != 0) {
+        perror("Failed to listen on socket");
+        close(listenSocket);
+        return 1;
+    }
+    fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL) | O_NONBLOCK);
+
+    if(pipe(wakeupPipe) != 0) {
+        perror("Failed to create pipe");
+        return 1;
+    }
+
+    struct sigaction serverAction = {.sa_handler = handleServerSignal, .sa_flags = SA_RESTART | SA_NOCLDSTOP};
+    sigaction(SIGINT, &serverAction, NULL);
+    sigaction(SIGTERM, &serverAction, NULL);
+    sigaction(SIGCHLD, &serverAction, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t* workers = calloc(workerCount, sizeof(pid_t));
+    CHECK_ALLOC(workers);
+    unsigned runningWorkers = 0;
+    for(unsigned i = 0; i < workerCount; i++) {
+        workers[i] = startWorker(listenSocket, parseArguments);
+        runningWorkers += workers[i] > 0;
+    }
+
+    printf("MemeAssembly compile server listening on %s with %u worker(s)\n", socketPath, runningWorkers);
+    fflush(stdout);
+
+    while(!stopServer && runningWorkers > 0) {
+        struct pollfd pollFd = {.fd = wakeupPipe[0], .events = POLLIN};
+        if(poll(&pollFd, 1, -1) <= 0) {
+            continue;
+        }
+        char buffer[64];
+        if(read(wakeupPipe[0], buffer, sizeof(buffer)) < 0) {
+            //Nothing to do, the workers are checked anyway
+        }
+
+        //Replace all workers that exited
+        int status;
+        pid_t pid;
+        while((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for(unsigned i = 0; i < workerCount; i++) {
+                if(workers[i] == pid) {
+                    workers[i] = stopServer ? -1 : startWorker(listenSocket, parseArguments);
+                    runningWorkers -= workers[i] <= 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    //Let all running compilations finish before shutting down
+    for(unsigned i = 0; i < workerCount; i++) {
+        if(workers[i] > 0) {
+            kill(workers[i], SIGTERM);
+        }
+    }
+    for(unsigned i = 0; i < workerCount; i++) {
+        if(workers[i] > 0) {
+            while(waitpid(workers[i], NULL, 0) < 0 && errno == EINTR);
+        }
+    }
+    close(listenSocket);
+    if(stat(socketPath, &socketStat) == 0 && socketStat.st_dev == boundSocketStat.st_dev && socketStat.st_ino == boundSocketStat.st_ino) {
+        unlink(socketPath);
+    }
+
+    free(workers);
+    return 0;
+}
+
+/**
+ * Forwards a compile request to a running compile server. The server writes all diagnostics directly to this process' stdout and stderr.
+ * If an argument is "-", the standard input is sent along with the request and compiled as that input file
+ * @param argc the number of arguments, including the program name
+ * @return the exit code of the compilation
+ */
+int runClient(const char* socketPath, int argc, char* argv[]) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: socket path is too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(serverSocket < 0 || connect(serverSocket, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        fprintf(stderr, "Error: cannot connect to the compile server at %s: %s\n", socketPath, strerror(errno));
+        return 1;
+    }
+
+    char cwd[PATH_MAX + 1];
+    if(getcwd(cwd, PATH_MAX) == NULL) {
+        perror("Failed to get the current working directory");
+        return 1;
+    }
+
+    size_t payloadSize = strlen(cwd) + 1;
+    for(int i = 0; i < argc; i++) {
+        payloadSize += strlen(argv[i]) + 1;
+    }
+    if(payloadSize > MAX_REQUEST_SIZE) {
+        fprintf(stderr, "Error: too many arguments for the compile server\n");
+        return 1;
+    }
+
+    char* content = NULL;
+    size_t contentSize = 0;
+    for(int i = 1; i < argc && content == NULL; i++) {
+        if(strcmp(argv[i], CONTENT_INPUT_NAME) == 0) {
+            content = readEntireFile(stdin, &contentSize);
+            if(content == NULL || ferror(stdin) || contentSize > UINT32_MAX) {
+                fprintf(stderr, "Error: failed to read the input from stdin\n");
+                free(content);
+                return 1;
+            }
+        }
+    }
+
+    char* payload = malloc(payloadSize);
+    CHECK_ALLOC(payload);
+    size_t offset = 0;
+    strcpy(payload, cwd);
+    offset += strlen(cwd) + 1;
+    for(int i = 0; i < argc; i++) {
+        strcpy(payload + offset, argv[i]);
+        offset += strlen(argv[i]) + 1;
+    }
+
+    //Attach stdout and stderr to the header
+    struct requestHeader header = {.magic = REQUEST_MAGIC, .argc = (uint32_t) argc, .payloadSize = (uint32_t) payloadSize, .contentSize = (uint32_t) contentSize};
+    int outputFds[2] = {STDOUT_FILENO, STDERR_FILENO};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {.iov_base = &header, .iov_len = sizeof(header)};
+    struct msghdr message = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+    struct cmsghdr* controlMessage = CMSG_FIRSTHDR(&message);
+    controlMessage->cmsg_level = SOL_SOCKET;
+    controlMessage->cmsg_type = SCM_RIGHTS;
+    controlMessage->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    memcpy(CMSG_DATA(controlMessage), outputFds, 2 * sizeof(int));
+
+    fflush(stdout);
+    int32_t exitCode = 1;
+    if(sendmsg(serverSocket, &message, 0) != sizeof(header) || !writeFully(serverSocket, payload, payloadSize) ||
+       !writeFully(serverSocket, content, contentSize) || !readFully(serverSocket, &exitCode, sizeof(exitCode))) {
+        fprintf(stderr, "Error: lost connection to the compile server\n");
+        exitCode = 1;
+    }
+
+    free(content);
+    free(payload);
+    close(serverSocket);
+    return exitCode;
+}
+
+#else
+
+int runServer(const char* socketPath, unsigned workerCount, argumentParser parseArguments) {
+    (void) socketPath;
+    (void) workerCount;
+    (void) parseArguments;
+    fprintf(stderr, "Error: the compile server is not supported on Windows\n");
+    return 1;
+}
+
+int runClient(const char* socketPath, int argc, char* argv[]) {
+    (void) socketPath;
+    (void) argc;
+    (void) argv;
+    fprintf(stderr, "Error: the compile server is not supported on Windows\n");
+    return 1;
+}
+
+void parseFileCached(struct parseCache* parseCache, struct file* fileStruct, FILE* inputFile, struct compileState* compileState) {
+    (void) parseCache;
+    parseFile(fileStruct, inputFile, compileState);
+}
+
+FILE* openRequestInput(struct parseCache* parseCache, const char* fileName) {
+    (void) parseCache;
+    return fopen(fileName, "r");
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMEASSEMBLY_SERVER_H
+#define MEMEASSEMBLY_SERVER_H
+
+#include "../commands.h"
+
+#include <stdio.h>
+
+struct parseCache;
+
+/**
+ * Parses the command line arguments and input files of a compile request. Returns -1 if the compilation should start,
+ * otherwise the exit code of the request. If parseCache is not NULL, it is used to look up and store parsed files
+ */
+typedef int (*argumentParser)(int argc, char* argv[], struct compileState* compileState, char** outputFileName, struct parseCache* parseCache);
+
+int runServer(const char* socketPath, unsigned workers, argumentParser parseArguments);
+int runClient(const char* socketPath, int argc, char* argv[]);
+
+void parseFileCached(struct parseCache* parseCache, struct file* fileStruct, FILE* inputFile, struct compileState* compileState);
+FILE* openRequestInput(struct parseCache* parseCache, const char* fileName);
+
+//The parse cache is also used by watch mode. These functions are not available on Windows
+struct parseCache* createParseCache(void);
+void beginParseRequest(struct parseCache* parseCache);
+void freeRequestFiles(struct parseCache* parseCache, struct compileState* compileState);
+void freeParseCache(struct parseCache* parseCache);
+
+#endif //MEMEASSEMBLY_SERVER_H
@@ -0,0 +1,665 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Streaming mode (--stream). Normally, all input files are parsed completely and kept in memory until they are
+ * translated. In streaming mode, every function is parsed, checked and translated as soon as its last command was read,
+ * and freed afterwards. Memory usage therefore only depends on the size of the largest function and on the number of
+ * symbols, not on the size of the input files.
+ *
+ * The analysis functions of analyser/ need a list of all commands of the program. Instead, a summary of all symbols is
+ * kept: function names, data and monke jump markers of the whole program, and the jump markers and comparison labels of the
+ * current file. A reference to a symbol that was not defined yet is remembered and checked once the file (or program)
+ * was read completely. Errors are reported in the order in which they are found.
+ *
+ * Bully mode and the stack usage report need the whole program at once, which is why they are not supported.
+ */
+
+#include "streaming.h"
+#include "../compiler.h"
+#include "../parser/fileParser.h"
+#include "../parser/functionParser.h"
+#include "../analyser/parameters.h"
+#include "../analyser/functions.h"
+#include "../analyser/jumpMarkers.h"
+#include "../analyser/comparisons.h"
+#include "../analyser/data.h"
+#include "../analyser/randomCommands.h"
+#include "../analyser/analysisHelper.h"
+#include "../translator/translator.h"
+#include "../cache/cache.h"
+#include "../report/stats.h"
+#include "../report/remarks.h"
+#include "../logger/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+extern const struct command commandList[];
+
+typedef enum { noSymbol, definesSymbol, referencesSymbol } symbolRole;
+
+/**
+ * Describes how a command takes part in the checks of the analyser
+ */
+struct symbolRule {
+    symbolRole role;
+    uint8_t definitionOpcode; //The opcode of the command defining the symbol. Symbols of different opcodes do not collide
+    uint8_t parametersToCheck; //0 if the symbol has no name (e.g. "upgrade"). References with 2 parameters reference two symbols
+    bool perFile; //If set, the symbol must be defined in the same file and may be defined once per file
+    char* itemName; //Inserted into error messages
+};
+
+struct symbol {
+    char* name; //NULL if the slot is empty
+    uint8_t opcode;
+    unsigned fileNum;
+    size_t lineNum;
+};
+
+//Hash set of symbols using open addressing
+struct symbolTable {
+    struct symbol* entries;
+    size_t capacity; //Always a power of two
+    size_t count;
+};
+
+struct pendingReference {
+    char* name;
+    struct symbolRule* rule;
+    unsigned fileNum;
+    size_t lineNum;
+};
+
+struct pendingReferences {
+    struct pendingReference* entries;
+    size_t count;
+    size_t capacity;
+};
+
+struct streamState {
+    struct compileState* compileState;
+    struct symbolRule rules[NUMBER_OF_COMMANDS];
+    struct symbolTable programSymbols;
+    struct symbolTable fileSymbols;
+    struct pendingReferences programReferences;
+    struct pendingReferences fileReferences;
+    bool mainDefined;
+    uint8_t dataOpcode; //Data symbols are stored with the opcode of the first kind of data
+
+    //"perfectly balanced as all things should be": linesToBeDeleted of the remaining lines are chosen randomly
+    int perfectlyBalancedOpcode; //-1 if the command does not exist
+    size_t remainingLines;
+    size_t linesToBeDeleted;
+
+    //The function that is currently being read. Commands after its last return statement do not belong to it
+    struct parsedCommand* commands;
+    size_t commandCount;
+    size_t commandCapacity;
+    size_t lastReturn; //0 if the function did not return yet
+    size_t line; //The number of commands of the current file that were translated, see writeFunction()
+
+    FILE* output;
+};
+
+/**
+ * Derives the rules from the analysis functions of all commands, so that the same checks are performed as in analyser/
+ */
+static void initSymbolRules(struct streamState* state) {
+    //Like analyseData(), all kinds of data share one namespace. Their symbols are stored with the opcode of the first kind
+    uint8_t dataOpcode = 0;
+    for(unsigned i = NUMBER_OF_COMMANDS; i-- > 0;) {
+        if(commandList[i].commandType == COMMAND_TYPE_DATA) {
+            dataOpcode = i;
+        }
+    }
+
+    state->dataOpcode = dataOpcode;
+    state->perfectlyBalancedOpcode = -1;
+    for(unsigned i = 0; i < NUMBER_OF_COMMANDS; i++) {
+        void (*analysisFunction)(struct commandLinkedList**, unsigned, struct compileState*) = commandList[i].analysisFunction;
+        if(commandList[i].commandType == COMMAND_TYPE_DATA) {
+            state->rules[i] = (struct symbolRule) {definesSymbol, dataOpcode, 1, false, "data"};
+        } else if(analysisFunction == &analyseData) {
+            //Data of other object files can be used when creating an object file
+            if(state->compileState->outputMode == executable) {
+                state->rules[i] = (struct symbolRule) {referencesSymbol, dataOpcode, 1, false, "data"};
+            }
+        } else if(analysisFunction == &analyseFunctions) {
+            state->rules[i] = (struct symbolRule) {definesSymbol, i, 1, false, "function"};
+        } else if(analysisFunction == &analyseCall) {
+            //External functions can be called when creating an object file. Like analyseCall(), functions are defined by opcode 0
+            if(state->compileState->outputMode == executable) {
+                state->rules[i] = (struct symbolRule) {referencesSymbol, 0, 1, false, "function"};
+            }
+        } else if(analysisFunction == &analyseMonkeMarkers) {
+            state->rules[i] = (struct symbolRule) {definesSymbol, i, 1, false, "monke jump marker"};
+            state->rules[i + 1] = (struct symbolRule) {referencesSymbol, i, 1, false, "monke jump marker"};
+        } else if(analysisFunction == &analyseJumpMarkers) {
+            state->rules[i] = (struct symbolRule) {definesSymbol, i, 0, true, "jump marker"};
+            state->rules[i + 1] = (struct symbolRule) {referencesSymbol, i, 0, true, "jump marker"};
+        } else if(analysisFunction == &analyseWhoWouldWinCommands) {
+            state->rules[i] = (struct symbolRule) {referencesSymbol, i + 1, 2, true, "comparison jump label"};
+            state->rules[i + 1] = (struct symbolRule) {definesSymbol, i + 1, 1, true, "comparison jump marker"};
+        } else if(analysisFunction == &analyseTheyreTheSamePictureCommands) {
+            state->rules[i] = (struct symbolRule) {referencesSymbol, i + 1, 0, true, "\"they're the same picture\""};
+            state->rules[i + 1] = (struct symbolRule) {definesSymbol, i + 1, 0, true, "\"they're the same picture\""};
+        } else if(analysisFunction == &chooseLinesToBeDeleted) {
+            state->perfectlyBalancedOpcode = (int) i;
+        }
+    }
+}
+
+static uint64_t hashSymbol(uint8_t opcode, const char* name) {
+    return hashContinue(hashContinue(FNV_OFFSET_BASIS, &opcode, 1), name, strlen(name));
+}
+
+/**
+ * @return the slot of the symbol. If the symbol does not exist, this is the empty slot it would be inserted into
+ */
+static struct symbol* findSlot(struct symbolTable* table, uint8_t opcode, const char* name) {
+    size_t index = hashSymbol(opcode, name) & (table->capacity - 1);
+    while(table->entries[index].name != NULL && (table->entries[index].opcode != opcode || strcmp(table->entries[index].name, name) != 0)) {
+        index = (index + 1) & (table->capacity - 1);
+    }
+    return &table->entries[index];
+}
+
+static struct symbol* findSymbol(struct symbolTable* table, uint8_t opcode, const char* name) {
+    if(table->count == 0) {
+        return NULL;
+    }
+    struct symbol* slot = findSlot(table, opcode, name);
+    return (slot->name != NULL) ? slot : NULL;
+}
+
+static void addSymbol(struct symbolTable* table, uint8_t opcode, const char* name, unsigned fileNum, size_t lineNum) {
+    //Keep the load factor below 1/2
+    if(2 * (table->count + 1) > table->capacity) {
+        struct symbolTable grownTable = {
+            .capacity = (table->capacity == 0) ? 64 : 2 * table->capacity,
+            .count = table->count
+        };
+        grownTable.entries = calloc(grownTable.capacity, sizeof(struct symbol));
+        CHECK_ALLOC(grownTable.entries);
+        for(size_t i = 0; i < table->capacity; i++) {
+            if(table->entries[i].name != NULL) {
+                *findSlot(&grownTable, table->entries[i].opcode, table->entries[i].name) = table->entries[i];
+            }
+        }
+        free(table->entries);
+        *table = grownTable;
+    }
+
+    struct symbol* slot = findSlot(table, opcode, name);
+    slot->name = strdup(name);
+    CHECK_ALLOC(slot->name);
+    slot->opcode = opcode;
+    slot->fileNum = fileNum;
+    slot->lineNum = lineNum;
+    table->count++;
+}
+
+static void freeSymbolTable(struct symbolTable* table) {
+    for(size_t i = 0; i < table->capacity; i++) {
+        free(table->entries[i].name);
+    }
+    free(table->entries);
+    *table = (struct symbolTable) {0};
+}
+
+static void addPendingReference(struct pendingReferences* references, const char* name, struct symbolRule* rule, unsigned fileNum, size_t lineNum) {
+    if(references->count == references->capacity) {
+        references->capacity = (references->capacity == 0) ? 16 : 2 * references->capacity;
+        references->entries = realloc(references->entries, references->capacity * sizeof(struct pendingReference));
+        CHECK_ALLOC(references->entries);
+    }
+    char* nameCopy = strdup(name);
+    CHECK_ALLOC(nameCopy);
+    references->entries[references->count++] = (struct pendingReference) {nameCopy, rule, fileNum, lineNum};
+}
+
+static void freePendingReferences(struct pendingReferences* references) {
+    for(size_t i = 0; i < references->count; i++) {
+        free(references->entries[i].name);
+    }
+    free(references->entries);
+    *references = (struct pendingReferences) {0};
+}
+
+/**
+ * Prints an error for every reference whose symbol is still not defined, and clears the list
+ */
+static void resolvePendingReferences(struct streamState* state, struct pendingReferences* references, struct symbolTable* table) {
+    struct compileState* compileState = state->compileState;
+    for(size_t i = 0; i < references->count; i++) {
+        struct pendingReference* reference = &references->entries[i];
+        if(findSymbol(table, reference->rule->definitionOpcode, reference->name) == NULL) {
+            char* fileName = compileState->files[reference->fileNum].fileName;
+            if(reference->rule->parametersToCheck == 0) {
+                printError(fileName, reference->lineNum, compileState, "%s was not defined", 1, reference->rule->itemName);
+            } else {
+                printError(fileName, reference->lineNum, compileState, "%s was not defined for parameter \"%s\"", 2, reference->rule->itemName, reference->name);
+            }
+        }
+        free(reference->name);
+    }
+    references->count = 0;
+}
+
+/**
+ * Functions and data are global symbols, which is why their names must differ from each other and from the symbols of
+ * the runtime. Like analyseData(), a conflict between data and a function is reported at the data declaration
+ */
+static void checkGlobalSymbolName(struct streamState* state, unsigned fileNum, struct parsedCommand* command) {
+    struct compileState* compileState = state->compileState;
+    char* name = command->parameters[0];
+    bool isData = commandList[command->opcode].commandType == COMMAND_TYPE_DATA;
+    if(isRuntimeSymbol(name)) {
+        printError(compileState->files[fileNum].fileName, command->lineNum, compileState, "%s cannot be named \"%s\", the name is used by the runtime", 2,
+                   state->rules[command->opcode].itemName, name);
+        return;
+    }
+
+    //Functions are defined by opcode 0
+    struct symbol* other = findSymbol(&state->programSymbols, isData ? 0 : state->dataOpcode, name);
+    if(other == NULL) {
+        return;
+    }
+    if(isData) {
+        printError(compileState->files[fileNum].fileName, command->lineNum, compileState, "%s has the same name as the %s defined in %s:%lu", 4,
+                   "data", "function", compileState->files[other->fileNum].fileName, other->lineNum);
+    } else {
+        printError(compileState->files[other->fileNum].fileName, other->lineNum, compileState, "%s has the same name as the %s defined in %s:%u", 4,
+                   "data", "function", compileState->files[fileNum].fileName, command->lineNum);
+    }
+}
+
+/**
+ * Adds the symbols defined by the command to the summary and checks the symbols it references
+ */
+static void checkSymbols(struct streamState* state, unsigned fileNum, struct parsedCommand* command) {
+    struct symbolRule* rule = &state->rules[command->opcode];
+    if(rule->role == noSymbol) {
+        return;
+    }
+
+    struct compileState* compileState = state->compileState;
+    struct symbolTable* table = rule->perFile ? &state->fileSymbols : &state->programSymbols;
+    if(rule->role == definesSymbol) {
+        char* name = (rule->parametersToCheck > 0) ? command->parameters[0] : "";
+        struct symbol* definition = findSymbol(table, rule->definitionOpcode, name);
+        if(definition != NULL) {
+            printError(compileState->files[fileNum].fileName, command->lineNum, compileState, "%s defined twice (already defined in %s:%lu)", 3,
+                       rule->itemName, compileState->files[definition->fileNum].fileName, definition->lineNum);
+        } else {
+            addSymbol(table, rule->definitionOpcode, name, fileNum, command->lineNum);
+        }
+
+        uint8_t commandType = commandList[command->opcode].commandType;
+        if(commandType == COMMAND_TYPE_FUNC_DEF || commandType == COMMAND_TYPE_DATA) {
+            checkGlobalSymbolName(state, fileNum, command);
+        }
+        if(commandType == COMMAND_TYPE_FUNC_DEF) {
+            const char* const mainFunctionName =
+                #ifdef MACOS
+                    "_main";
+                #else
+                    "main";
+                #endif
+            state->mainDefined |= (strcmp(name, mainFunctionName) == 0);
+        }
+    } else {
+        struct pendingReferences* references = rule->perFile ? &state->fileReferences : &state->programReferences;
+        for(unsigned i = 0; i < ((rule->parametersToCheck > 0) ? rule->parametersToCheck : 1); i++) {
+            char* name = (rule->parametersToCheck > 0) ? command->parameters[i] : "";
+            if(findSymbol(table, rule->definitionOpcode, name) == NULL) {
+                addPendingReference(references, name, rule, fileNum, command->lineNum);
+            }
+        }
+    }
+}
+
+static void freeCommand(struct parsedCommand* command) {
+    for(unsigned i = 0; i < commandList[command->opcode].usedParameters; i++) {
+        free(command->parameters[i]);
+    }
+}
+
+/**
+ * Checks and translates a data declaration. Data does not belong to a function, so it is written as soon as it was read
+ */
+static void streamData(struct streamState* state, unsigned fileNum, struct parsedCommand* command) {
+    struct compileState* compileState = state->compileState;
+    checkParameters(command, compileState->files[fileNum].fileName, compileState);
+    checkSymbols(state, fileNum, command);
+    if(compileState->compilerErrors == 0 && command->translate) {
+        fprintf(state->output, ".global %s\n", command->parameters[0]);
+        writeDataDeclaration(command, state->output);
+    }
+}
+
+/**
+ * Checks and translates the function that is currently being read, then frees it. Commands after its last return
+ * statement do not belong to any function, except for data declarations
+ * @param nextDefinition the function definition that ends this function, or NULL if the end of the file was reached
+ */
+static void finishFunction(struct streamState* state, unsigned fileNum, struct parsedCommand* nextDefinition) {
+    if(state->commandCount == 0) {
+        return;
+    }
+
+    struct compileState* compileState = state->compileState;
+    char* fileName = compileState->files[fileNum].fileName;
+    if(nextDefinition != NULL && state->lastReturn != state->commandCount - 1) {
+        printError(fileName, nextDefinition->lineNum, compileState, "expected a return statement, but got a new function definition", 0);
+    }
+    if(state->lastReturn == 0) {
+        printError(fileName, state->commands[0].lineNum, compileState, "function does not return", 0);
+    }
+
+    struct function function = {
+        .definedInFile = fileName,
+        .definedInLine = state->commands[0].lineNum,
+        .numberOfCommands = state->lastReturn + 1,
+        .commands = state->commands
+    };
+    for(size_t i = function.numberOfCommands; i < state->commandCount; i++) {
+        if(commandList[state->commands[i].opcode].commandType != COMMAND_TYPE_DATA) {
+            printError(fileName, state->commands[i].lineNum, compileState, "command does not belong to any function", 0);
+        }
+    }
+    checkFunctionBody(function.commands, function.numberOfCommands, fileName, compileState);
+
+    printDebugMessage(compileState->logLevel, "Checking function %s with %lu commands", 2, function.commands[0].parameters[0], function.numberOfCommands);
+    for(size_t i = 0; i < function.numberOfCommands; i++) {
+        checkParameters(&function.commands[i], fileName, compileState);
+        checkSymbols(state, fileNum, &function.commands[i]);
+    }
+
+    //Once an error was found, the output is discarded anyway
+    if(compileState->compilerErrors == 0) {
+        if(function.commands[0].translate) {
+            fprintf(state->output, ".global %s\n", function.commands[0].parameters[0]);
+        }
+        writeFunction(compileState, fileNum, &function, &state->line, state->output);
+    }
+    for(size_t i = function.numberOfCommands; i < state->commandCount; i++) {
+        if(commandList[state->commands[i].opcode].commandType == COMMAND_TYPE_DATA) {
+            streamData(state, fileNum, &state->commands[i]);
+        }
+    }
+
+    for(size_t i = 0; i < state->commandCount; i++) {
+        freeCommand(&state->commands[i]);
+    }
+    state->commandCount = 0;
+    state->lastReturn = 0;
+}
+
+/**
+ * Adds a command to the function that is currently being read
+ */
+static void addCommand(struct streamState* state, struct parsedCommand* command) {
+    if(state->commandCount == state->commandCapacity) {
+        state->commandCapacity = (state->commandCapacity == 0) ? 64 : 2 * state->commandCapacity;
+        state->commands = realloc(state->commands, state->commandCapacity * sizeof(struct parsedCommand));
+        CHECK_ALLOC(state->commands);
+    }
+    if(commandList[command->opcode].commandType == COMMAND_TYPE_FUNC_RETURN) {
+        state->lastReturn = state->commandCount;
+    }
+    state->commands[state->commandCount++] = *command;
+}
+
+/**
+ * Parses, checks and translates a file one function at a time
+ * @return false if the file could not be opened
+ */
+static bool streamFile(struct streamState* state, unsigned fileNum) {
+    struct compileState* compileState = state->compileState;
+    char* fileName = compileState->files[fileNum].fileName;
+    FILE* inputFile = fopen(fileName, "r");
+    if(inputFile == NULL) {
+        perror("Failed to open input file");
+        return false;
+    }
+
+    if(compileState->compilerErrors == 0) {
+        writeFileInfo(compileState, fileNum, state->output);
+    }
+    state->line = 0;
+
+    char* line = NULL;
+    size_t length = 0;
+    ssize_t lineLength;
+    size_t lineNumber = 1;
+    while((lineLength = getLine(&line, &length, inputFile)) != -1) {
+        //Line numbers are stored in 32 bits
+        if(lineNumber > MAX_LINE_NUMBER) {
+            printError(fileName, 0, compileState, "files with more than %u lines are not supported", 1, MAX_LINE_NUMBER);
+            break;
+        }
+        if(isLineOfInterest(line, lineLength) == 1) {
+            removeLineBreaksAndTabs(line);
+            struct parsedCommand command = parseLine(fileName, lineNumber, line, compileState);
+            countCommand(compileState, command.opcode);
+
+            //Every line is deleted with the probability linesToBeDeleted / remainingLines, which selects exactly linesToBeDeleted lines
+            if(state->linesToBeDeleted > 0 && randomBelow(state->compileState, state->remainingLines) < state->linesToBeDeleted) {
+                command.translate = false;
+                state->linesToBeDeleted--;
+                emitRemark(compileState, remarkPassed, "perfectly-balanced", "LineDeleted", fileName, lineNumber, "line deleted by \"perfectly balanced as all things should be\"");
+            }
+            state->remainingLines--;
+
+            if(commandList[command.opcode].commandType == COMMAND_TYPE_FUNC_DEF) {
+                finishFunction(state, fileNum, &command);
+                addCommand(state, &command);
+            } else if(state->commandCount > 0) {
+                addCommand(state, &command);
+            } else if(commandList[command.opcode].commandType == COMMAND_TYPE_DATA) {
+                streamData(state, fileNum, &command);
+                freeCommand(&command);
+            } else {
+                printError(fileName, lineNumber, compileState, "command does not belong to any function", 0);
+                freeCommand(&command);
+            }
+        } else {
+            countSkippedLine(compileState, line);
+        }
+        lineNumber++;
+    }
+    finishFunction(state, fileNum, NULL);
+    free(line);
+    fclose(inputFile);
+
+    if(compileState->files[fileNum].loc == 0) {
+        printError(fileName, 0, compileState, "file does not contain any commands", 0);
+    }
+
+    //Symbols defined per file are only visible within it
+    resolvePendingReferences(state, &state->fileReferences, &state->fileSymbols);
+    freeSymbolTable(&state->fileSymbols);
+    return true;
+}
+
+/**
+ * Checks if a line consists of exactly the given command, which must not have parameters. The line is tokenized like
+ * parseLine() does
+ */
+static bool isCommand(const char* line, const char* pattern) {
+    size_t lineLength, patternLength;
+    const char* linePosition = line;
+    const char* patternPosition = pattern;
+    const char* lineToken = nextToken(&linePosition, " \t", &lineLength);
+    const char* patternToken = nextToken(&patternPosition, " \t", &patternLength);
+    while(lineToken != NULL && patternToken != NULL) {
+        if(lineLength != patternLength || memcmp(lineToken, patternToken, lineLength) != 0) {
+            return false;
+        }
+        lineToken = nextToken(&linePosition, " ", &lineLength);
+        patternToken = nextToken(&patternPosition, " ", &patternLength);
+    }
+    return lineToken == NULL && patternToken == NULL;
+}
+
+/**
+ * Reads all files once to count their lines of code and the uses of "perfectly balanced as all things should be",
+ * which are needed before the first line can be translated
+ * @return the number of uses of "perfectly balanced as all things should be", or -1 if a file could not be opened
+ */
+static long countLines(struct streamState* state) {
+    struct compileState* compileState = state->compileState;
+    long perfectlyBalancedUsed = 0;
+    char* line = NULL;
+    size_t length = 0;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        FILE* inputFile = fopen(compileState->files[i].fileName, "r");
+        if(inputFile == NULL) {
+            perror("Failed to open input file");
+            free(line);
+            return -1;
+        }
+
+        ssize_t lineLength;
+        size_t loc = 0;
+        while((lineLength = getLine(&line, &length, inputFile)) != -1) {
+            if(isLineOfInterest(line, lineLength) == 1) {
+                loc++;
+                if(state->perfectlyBalancedOpcode >= 0) {
+                    removeLineBreaksAndTabs(line);
+                    perfectlyBalancedUsed += isCommand(line, commandList[state->perfectlyBalancedOpcode].pattern);
+                }
+            }
+        }
+        fclose(inputFile);
+        compileState->files[i].loc = loc;
+        state->remainingLines += loc;
+    }
+    free(line);
+    return perfectlyBalancedUsed;
+}
+
+/**
+ * Chooses the random jump marker of "confused stonks" and the number of lines deleted by "perfectly balanced as all
+ * things should be", like setConfusedStonksJumpLabel() and chooseLinesToBeDeleted() do
+ */
+static void chooseRandomLines(struct streamState* state, long perfectlyBalancedUsed) {
+    struct compileState* compileState = state->compileState;
+    for(unsigned i = 0; i < compileState->fileCount; i++) {
+        compileState->files[i].randomIndex = (compileState->files[i].loc > 0) ? randomBelow(compileState, compileState->files[i].loc) : 0;
+        printDebugMessage(compileState->logLevel, "Chose random line for jump marker: %lu", 1, compileState->files[i].randomIndex);
+    }
+
+    size_t linesToBeKept = state->remainingLines;
+    for(long i = 0; i < perfectlyBalancedUsed && linesToBeKept > 0; i++) {
+        linesToBeKept /= 2;
+    }
+    state->linesToBeDeleted = state->remainingLines - linesToBeKept;
+    printDebugMessage(compileState->logLevel, "\tamount of lines to be deleted: %lu", 1, state->linesToBeDeleted);
+    if(state->linesToBeDeleted > 0 && !compileState->collectDiagnostics) {
+        printThanosASCII(state->linesToBeDeleted);
+    }
+}
+
+/**
+ * Copies the assembly code from the temporary file into gcc
+ */
+static int assembleTemporaryFile(struct compileState* compileState, FILE* temporaryFile, char* outputFileName) {
+    FILE* output = openAssemblyOutput(compileState, outputFileName);
+    if(output == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    char buffer[65536];
+    size_t bytesRead;
+    rewind(temporaryFile);
+    while((bytesRead = fread(buffer, 1, sizeof(buffer), temporaryFile)) > 0) {
+        fwrite(buffer, 1, bytesRead, output);
+    }
+    return closeAssemblyOutput(compileState, output);
+}
+
+/**
+ * Compiles all files in streaming mode. The files of the compile state only need to contain their names
+ * @return EXIT_SUCCESS if compilation succeeded, EXIT_FAILURE otherwise
+ */
+int compileStreaming(struct compileState* compileState, char* outputFileName) {
+    struct streamState state = {
+        .compileState = compileState
+    };
+    initSymbolRules(&state);
+
+    long perfectlyBalancedUsed = countLines(&state);
+    if(perfectlyBalancedUsed < 0) {
+        return EXIT_FAILURE;
+    }
+    chooseRandomLines(&state, perfectlyBalancedUsed);
+
+    /*
+     * Assembly files are written directly and removed if compilation fails. gcc would however start assembling
+     * immediately, which is why the assembly code is buffered in a temporary file first
+     */
+    state.output = (compileState->outputMode == assemblyFile) ? openAssemblyOutput(compileState, outputFileName) : tmpfile();
+    if(state.output == NULL) {
+        if(compileState->outputMode != assemblyFile) {
+            perror("Failed to create temporary file");
+        }
+        return EXIT_FAILURE;
+    }
+
+    writeAssemblyHeader(state.output);
+    bool filesRead = true;
+    for(unsigned i = 0; i < compileState->fileCount && filesRead; i++) {
+        printDebugMessage(compileState->logLevel, "Streaming file \"%s\"", 1, compileState->files[i].fileName);
+        filesRead = streamFile(&state, i);
+    }
+    if(filesRead) {
+        resolvePendingReferences(&state, &state.programReferences, &state.programSymbols);
+        if(compileState->outputMode == executable && !state.mainDefined) {
+            printError(compileState->files[0].fileName, 0, compileState, "unable to create an executable if no main-function was defined", 0);
+        }
+    }
+    writeAssemblyFooter(compileState, true, state.output);
+
+    freeSymbolTable(&state.programSymbols);
+    freePendingReferences(&state.programReferences);
+    free(state.fileReferences.entries);
+    free(state.commands);
+
+    int result;
+    if(!filesRead || compileState->compilerErrors > 0) {
+        if(compileState->compilerErrors > 0 && !compileState->collectDiagnostics) {
+            printErrorASCII();
+            fprintf(stderr, "Compilation failed with %u error(s), please check your code and try again.\n", compileState->compilerErrors);
+        }
+        fclose(state.output);
+        if(compileState->outputMode == assemblyFile) {
+            remove(outputFileName);
+        }
+        result = EXIT_FAILURE;
+    } else if(compileState->outputMode == assemblyFile) {
+        result = closeAssemblyOutput(compileState, state.output);
+    } else {
+        result = assembleTemporaryFile(compileState, state.output, outputFileName);
+        fclose(state.output);
+    }
+    return result;
+}
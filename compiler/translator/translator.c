@@ -20,6 +20,8 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include "translator.h"
 #include "../logger/log.h"
 #include "../analyser/functions.h"
+#include "../analyser/parameters.h"
+#include "../report/remarks.h"
 
 #include <time.h>
 #include <string.h>
@@ -36,9 +38,6 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 extern const char* const versionString;
 extern const struct command commandList[];
 
-//Used to pseudo-random generation when using bully mode
-extern uint64_t computedIndex;
-
 const char* const martyrdomCode = "push rax\n"
                                   "    push rdi\n"
                                   "    push rsi\n"
@@ -112,8 +111,8 @@ void stabs_writeFunctionEndLabel(FILE *outputFile, char* currentFunctionName) {
  * @param outputFile the output file
  * @param parsedCommand the command that requires a line number info
  */
-void stabs_writeLineLabel(FILE *outputFile, struct parsedCommand parsedCommand) {
-    fprintf(outputFile, "\t.Lcmd_%lu:\n", parsedCommand.lineNum);
+void stabs_writeLineLabel(FILE *outputFile, const struct parsedCommand* parsedCommand) {
+    fprintf(outputFile, "\t.Lcmd_%u:\n", parsedCommand->lineNum);
 }
 
 /**
@@ -121,8 +120,8 @@ void stabs_writeLineLabel(FILE *outputFile, struct parsedCommand parsedCommand)
  * @param outputFile the output file
  * @param parsedCommand the command that requires a line number info
  */
-void stabs_writeLineInfo(FILE *outputFile, struct parsedCommand parsedCommand) {
-    fprintf(outputFile, "\t.stabn %d, 0, %lu, .Lcmd_%lu\n", N_SLINE, parsedCommand.lineNum, parsedCommand.lineNum);
+void stabs_writeLineInfo(FILE *outputFile, const struct parsedCommand* parsedCommand) {
+    fprintf(outputFile, "\t.stabn %d, 0, %u, .Lcmd_%u\n", N_SLINE, parsedCommand->lineNum, parsedCommand->lineNum);
 }
 
 /**
@@ -133,8 +132,8 @@ void stabs_writeLineInfo(FILE *outputFile, struct parsedCommand parsedCommand) {
  * @param fileNum the id of the current file
  * @param outputFile the file where the translation should be written to
  */
-void translateToAssembly(struct compileState* compileState, char* currentFunctionName, struct parsedCommand parsedCommand, unsigned fileNum, bool lastCommand, FILE *outputFile) {
-    if(commandList[parsedCommand.opcode].commandType != COMMAND_TYPE_FUNC_DEF && compileState->optimisationLevel == o69420) {
+void translateToAssembly(struct compileState* compileState, char* currentFunctionName, const struct parsedCommand* parsedCommand, unsigned fileNum, bool lastCommand, FILE *outputFile) {
+    if(commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_FUNC_DEF && compileState->optimisationLevel == o69420) {
         printDebugMessage(compileState->logLevel, "\tCommand is not a function declaration, abort.", 0);
         return;
     }
@@ -142,15 +141,15 @@ void translateToAssembly(struct compileState* compileState, char* currentFunctio
     //If we are supposed to create STABS info, we now need to create labels
     if(compileState->useStabs) {
         //If this is a function declaration, update the current function name
-        if(commandList[parsedCommand.opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
+        if(commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
             stabs_writeLineLabel(outputFile, parsedCommand);
         }
     }
 
-    struct command command = commandList[parsedCommand.opcode];
-    char *translationPattern = command.translationPattern;
+    const struct command* command = &commandList[parsedCommand->opcode];
+    char *translationPattern = command->translationPattern;
 
-    if(commandList[parsedCommand.opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
+    if(commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
         fprintf(outputFile, "\t");
     }
     for(size_t i = 0; i < strlen(translationPattern); i++) {
@@ -162,17 +161,21 @@ void translateToAssembly(struct compileState* compileState, char* currentFunctio
             if(formatSpecifier == 'F') {
                 fprintf(outputFile, "%u", fileNum);
             //Is it a parameter?
-            } else if(formatSpecifier >= '0' && formatSpecifier < command.usedParameters + '0') {
+            } else if(formatSpecifier >= '0' && formatSpecifier < command->usedParameters + '0') {
                 uint8_t index = formatSpecifier - 48;
-                char *parameter = parsedCommand.parameters[index];
-                if(parsedCommand.isPointer == index + 1) {
+                char *parameter = parsedCommand->parameters[index];
+                if(parsedCommand->isPointer == index + 1) {
                     /*
                      * If we are in bully mode, we first need to check if the operand size is unknown (e.g. a pointer
                      * and a decimal number are used). This is because this check is skipped in parameters.c
                      */
-                    if(compileState->compileMode == bully && commandList[parsedCommand.opcode].usedParameters == 2 && !PARAM_ISREG(parsedCommand.paramTypes[index + 1 % 2])) {
+                    if(parsedCommand->pointerSize != 0) {
+                        fprintf(outputFile, "%s PTR [%s]", getPointerSizeName(parsedCommand->pointerSize), parameter);
+                    } else if(compileState->compileMode == bully && commandList[parsedCommand->opcode].usedParameters == 2 && !PARAM_ISREG(parsedCommand->paramTypes[(index + 1) % 2])) {
                         const char* operandSizes[] = {"BYTE PTR", "WORD PTR", "DWORD PTR", "QWORD PTR"};
-                        fprintf(outputFile, "%s [%s]", operandSizes[computedIndex % 4], parameter);
+                        fprintf(outputFile, "%s [%s]", operandSizes[compileState->computedIndex % 4], parameter);
+                        emitRemark(compileState, remarkPassed, "bully", "OperandSizeChosen", compileState->files[fileNum].fileName, parsedCommand->lineNum,
+                                   "operand size of pointer \"%s\" is unknown, %s was chosen", parameter, operandSizes[compileState->computedIndex % 4]);
                     } else {
                         fprintf(outputFile, "[%s]", parameter);
                     }
@@ -181,15 +184,15 @@ void translateToAssembly(struct compileState* compileState, char* currentFunctio
                      * If the parameter is a decimal number, write it as a hex string. Fixes issue #73
                      * The check is only needed here, as a decimal number cannot be a pointer
                      */
-                    if(parsedCommand.paramTypes[index] == PARAM_DECIMAL) {
+                    if(parsedCommand->paramTypes[index] == PARAM_DECIMAL) {
                         fprintf(outputFile, "0x%llX", strtoll(parameter, NULL, 10));
                     } else {
                         fprintf(outputFile, "%s", parameter);
                     }
                 }
             } else {
-                printInternalCompilerError("Invalid translation format specifier '%c' for opcode %u", true, 2, formatSpecifier, parsedCommand.opcode);
-                exit(EXIT_FAILURE);
+                printInternalCompilerError("Invalid translation format specifier '%c' for opcode %u", true, 2, formatSpecifier, parsedCommand->opcode);
+                abortCompilation(abortInternalError);
             }
 
             //move our pointer along by three characters instead of one, as we just parsed three characters
@@ -200,22 +203,36 @@ void translateToAssembly(struct compileState* compileState, char* currentFunctio
     }
     fprintf(outputFile, "\n");
 
-    //Now, we need to insert more commands based on the current optimisation level
-    if (compileState->optimisationLevel == o_1) {
+    //Now, we need to insert more commands based on the current optimisation level. Inline assembly is left exactly as it was written
+    bool reverseOptimisation = compileState->optimisationLevel == o_1 || compileState->optimisationLevel == o_2 || compileState->optimisationLevel == o_3;
+    if (reverseOptimisation && COMMAND_TYPE_IS_INLINE_ASM(command->commandType)) {
+        emitRemark(compileState, remarkMissed, "reverse-optimisation", "InlineAssembly", compileState->files[fileNum].fileName, parsedCommand->lineNum,
+                   "no code inserted into inline assembly");
+    } else if (compileState->optimisationLevel == o_1) {
         //Insert a nop
         fprintf(outputFile, "\tnop\n");
+        emitRemark(compileState, remarkPassed, "reverse-optimisation", "NopInserted", compileState->files[fileNum].fileName, parsedCommand->lineNum, "nop inserted");
     } else if (compileState->optimisationLevel == o_2) {
         //Push and pop rax
         fprintf(outputFile, "\tpush rax\n\tpop rax\n");
+        emitRemark(compileState, remarkPassed, "reverse-optimisation", "StackAccessInserted", compileState->files[fileNum].fileName, parsedCommand->lineNum,
+                   "rax pushed to and popped from the stack");
     } else if (compileState->optimisationLevel == o_3) {
-        //Save and restore xmm0 on the stack using movups
-        fprintf(outputFile, "\tmovups [rsp + 8], xmm0\n\tmovups xmm0, [rsp + 8]\n");
+        //Save and restore xmm0 on the stack using movups. [rsp + 8] belongs to the caller (or is the return address), so the red zone below rsp is used
+        #ifdef WINDOWS
+        //The Windows x64 ABI has no red zone, so the space has to be allocated
+        fprintf(outputFile, "\tsub rsp, 16\n\tmovups [rsp], xmm0\n\tmovups xmm0, [rsp]\n\tadd rsp, 16\n");
+        #else
+        fprintf(outputFile, "\tmovups [rsp - 16], xmm0\n\tmovups xmm0, [rsp - 16]\n");
+        #endif
+        emitRemark(compileState, remarkPassed, "reverse-optimisation", "StackAccessInserted", compileState->files[fileNum].fileName, parsedCommand->lineNum,
+                   "xmm0 stored to and loaded from the stack using movups");
     } else if(compileState->optimisationLevel == o69420) {
         //If we get here, then this was a function declaration. Insert a ret-statement and exit
         fprintf(outputFile, "\txor rax, rax\n\tret\n");
     }
 
-    if(compileState->useStabs && commandList[parsedCommand.opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
+    if(compileState->useStabs && commandList[parsedCommand->opcode].commandType != COMMAND_TYPE_FUNC_DEF) {
         //If this was a return statement and this is the end of file or a function definition is followed by it, we reached the end of the function. Define the label for the N_RBRAC stab
         if(lastCommand) {
             stabs_writeFunctionEndLabel(outputFile, currentFunctionName);
@@ -225,24 +242,21 @@ void translateToAssembly(struct compileState* compileState, char* currentFunctio
     }
 }
 
-void writeToFile(struct compileState* compileState, FILE *outputFile) {
+/**
+ * Writes the comment and syntax directive every assembly file starts with
+ */
+static void writeFileHeader(FILE *outputFile) {
     time_t t = time(NULL);
     struct tm tm = *localtime(&t);
 
     fprintf(outputFile, "#\n# Generated by the MemeAssembly compiler %s on %s#\n", versionString, asctime(&tm));
     fprintf(outputFile, ".intel_syntax noprefix\n");
+}
 
-    //Define all functions as global
-    for(unsigned i = 0; i < compileState->fileCount; i++) {
-        for(size_t j = 0; j < compileState->files[i].functionCount; j++) {
-            //Only write if the function definition is to be translated
-            if(compileState->files[i].functions[j].commands[0].translate) {
-                //Write the function name with the prefix ".global" to the file
-                fprintf(outputFile, ".global %s\n", compileState->files[i].functions[j].commands[0].parameters[0]);
-            }
-        }
-    }
-
+/**
+ * Writes the data section and the start of the text section, including the killParent runtime function
+ */
+static void writeSections(FILE *outputFile) {
     #ifdef WINDOWS
     //To interact with the Windows API, we need to reference the needed functions
     fprintf(outputFile, "\n.extern GetStdHandle\n.extern WriteFile\n.extern ReadFile\n");
@@ -291,66 +305,111 @@ void writeToFile(struct compileState* compileState, FILE *outputFile) {
                         "    ret\n\n");
 
     #endif
+}
 
-    /*
-     * If we're in bully mode and an executable is to be generated, we omitted the check
-     * if there was a main-function
-     * We do that check now. If no main function exists, the first function in the file becomes the main function
-     */
-    if(compileState->compileMode == bully && compileState->outputMode == executable && !mainFunctionExists(compileState)) {
-        fprintf(outputFile, "\n.global main\n\t");
-        fprintf(outputFile, "\nmain:\n\t");
-        fprintf(outputFile, "%s", martyrdomCode);
+/**
+ * Writes the beginning of an assembly file whose functions are translated one at a time using writeFunction().
+ * Since the functions are not known yet, they are not declared as global here
+ */
+void writeAssemblyHeader(FILE *outputFile) {
+    writeFileHeader(outputFile);
+    writeSections(outputFile);
+}
+
+/**
+ * Writes the debug info of a file. Must be called before its first function is translated
+ */
+void writeFileInfo(struct compileState* compileState, unsigned fileNum, FILE *outputFile) {
+    if(compileState->useStabs) {
+        stabs_writeFileInfo(outputFile, compileState->files[fileNum].fileName);
     }
+}
+
+/**
+ * Translates a single function
+ * @param fileNum the index of the file the function is defined in
+ * @param line the number of commands of this file that were translated before this function. It is updated accordingly
+ */
+void writeFunction(struct compileState* compileState, unsigned fileNum, struct function* function, size_t* line, FILE *outputFile) {
+    char* functionName = function->commands[0].parameters[0];
+    if(compileState->optimisationLevel == o69420 && function->commands[0].translate) {
+        emitRemark(compileState, remarkPassed, "o69420", "FunctionBodyRemoved", compileState->files[fileNum].fileName, function->commands[0].lineNum,
+                   "%lu command(s) of function \"%s\" optimised out, it now returns 0", function->numberOfCommands - 1, functionName);
+    }
+
+    for(size_t k = 0; k < function->numberOfCommands; k++) {
+        #ifndef WINDOWS
+        const char *const mainFuncName =
+        #ifdef MACOS
+                "_main";
+        #else
+                "main";
+        #endif
 
-    for(unsigned i = 0; i < compileState->fileCount; i++) {
-        struct file currentFile = compileState->files[i];
-        //Write the file info if we are using stabs
-        if(compileState->useStabs) {
-            stabs_writeFileInfo(outputFile, currentFile.fileName);
+        if (compileState->martyrdom && k == 1 && strcmp(functionName, mainFuncName) == 0) {
+            fprintf(outputFile, "%s", martyrdomCode);
         }
+        #endif
 
-        size_t line = 0;
-        for(size_t j = 0; j < currentFile.functionCount; j++) {
-            struct function currentFunction = currentFile.functions[j];
-            char* functionName = currentFunction.commands[0].parameters[0];
-
-            for(size_t k = 0; k < currentFunction.numberOfCommands; k++) {
-                #ifndef WINDOWS
-                const char *const mainFuncName =
-                #ifdef MACOS
-                        "_main";
-                #else
-                        "main";
-                #endif
-
-                if (compileState->martyrdom && k == 1 && strcmp(functionName, mainFuncName) == 0) {
-                    fprintf(outputFile, "%s", martyrdomCode);
-                }
-                #endif
+        const struct parsedCommand* currentCommand = &function->commands[k];
 
-                struct parsedCommand currentCommand = currentFunction.commands[k];
+        //Print the confused stonks label now if it should be at this position
+        if (*line == compileState->files[fileNum].randomIndex) {
+            fprintf(outputFile, "\t.LConfusedStonks_%u: \n", fileNum);
+        }
 
-                //Print the confused stonks label now if it should be at this position
-                if (line == currentFile.randomIndex) {
-                    fprintf(outputFile, "\t.LConfusedStonks_%u: \n", i);
-                }
+        //If it should be translated, translate it. Data is written into its own section by writeDataDeclaration()
+        if (currentCommand->translate && commandList[currentCommand->opcode].commandType != COMMAND_TYPE_DATA) {
+            translateToAssembly(compileState, functionName, currentCommand, fileNum,
+                                (k == function->numberOfCommands - 1), outputFile);
+        }
 
-                //If it should be translated, translate it
-                if (currentCommand.translate) {
-                    translateToAssembly(compileState, functionName, currentCommand, i,
-                                        (k == currentFunction.numberOfCommands - 1), outputFile);
-                }
+        //Insert STABS function-info
+        if (compileState->useStabs) {
+            stabs_writeFunctionInfo(outputFile, functionName);
+        }
+        (*line)++;
+    }
+}
 
-                //Insert STABS function-info
-                if (compileState->useStabs) {
-                    stabs_writeFunctionInfo(outputFile, functionName);
-                }
-                line++;
-            }
+/**
+ * Writes a data declaration into its section and continues the text section afterwards. Tables and strings are read-only,
+ * buffers are zero-initialised
+ */
+void writeDataDeclaration(const struct parsedCommand* parsedCommand, FILE *outputFile) {
+    const char* directive = commandList[parsedCommand->opcode].translationPattern;
+    char* name = parsedCommand->parameters[0];
+    char* values = parsedCommand->parameters[1];
+
+    if(strcmp(directive, ".zero") == 0) {
+        uint64_t size, alignment;
+        parseBufferSize(values, &size, &alignment);
+        #ifdef MACOS
+        fprintf(outputFile, "\n.zerofill __DATA,__bss,%s,%llu,%d\n", name, (unsigned long long) size, __builtin_ctzll(alignment));
+        #else
+        fprintf(outputFile, "\n.bss\n\t.balign %llu\n%s:\n\t.zero %llu\n", (unsigned long long) alignment, name, (unsigned long long) size);
+        #endif
+    } else {
+        #if defined(LINUX)
+        fprintf(outputFile, "\n.section .rodata\n");
+        #elif defined(MACOS)
+        fprintf(outputFile, "\n.const\n");
+        #else
+        fprintf(outputFile, "\n.section .rdata,\"dr\"\n");
+        #endif
+        if(strcmp(directive, ".quad") == 0) {
+            fprintf(outputFile, "\t.balign 8\n");
         }
+        fprintf(outputFile, "%s:\n\t%s %s\n", name, directive, values);
     }
+    fprintf(outputFile, ".text\n");
+}
 
+/**
+ * Writes the runtime functions (writechar, readchar) and everything else that follows the translated functions
+ * @param lastFile whether the assembly file contains the last input file. Only then, padding is added
+ */
+void writeAssemblyFooter(struct compileState* compileState, bool lastFile, FILE *outputFile) {
     //If the optimisation level is 42069, then this function will not be used as all commands are optimised out
     if(compileState->optimisationLevel != o69420) {
         #ifdef WINDOWS
@@ -469,7 +528,87 @@ void writeToFile(struct compileState* compileState, FILE *outputFile) {
         fprintf(outputFile, ".stabs \"\", %d, 0, 0, .LEOF\n", N_SO);
     }
 
-    if(compileState->optimisationLevel == o_s) {
+    //When files are assembled separately, only the last one is padded, as the alignment would otherwise be applied once per file
+    if(compileState->optimisationLevel == o_s && lastFile) {
         fprintf(outputFile, ".align 536870912\n");
+        emitRemark(compileState, remarkPassed, "reverse-storage", "OutputPadded", compileState->files[compileState->fileCount - 1].fileName, 0,
+                   "end of the code aligned to 536870912 bytes");
+    }
+}
+
+/**
+ * Writes the translation of the files firstFile to lastFile - 1 into the output file. The result is a self-contained
+ * assembly file, which includes the data section and runtime functions (writechar, readchar, killParent) as local symbols
+ * @param compileState the current compile state
+ * @param firstFile the index of the first file to be translated
+ * @param lastFile the index after the last file to be translated
+ * @param outputFile the file where the translation should be written to
+ */
+static void writeFiles(struct compileState* compileState, unsigned firstFile, unsigned lastFile, FILE *outputFile) {
+    writeFileHeader(outputFile);
+
+    //Define all functions as global
+    for(unsigned i = firstFile; i < lastFile; i++) {
+        for(size_t j = 0; j < compileState->files[i].functionCount; j++) {
+            //Only write if the function definition is to be translated
+            if(compileState->files[i].functions[j].commands[0].translate) {
+                //Write the function name with the prefix ".global" to the file
+                fprintf(outputFile, ".global %s\n", compileState->files[i].functions[j].commands[0].parameters[0]);
+            }
+        }
+        //Data can be used by other files as well
+        for(size_t j = 0; j < compileState->files[i].loc; j++) {
+            const struct parsedCommand* parsedCommand = &compileState->files[i].parsedCommands[j];
+            if(commandList[parsedCommand->opcode].commandType == COMMAND_TYPE_DATA && parsedCommand->translate) {
+                fprintf(outputFile, ".global %s\n", parsedCommand->parameters[0]);
+            }
+        }
+    }
+
+    writeSections(outputFile);
+
+    /*
+     * If we're in bully mode and an executable is to be generated, we omitted the check
+     * if there was a main-function
+     * We do that check now. If no main function exists, the first function in the file becomes the main function
+     */
+    if(firstFile == 0 && compileState->compileMode == bully && compileState->outputMode == executable && !mainFunctionExists(compileState)) {
+        fprintf(outputFile, "\n.global main\n\t");
+        fprintf(outputFile, "\nmain:\n\t");
+        fprintf(outputFile, "%s", martyrdomCode);
+        emitRemark(compileState, remarkPassed, "bully", "MainInserted", compileState->files[0].fileName, 0,
+                   "no main function was defined, the first function is executed instead");
+    }
+
+    for(unsigned i = firstFile; i < lastFile; i++) {
+        writeFileInfo(compileState, i, outputFile);
+
+        size_t line = 0;
+        for(size_t j = 0; j < compileState->files[i].functionCount; j++) {
+            writeFunction(compileState, i, &compileState->files[i].functions[j], &line, outputFile);
+        }
+        for(size_t j = 0; j < compileState->files[i].loc; j++) {
+            const struct parsedCommand* parsedCommand = &compileState->files[i].parsedCommands[j];
+            if(commandList[parsedCommand->opcode].commandType == COMMAND_TYPE_DATA && parsedCommand->translate) {
+                writeDataDeclaration(parsedCommand, outputFile);
+            }
+        }
     }
+
+    writeAssemblyFooter(compileState, lastFile == compileState->fileCount, outputFile);
+}
+
+/**
+ * Translates all files into a single assembly file
+ */
+void writeToFile(struct compileState* compileState, FILE *outputFile) {
+    writeFiles(compileState, 0, compileState->fileCount, outputFile);
+}
+
+/**
+ * Translates a single file into an assembly file that can be assembled separately from all other files. The functions
+ * of all other files are referenced as external symbols
+ */
+void writeFileToFile(struct compileState* compileState, unsigned fileNum, FILE *outputFile) {
+    writeFiles(compileState, fileNum, fileNum + 1, outputFile);
 }
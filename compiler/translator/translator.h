@@ -25,5 +25,14 @@ along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
 #include <stdio.h>
 
 void writeToFile(struct compileState* compileState, FILE *outputFile);
+void writeFileToFile(struct compileState* compileState, unsigned fileNum, FILE *outputFile);
+void translateToAssembly(struct compileState* compileState, char* currentFunctionName, const struct parsedCommand* parsedCommand, unsigned fileNum, bool lastCommand, FILE *outputFile);
+
+//Used when functions are translated one at a time (streaming mode)
+void writeAssemblyHeader(FILE *outputFile);
+void writeFileInfo(struct compileState* compileState, unsigned fileNum, FILE *outputFile);
+void writeFunction(struct compileState* compileState, unsigned fileNum, struct function* function, size_t* line, FILE *outputFile);
+void writeDataDeclaration(const struct parsedCommand* parsedCommand, FILE *outputFile);
+void writeAssemblyFooter(struct compileState* compileState, bool lastFile, FILE *outputFile);
 
 #endif //MEMEASSEMBLY_TRANSLATOR_H
@@ -0,0 +1,229 @@
+/*
+This file is part of the MemeAssembly compiler.
+
+ Copyright © 2021-2023 Tobias Kamm and contributors
+
+MemeAssembly is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MemeAssembly is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MemeAssembly. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Watch mode (--watch [options] -o outputFile inputFile(s)). The output is compiled once and then rebuilt whenever one
+ * of the input files changes. Parsed files are kept in the parse cache of the compile server, so only modified files
+ * are parsed again. Analysis and translation run in a forked child, which leaves the cached files untouched.
+ */
+
+#include "watch.h"
+#include "../compiler.h"
+#include "../logger/log.h"
+#include "../report/remarks.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LINUX
+#include <errno.h>
+#include <libgen.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+
+//Editors often write a file in several steps. Changes within this time are combined into one rebuild
+#define DEBOUNCE_MILLISECONDS 20
+
+struct watchedFile {
+    int watchDescriptor; //Watch of the directory containing the file, so that files replaced by a rename are still noticed
+    char* baseName;
+};
+
+static double elapsedMilliseconds(struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (double) (end.tv_sec - start->tv_sec) * 1000.0 + (double) (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * Parses all input files (reusing unchanged ones from the parse cache) and compiles them in a forked child
+ * @param inputsKnown is set to true if the arguments were valid, so that optind points to the first input file
+ * @return the exit code of the compilation
+ */
+static int build(int argc, char* argv[], struct parseCache* parseCache, argumentParser parseArguments, bool* inputsKnown) {
+    struct compileState compileState;
+    char* outputFileName;
+    beginParseRequest(parseCache);
+    int exitCode = parseArguments(argc, argv, &compileState, &outputFileName, parseCache);
+    //A cache hit returns 0 after all options were read
+    *inputsKnown = (exitCode == -1 || exitCode == 0) && optind < argc;
+    if(exitCode != -1) {
+        freeRequestFiles(parseCache, &compileState);
+        freeRemarks(&compileState);
+        return exitCode;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if(pid == 0) {
+        exit(compile(&compileState, outputFileName));
+    }
+
+    exitCode = 1;
+    if(pid < 0) {
+        perror("Failed to start compilation");
+    } else {
+        int status;
+        while(waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    freeRequestFiles(parseCache, &compileState);
+    freeRemarks(&compileState);
+    return exitCode;
+}
+
+/**
+ * Adds an inotify watch for the directory of every input file
+ * @return the watched files, or NULL on error
+ */
+static struct watchedFile* watchInputFiles(int inotifyFd, int fileCount, char* fileNames[]) {
+    struct watchedFile* watchedFiles = calloc(fileCount, sizeof(struct watchedFile));
+    CHECK_ALLOC(watchedFiles);
+
+    for(int i = 0; i < fileCount; i++) {
+        //dirname and basename may modify their argument
+        char* directoryBuffer = strdup(fileNames[i]);
+        char* baseNameBuffer = strdup(fileNames[i]);
+        CHECK_ALLOC(directoryBuffer);
+        CHECK_ALLOC(baseNameBuffer);
+
+        watchedFiles[i].watchDescriptor = inotify_add_watch(inotifyFd, dirname(directoryBuffer), IN_CLOSE_WRITE | IN_MOVED_TO);
+        watchedFiles[i].baseName = strdup(basename(baseNameBuffer));
+        CHECK_ALLOC(watchedFiles[i].baseName);
+        free(directoryBuffer);
+        free(baseNameBuffer);
+
+        if(watchedFiles[i].watchDescriptor < 0) {
+            fprintf(stderr, "Error: cannot watch %s: %s\n", fileNames[i], strerror(errno));
+            for(int j = 0; j <= i; j++) {
+                free(watchedFiles[j].baseName);
+            }
+            free(watchedFiles);
+            return NULL;
+        }
+    }
+    return watchedFiles;
+}
+
+/**
+ * Reads all pending inotify events
+ * @return true if one of the input files changed
+ */
+static bool readEvents(int inotifyFd, struct watchedFile* watchedFiles, int fileCount) {
+    //Aligned as required by inotify(7)
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    ssize_t length;
+    while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for(char* current = buffer; current < buffer + length; ) {
+            struct inotify_event* event = (struct inotify_event*) current;
+            for(int i = 0; i < fileCount && event->len > 0; i++) {
+                if(watchedFiles[i].watchDescriptor == event->wd && strcmp(watchedFiles[i].baseName, event->name) == 0) {
+                    changed = true;
+                }
+            }
+            current += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Compiles the input files and rebuilds the output every time one of them changes. Only returns if the arguments are invalid or an error occurs
+ * @param argc the number of arguments, including the program name
+ */
+int runWatch(int argc, char* argv[], argumentParser parseArguments) {
+    struct parseCache* parseCache = createParseCache();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    bool inputsKnown;
+    int exitCode = build(argc, argv, parseCache, parseArguments, &inputsKnown);
+    if(!inputsKnown) {
+        freeParseCache(parseCache);
+        return exitCode;
+    }
+    //getopt moves all input files to the end of argv
+    int fileCount = argc - optind;
+    char** fileNames = argv + optind;
+    printf("Build %s in %.1f ms\n", (exitCode == 0) ? "succeeded" : "failed", elapsedMilliseconds(&start));
+
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        perror("Failed to initialise inotify");
+        freeParseCache(parseCache);
+        return 1;
+    }
+    struct watchedFile* watchedFiles = watchInputFiles(inotifyFd, fileCount, fileNames);
+    if(watchedFiles == NULL) {
+        close(inotifyFd);
+        freeParseCache(parseCache);
+        return 1;
+    }
+
+    printf("Watching %d file(s) for changes, press Ctrl+C to stop\n", fileCount);
+    fflush(stdout);
+
+    while(true) {
+        struct pollfd pollFd = {.fd = inotifyFd, .events = POLLIN};
+        if(poll(&pollFd, 1, -1) < 0) {
+            if(errno == EINTR) continue;
+            perror("Failed to wait for changes");
+            break;
+        }
+        if(!readEvents(inotifyFd, watchedFiles, fileCount)) {
+            continue;
+        }
+        //Wait until the editor is done writing
+        while(poll(&pollFd, 1, DEBOUNCE_MILLISECONDS) > 0) {
+            readEvents(inotifyFd, watchedFiles, fileCount);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        exitCode = build(argc, argv, parseCache, parseArguments, &inputsKnown);
+        printf("Rebuild %s in %.1f ms\n", (exitCode == 0) ? "succeeded" : "failed", elapsedMilliseconds(&start));
+        fflush(stdout);
+    }
+
+    for(int i = 0; i < fileCount; i++) {
+        free(watchedFiles[i].baseName);
+    }
+    free(watchedFiles);
+    close(inotifyFd);
+    freeParseCache(parseCache);
+    return 1;
+}
+
+#else
+
+int runWatch(int argc, char* argv[], argumentParser parseArguments) {
+    (void) argc;
+    (void) argv;
+    (void) parseArguments;
+    fprintf(stderr, "Error: watch mode is only supported on Linux\n");
+    return 1;
+}
+
+#endif